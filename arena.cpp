@@ -0,0 +1,281 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Response Arena
+// Description: Per-thread bump arenas for response bodies built per request
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+#include "logger.h"
+#include "arena.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-ARENA"
+
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* A heap block taken by a body that outgrew the arena; the data follows the
+ * header, ARENA_ALIGNMENT bytes in */
+typedef struct ARENAOVERFLOW {
+    struct ARENAOVERFLOW *next;
+} ArenaOverflow;
+
+/* Used by its owning thread only; the counters are read by anyone */
+struct ARENA {
+    char *base;
+    size_t size;
+    size_t used;
+    size_t overflowBytes;               // of the current body
+    ArenaOverflow *overflow;            // of the current body, freed by the reset
+    std::atomic<size_t> highWater;
+    std::atomic<uint64_t> resets;
+    std::atomic<uint64_t> overflows;
+    struct ARENA *next;
+};
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static std::atomic<size_t> gArenaSize(ARENA_DEFAULT_SIZE);
+
+// Every arena ever created, newest first; arenas live as long as the process
+static std::atomic<Arena *> gArenas(NULL);
+static __thread Arena *tArena = NULL;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+void setResponseArenaSize(size_t size)
+{
+    gArenaSize.store(ARENA_ROUND(size));
+}
+
+static Arena *createArena(size_t size)
+{
+    Arena *arena = new Arena();
+    arena->base = (char *)malloc(size);
+    if (!arena->base)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to allocate a response arena of %zu bytes", size);
+        delete arena;
+        return NULL;
+    }
+    arena->size = size;
+    arena->used = 0;
+    arena->overflowBytes = 0;
+    arena->overflow = NULL;
+    arena->highWater.store(0);
+    arena->resets.store(0);
+    arena->overflows.store(0);
+
+    Arena *first = gArenas.load();
+    do
+    {
+        arena->next = first;
+    } while (!gArenas.compare_exchange_weak(first, arena));
+    return arena;
+}
+
+Arena *getResponseArena(void)
+{
+    size_t size = gArenaSize.load(std::memory_order_relaxed);
+    if (size == 0)
+    {
+        return NULL;
+    }
+    Arena *arena = tArena;
+    if (arena)
+    {
+        return arena;
+    }
+    return tArena = createArena(size);
+}
+
+void *allocArena(Arena *arena, size_t size)
+{
+    size = ARENA_ROUND(size);
+    if (size <= arena->size - arena->used)
+    {
+        void *ptr = arena->base + arena->used;
+        arena->used += size;
+        memset(ptr, 0, size);
+        return ptr;
+    }
+
+    ArenaOverflow *block = (ArenaOverflow *)calloc(1, ARENA_ALIGNMENT + size);
+    if (!block)
+    {
+        return NULL;
+    }
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflowBytes += size;
+    arena->overflows.store(arena->overflows.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    return (char *)block + ARENA_ALIGNMENT;
+}
+
+void resetArena(Arena *arena)
+{
+    size_t bytes = arena->used + arena->overflowBytes;
+    if (bytes > arena->highWater.load(std::memory_order_relaxed))
+    {
+        arena->highWater.store(bytes, std::memory_order_relaxed);
+    }
+    while (arena->overflow)
+    {
+        ArenaOverflow *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+    arena->used = 0;
+    arena->overflowBytes = 0;
+    arena->resets.store(arena->resets.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+}
+
+void getArenaStats(ArenaStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->size = gArenaSize.load();
+    for (Arena *arena = gArenas.load(); arena; arena = arena->next)
+    {
+        stats->arenas++;
+        stats->resets += arena->resets.load(std::memory_order_relaxed);
+        stats->overflows += arena->overflows.load(std::memory_order_relaxed);
+        size_t highWater = arena->highWater.load(std::memory_order_relaxed);
+        if (highWater > stats->highWater)
+        {
+            stats->highWater = highWater;
+        }
+    }
+}
+
+OCRepPayload *createArenaPayload(Arena *arena)
+{
+    OCRepPayload *payload = (OCRepPayload *)allocArena(arena, sizeof(OCRepPayload));
+    if (payload)
+    {
+        payload->base.type = PAYLOAD_TYPE_REPRESENTATION;
+    }
+    return payload;
+}
+
+static bool appendArenaString(Arena *arena, OCStringLL **list, const char *value)
+{
+    OCStringLL *item = (OCStringLL *)allocArena(arena, sizeof(OCStringLL));
+    if (!item)
+    {
+        return false;
+    }
+    item->value = (char *)value;
+    while (*list)
+    {
+        list = &(*list)->next;
+    }
+    *list = item;
+    return true;
+}
+
+bool addArenaResourceType(Arena *arena, OCRepPayload *payload, const char *resourceType)
+{
+    return appendArenaString(arena, &payload->types, resourceType);
+}
+
+bool addArenaInterface(Arena *arena, OCRepPayload *payload, const char *iface)
+{
+    return appendArenaString(arena, &payload->interfaces, iface);
+}
+
+/* A zeroed value at the end of the list, as OCRepPayloadSetProp*() adds one */
+static OCRepPayloadValue *appendArenaValue(Arena *arena, OCRepPayload *payload,
+        const char *name, OCRepPayloadPropType type)
+{
+    OCRepPayloadValue *value = (OCRepPayloadValue *)allocArena(arena, sizeof(OCRepPayloadValue));
+    if (!value)
+    {
+        return NULL;
+    }
+    value->name = (char *)name;
+    value->type = type;
+
+    OCRepPayloadValue **tail = &payload->values;
+    while (*tail)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = value;
+    return value;
+}
+
+bool setArenaPropInt(Arena *arena, OCRepPayload *payload, const char *name, int64_t value)
+{
+    OCRepPayloadValue *prop = appendArenaValue(arena, payload, name, OCREP_PROP_INT);
+    if (!prop)
+    {
+        return false;
+    }
+    prop->i = value;
+    return true;
+}
+
+bool setArenaPropString(Arena *arena, OCRepPayload *payload, const char *name, const char *value)
+{
+    OCRepPayloadValue *prop = appendArenaValue(arena, payload, name, OCREP_PROP_STRING);
+    if (!prop)
+    {
+        return false;
+    }
+    prop->str = (char *)value;
+    return true;
+}
+
+bool setArenaPropObject(Arena *arena, OCRepPayload *payload, const char *name, OCRepPayload *value)
+{
+    OCRepPayloadValue *prop = appendArenaValue(arena, payload, name, OCREP_PROP_OBJECT);
+    if (!prop)
+    {
+        return false;
+    }
+    prop->obj = value;
+    return true;
+}
+
+bool setArenaIntArray(Arena *arena, OCRepPayload *payload, const char *name, int64_t *array,
+        size_t count)
+{
+    OCRepPayloadValue *prop = appendArenaValue(arena, payload, name, OCREP_PROP_ARRAY);
+    if (!prop)
+    {
+        return false;
+    }
+    prop->arr.type = OCREP_PROP_INT;
+    prop->arr.dimensions[0] = count;
+    prop->arr.iArray = array;
+    return true;
+}
+
+bool setArenaObjectArray(Arena *arena, OCRepPayload *payload, const char *name,
+        OCRepPayload **array, size_t count)
+{
+    OCRepPayloadValue *prop = appendArenaValue(arena, payload, name, OCREP_PROP_ARRAY);
+    if (!prop)
+    {
+        return false;
+    }
+    prop->arr.type = OCREP_PROP_OBJECT;
+    prop->arr.dimensions[0] = count;
+    prop->arr.objArray = array;
+    return true;
+}
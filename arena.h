@@ -0,0 +1,62 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ocpayload.h"
+
+/* Response arenas: a body built per request (a time range, the metrics) is
+ * laid out in a bump arena owned by the answering thread instead of one heap
+ * block per node, property name and array, and the whole body is dropped in
+ * one step once OCDoResponse() has encoded it. Arenas are never shared: each
+ * thread gets its own on first use, so allocating takes no lock. A body built
+ * here must never go to OCRepPayloadDestroy(). */
+
+#define ARENA_DEFAULT_SIZE  (64 * 1024)     // a 1000 sample time range with room to spare
+#define ARENA_ALIGNMENT     16
+
+typedef struct ARENASTATS {
+    size_t arenas;              // threads that have built a body in an arena
+    size_t size;                // bytes reserved per arena
+    size_t highWater;           // most bytes one body has taken, overflow included
+    uint64_t resets;            // bodies dropped
+    uint64_t overflows;         // heap blocks taken by bodies larger than the arena
+} ArenaStats;
+
+typedef struct ARENA Arena;
+
+/* Bytes reserved per thread, for the arenas created after the call; 0 turns
+ * the arenas off and bodies are built on the heap again */
+void setResponseArenaSize(size_t size);
+
+/* The calling thread's arena, created on first use; NULL when the arenas are
+ * off or the arena cannot be allocated, and the caller builds on the heap */
+Arena *getResponseArena(void);
+
+/* Never fails for want of room: a request that does not fit is given a heap
+ * block of its own, freed by the reset. Returns NULL only when that fails.
+ * The memory is zeroed. */
+void *allocArena(Arena *arena, size_t size);
+
+/* Drops everything allocated since the last reset */
+void resetArena(Arena *arena);
+
+void getArenaStats(ArenaStats *stats);
+
+/* OCRepPayload builders. Names and string values are not copied: they must
+ * outlive the response, as string literals and descriptor fields do. Values
+ * are appended in call order; a name is not looked up, so set each once. */
+OCRepPayload *createArenaPayload(Arena *arena);
+bool addArenaResourceType(Arena *arena, OCRepPayload *payload, const char *resourceType);
+bool addArenaInterface(Arena *arena, OCRepPayload *payload, const char *iface);
+bool setArenaPropInt(Arena *arena, OCRepPayload *payload, const char *name, int64_t value);
+bool setArenaPropString(Arena *arena, OCRepPayload *payload, const char *name, const char *value);
+bool setArenaPropObject(Arena *arena, OCRepPayload *payload, const char *name, OCRepPayload *value);
+
+/* The arrays are not copied either: allocate them in the arena */
+bool setArenaIntArray(Arena *arena, OCRepPayload *payload, const char *name, int64_t *array,
+        size_t count);
+bool setArenaObjectArray(Arena *arena, OCRepPayload *payload, const char *name,
+        OCRepPayload **array, size_t count);
+
+#endif
@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Benchmark Client
+// Description: Clock, discovery and latency helpers of the client benchmarks
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "benchclient.h"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+volatile sig_atomic_t gQuit = 0;
+const char *gClientDbFile = NULL;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void handleSigInt(int signum)
+{
+    if (signum == SIGINT)
+    {
+        gQuit = 1;
+    }
+}
+
+FILE *benchFopen(const char *path, const char *mode)
+{
+    if (gClientDbFile && 0 == strcmp(path, OC_SECURITY_DB_DAT_FILE_NAME))
+    {
+        return fopen(gClientDbFile, mode);
+    }
+    return fopen(path, mode);
+}
+
+bool addLatency(LatencyList *list, uint64_t ns)
+{
+    if (list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4096;
+        uint64_t *grown = (uint64_t *)realloc(list->ns, capacity * sizeof(uint64_t));
+        if (!grown)
+        {
+            return false;
+        }
+        list->ns = grown;
+        list->capacity = capacity;
+    }
+    list->ns[list->count++] = ns;
+    return true;
+}
+
+int compareNs(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+double getPercentileUs(const LatencyList *list, double percent)
+{
+    if (list->count == 0)
+    {
+        return 0;
+    }
+    size_t rank = (size_t)(percent / 100.0 * list->count + 0.999999);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+    if (rank > list->count)
+    {
+        rank = list->count;
+    }
+    return list->ns[rank - 1] / 1000.0;
+}
+
+OCStackApplicationResult discoveryCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse)
+{
+    BenchTargetList *list = (BenchTargetList *)ctx;
+    if (!clientResponse || !clientResponse->payload
+        || clientResponse->payload->type != PAYLOAD_TYPE_DISCOVERY)
+    {
+        return OC_STACK_KEEP_TRANSACTION;
+    }
+
+    OCDiscoveryPayload *discovery = (OCDiscoveryPayload *)clientResponse->payload;
+    for (OCResourcePayload *res = discovery->resources; res; res = res->next)
+    {
+        bool found = false;
+        for (OCStringLL *type = res->types; type; type = type->next)
+        {
+            found |= (0 == strcmp(type->value, BENCH_AM_TYPE));
+        }
+        if (!found || list->count == list->capacity)
+        {
+            continue;
+        }
+
+        // A secure resource is reached on its own port, over DTLS
+        BenchTarget *target = &list->targets[list->count];
+        memset(target, 0, sizeof(*target));
+        target->addr = clientResponse->devAddr;
+        if (res->secure)
+        {
+            target->addr.port = res->port;
+            target->addr.flags = (OCTransportFlags)(target->addr.flags | OC_FLAG_SECURE);
+        }
+        snprintf(target->uri, sizeof(target->uri), "%s", res->uri);
+
+        // Multicast discovery can bring the same answer on several
+        // interfaces; instances of one server share its address
+        bool known = false;
+        target->server = list->servers;
+        for (size_t i = 0; i < list->count && !known; i++)
+        {
+            const BenchTarget *other = &list->targets[i];
+            bool sameServer = (0 == strcmp(other->addr.addr, target->addr.addr)
+                               && other->addr.port == target->addr.port);
+            if (sameServer)
+            {
+                target->server = other->server;
+            }
+            known = sameServer && 0 == strcmp(other->uri, target->uri);
+        }
+        if (!known)
+        {
+            list->servers += (target->server == list->servers) ? 1 : 0;
+            list->count++;
+        }
+    }
+    return OC_STACK_KEEP_TRANSACTION;
+}
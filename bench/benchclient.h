@@ -0,0 +1,68 @@
+#ifndef BENCHCLIENT_H
+#define BENCHCLIENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include "ocstack.h"
+
+/* What the client benchmarks (bench/loadgen, bench/fanoutbench) share: their
+ * clock, Ctrl-C, the client's own security database, lists of latencies and
+ * the discovery of the Atomic Measurements they drive. */
+
+#define BENCH_AM_TYPE           "oic.r.bloodpressuremonitor-am"
+
+/* An Atomic Measurement found by discoveryCb() */
+typedef struct BENCHTARGET {
+    OCDevAddr addr;
+    char uri[MAX_URI_LENGTH];
+    size_t server;              // index of its server, by address
+} BenchTarget;
+
+/* The context of discoveryCb(): targets has room for capacity of them */
+typedef struct BENCHTARGETLIST {
+    BenchTarget *targets;
+    size_t count;
+    size_t capacity;
+    size_t servers;
+} BenchTargetList;
+
+/* Values in ns */
+typedef struct LATENCYLIST {
+    uint64_t *ns;
+    size_t count;
+    size_t capacity;
+} LatencyList;
+
+/* Set by handleSigInt() */
+extern volatile sig_atomic_t gQuit;
+
+/* The client's security database, opened by benchFopen() in place of the
+ * stack's; each client sets its own default */
+extern const char *gClientDbFile;
+
+/* CLOCK_MONOTONIC, in ns */
+uint64_t nowNs(void);
+
+void handleSigInt(int signum);
+
+/* The fopen of the client's OCPersistentStorage: the server's security
+ * database stays with the server */
+FILE *benchFopen(const char *path, const char *mode);
+
+/* Appends ns, growing the list; false when out of memory */
+bool addLatency(LatencyList *list, uint64_t ns);
+
+/* qsort() order of ns values */
+int compareNs(const void *a, const void *b);
+
+/* Nearest rank percentile of sorted values, in us */
+double getPercentileUs(const LatencyList *list, double percent);
+
+/* Response handler of a discovery, run by OCProcess(): collects every Atomic
+ * Measurement of the responses into the BenchTargetList of ctx, once each,
+ * and numbers the servers they live on */
+OCStackApplicationResult discoveryCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse);
+
+#endif
@@ -0,0 +1,509 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Fan-out Benchmark
+// Description: Client registering many observers of a server, reporting the
+//              notification throughput and the spread of each fan-out round
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "../common.h"
+#include "benchclient.h"
+
+/* Discovers the Atomic Measurements of a server (over loopback by default)
+ * and, for each observer count asked for, registers that many observations
+ * spread over them, measures for a while and cancels them. One thread runs
+ * the stack and every callback, so nothing here is locked.
+ *
+ * The notification body carries no timestamp, so delivery is timed within
+ * a fan-out round: every observer of a resource gets the same observe
+ * sequence number for one round, and each delivery is timed from the
+ * round's first one. The span of a round, first to last delivery, is what
+ * grows with the observer count. A round that did not reach every observer
+ * of its resource is counted as incomplete.
+ *
+ * Observation ids are 8 bit in this stack: a server holds 255 observers at
+ * most, over all its resources. Each server gets FANOUT_MAX_PER_SERVER of
+ * them at most; larger counts need several servers, found with -a multicast.
+ * The JSON report goes to stdout, a summary per step to stderr. */
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define FANOUT_MAX_OBSERVERS    16384
+#define FANOUT_MAX_TARGETS      4096
+#define FANOUT_MAX_STEPS        16
+#define FANOUT_MAX_PER_SERVER   250     // of the 255 observation ids of a server
+#define FANOUT_ROUNDS           16      // rounds in flight per resource
+#define FANOUT_DISCOVERY_MS     5000
+#define FANOUT_DISCOVERY_QUIET_MS 500
+#define FANOUT_REGISTER_MS      5000
+#define FANOUT_DRAIN_MS         1000
+#define FANOUT_POLL_MS          10
+
+#define FANOUT_CLIENT_DB_FILE   "fanoutbench.dat"
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* Delivery times in ns of the rounds of one resource, by sequence number */
+typedef struct FANOUTROUND {
+    bool used;
+    uint32_t seq;
+    uint64_t firstNs;
+    uint64_t lastNs;
+    size_t count;
+} FanoutRound;
+
+typedef struct FANOUTTARGET {
+    OCDevAddr addr;
+    char uri[MAX_URI_LENGTH];
+    size_t server;              // index of its server, by address
+    size_t observers;           // registered ones, during a step
+    FanoutRound rounds[FANOUT_ROUNDS];
+    size_t nextRound;
+} FanoutTarget;
+
+typedef struct FANOUTOBSERVER {
+    OCDoHandle handle;
+    FanoutTarget *target;
+    bool registered;
+} FanoutObserver;
+
+typedef struct FANOUTSTEP {
+    size_t asked;
+    size_t observers;           // after the per server cap
+    size_t registered;
+    uint64_t notifications;
+    uint64_t rounds;
+    uint64_t incomplete;
+    double seconds;
+    LatencyList delay;          // delivery after the round's first one
+    LatencyList span;           // first to last delivery of a complete round
+} FanoutStep;
+
+typedef struct FANOUTCONFIG {
+    const char *host;           // NULL: multicast discovery
+    size_t counts[FANOUT_MAX_STEPS];
+    size_t steps;
+    double seconds;
+    double pmin;                // seconds, for the observe query
+} FanoutConfig;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static BenchTarget gFound[FANOUT_MAX_TARGETS];
+static BenchTargetList gFoundList = { gFound, 0, FANOUT_MAX_TARGETS, 0 };
+static FanoutTarget gTargets[FANOUT_MAX_TARGETS];
+static size_t gTargetCount = 0;
+static size_t gServerCount = 0;
+
+static FanoutObserver gObservers[FANOUT_MAX_OBSERVERS];
+static FanoutStep gSteps[FANOUT_MAX_STEPS];
+static FanoutStep *gStep = NULL;
+static bool gMeasuring = false;
+
+static FanoutConfig gConfig = { "127.0.0.1", { 1, 100, 250 }, 3, 10, 1 };
+
+//-----------------------------------------------------------------------------
+// Callback functions
+//-----------------------------------------------------------------------------
+
+/* Response handlers, run by OCProcess(); discoveryCb() is in benchclient.h */
+OCStackApplicationResult observeCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse);
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+/* Closes the oldest round of target to make room; counts it if it was one
+ * of the measurement */
+static FanoutRound *recycleRound(FanoutTarget *target)
+{
+    FanoutRound *round = &target->rounds[target->nextRound];
+    target->nextRound = (target->nextRound + 1) % FANOUT_ROUNDS;
+    if (round->used && gMeasuring)
+    {
+        gStep->rounds++;
+        if (round->count < target->observers)
+        {
+            gStep->incomplete++;
+        }
+        else
+        {
+            addLatency(&gStep->span, round->lastNs - round->firstNs);
+        }
+    }
+    memset(round, 0, sizeof(*round));
+    return round;
+}
+
+/* The first answer of an observation is its registration; every later one
+ * is a notification of some round */
+OCStackApplicationResult observeCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse)
+{
+    FanoutObserver *observer = (FanoutObserver *)ctx;
+    if (!clientResponse || observer->handle != handle)
+    {
+        return OC_STACK_KEEP_TRANSACTION;
+    }
+    uint64_t now = nowNs();
+    if (!observer->registered)
+    {
+        if (clientResponse->result <= OC_STACK_RESOURCE_CHANGED)
+        {
+            observer->registered = true;
+            observer->target->observers++;
+            gStep->registered++;
+        }
+        return OC_STACK_KEEP_TRANSACTION;
+    }
+    if (!gMeasuring)
+    {
+        return OC_STACK_KEEP_TRANSACTION;
+    }
+
+    FanoutTarget *target = observer->target;
+    FanoutRound *round = NULL;
+    for (size_t i = 0; i < FANOUT_ROUNDS && !round; i++)
+    {
+        if (target->rounds[i].used && target->rounds[i].seq == clientResponse->sequenceNumber)
+        {
+            round = &target->rounds[i];
+        }
+    }
+    if (!round)
+    {
+        round = recycleRound(target);
+        round->used = true;
+        round->seq = clientResponse->sequenceNumber;
+        round->firstNs = now;
+    }
+    round->lastNs = now;
+    round->count++;
+    gStep->notifications++;
+    addLatency(&gStep->delay, now - round->firstNs);
+    return OC_STACK_KEEP_TRANSACTION;
+}
+
+/* Runs the stack until untilNs */
+static void runStack(uint64_t untilNs)
+{
+    while (!gQuit && nowNs() < untilNs)
+    {
+        uint32_t nextEventTime = FANOUT_POLL_MS;
+#ifdef WITH_PROCESS_EVENT
+        OCProcessEvent(&nextEventTime);
+#else
+        OCProcess();
+        nextEventTime = 1;
+#endif
+        if (nextEventTime > FANOUT_POLL_MS)
+        {
+            nextEventTime = FANOUT_POLL_MS;
+        }
+        waitMainLoop(nextEventTime);
+    }
+}
+
+static int discoverTargets()
+{
+    char uri[MAX_URI_LENGTH];
+    if (gConfig.host)
+    {
+        snprintf(uri, sizeof(uri), "coap://%s:5683%s?rt=%s", gConfig.host,
+                OC_RSRVD_WELL_KNOWN_URI, BENCH_AM_TYPE);
+    }
+    else
+    {
+        snprintf(uri, sizeof(uri), "%s?rt=%s", OC_MULTICAST_DISCOVERY_URI, BENCH_AM_TYPE);
+    }
+
+    OCCallbackData cbData = { &gFoundList, discoveryCb, NULL };
+    OCDoHandle handle = NULL;
+    OCStackResult result = OCDoResource(&handle, OC_REST_DISCOVER, uri, NULL, NULL, CT_DEFAULT,
+            OC_LOW_QOS, &cbData, NULL, 0);
+    if (result != OC_STACK_OK)
+    {
+        fprintf(stderr, "Discovery failed: %s\n", getResult(result));
+        return -1;
+    }
+
+    // Other servers may answer later, so wait until the answers stop
+    uint64_t end = nowNs() + FANOUT_DISCOVERY_MS * 1000000ull;
+    size_t known = 0;
+    while (!gQuit && nowNs() < end)
+    {
+        runStack(nowNs() + FANOUT_DISCOVERY_QUIET_MS * 1000000ull);
+        if (gFoundList.count > 0 && gFoundList.count == known)
+        {
+            break;
+        }
+        known = gFoundList.count;
+    }
+    OCCancel(handle, OC_LOW_QOS, NULL, 0);
+
+    for (size_t i = 0; i < gFoundList.count; i++)
+    {
+        FanoutTarget *target = &gTargets[i];
+        memset(target, 0, sizeof(*target));
+        target->addr = gFound[i].addr;
+        snprintf(target->uri, sizeof(target->uri), "%s", gFound[i].uri);
+        target->server = gFound[i].server;
+    }
+    gTargetCount = gFoundList.count;
+    gServerCount = gFoundList.servers;
+
+    if (gTargetCount == 0)
+    {
+        fprintf(stderr, "No %s found\n", BENCH_AM_TYPE);
+        return -1;
+    }
+    return 0;
+}
+
+/* Spreads count observations over the targets, round robin, with at most
+ * FANOUT_MAX_PER_SERVER per server. Returns how many were sent. */
+static size_t registerObservers(size_t count)
+{
+    size_t perServer[FANOUT_MAX_TARGETS] = { 0 };
+    char uri[MAX_URI_LENGTH + 32];
+    size_t sent = 0;
+
+    // Every target is tried count times at most, so a capped run ends
+    for (size_t i = 0; sent < count && i < count * gTargetCount; i++)
+    {
+        FanoutTarget *target = &gTargets[i % gTargetCount];
+        if (perServer[target->server] == FANOUT_MAX_PER_SERVER)
+        {
+            continue;
+        }
+        FanoutObserver *observer = &gObservers[sent];
+        memset(observer, 0, sizeof(*observer));
+        observer->target = target;
+
+        snprintf(uri, sizeof(uri), "%s?pmin=%g", target->uri, gConfig.pmin);
+        OCCallbackData cbData = { observer, observeCb, NULL };
+        if (OCDoResource(&observer->handle, OC_REST_OBSERVE, uri, &target->addr, NULL,
+                CT_DEFAULT, OC_LOW_QOS, &cbData, NULL, 0) != OC_STACK_OK)
+        {
+            break;
+        }
+        perServer[target->server]++;
+        sent++;
+    }
+    return sent;
+}
+
+static void cancelObservers(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        OCCancel(gObservers[i].handle, OC_LOW_QOS, NULL, 0);
+        gObservers[i].handle = NULL;
+    }
+    for (size_t t = 0; t < gTargetCount; t++)
+    {
+        gTargets[t].observers = 0;
+        memset(gTargets[t].rounds, 0, sizeof(gTargets[t].rounds));
+        gTargets[t].nextRound = 0;
+    }
+}
+
+static void runStep(FanoutStep *step, size_t count)
+{
+    gStep = step;
+    step->asked = count;
+    step->observers = registerObservers(count);
+
+    // Until every registration is answered
+    uint64_t deadline = nowNs() + FANOUT_REGISTER_MS * 1000000ull;
+    while (!gQuit && step->registered < step->observers && nowNs() < deadline)
+    {
+        runStack(nowNs() + FANOUT_POLL_MS * 1000000ull);
+    }
+
+    gMeasuring = true;
+    uint64_t start = nowNs();
+    runStack(start + (uint64_t)(gConfig.seconds * 1e9));
+    step->seconds = (nowNs() - start) / 1e9;
+    // Close the rounds still open
+    for (size_t t = 0; t < gTargetCount; t++)
+    {
+        for (size_t i = 0; i < FANOUT_ROUNDS; i++)
+        {
+            recycleRound(&gTargets[t]);
+        }
+    }
+    gMeasuring = false;
+
+    cancelObservers(step->observers);
+    runStack(nowNs() + FANOUT_DRAIN_MS * 1000000ull);
+
+    qsort(step->delay.ns, step->delay.count, sizeof(uint64_t), compareNs);
+    qsort(step->span.ns, step->span.count, sizeof(uint64_t), compareNs);
+    if (step->observers < step->asked)
+    {
+        fprintf(stderr, "%zu observers asked, %zu placed: %zu server(s) of %d at most\n",
+                step->asked, step->observers, gServerCount, FANOUT_MAX_PER_SERVER);
+    }
+    fprintf(stderr, "%zu observers (%zu registered): %.1f notifications/s, %llu rounds "
+            "(%llu incomplete), delay p50 %.1f us p99 %.1f us, span p50 %.1f us max %.1f us\n",
+            step->observers, step->registered,
+            step->seconds > 0 ? step->notifications / step->seconds : 0.0,
+            (unsigned long long)step->rounds, (unsigned long long)step->incomplete,
+            getPercentileUs(&step->delay, 50), getPercentileUs(&step->delay, 99),
+            getPercentileUs(&step->span, 50), getPercentileUs(&step->span, 100));
+}
+
+static void printLatencyJson(const char *name, const LatencyList *list)
+{
+    printf("\"%s\": { \"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f }", name,
+            getPercentileUs(list, 50), getPercentileUs(list, 99), getPercentileUs(list, 100));
+}
+
+static void reportSteps(size_t steps)
+{
+    printf("{\n");
+    printf("  \"host\": \"%s\", \"targets\": %zu, \"servers\": %zu, \"pmin\": %g,\n",
+            gConfig.host ? gConfig.host : "multicast", gTargetCount, gServerCount, gConfig.pmin);
+    printf("  \"steps\": [");
+    for (size_t s = 0; s < steps; s++)
+    {
+        const FanoutStep *step = &gSteps[s];
+        printf("%s\n    { \"asked\": %zu, \"observers\": %zu, \"registered\": %zu, "
+               "\"seconds\": %.3f, \"notifications\": %llu, \"throughput\": %.1f, "
+               "\"rounds\": %llu, \"incomplete\": %llu, ",
+               s ? "," : "", step->asked, step->observers, step->registered, step->seconds,
+               (unsigned long long)step->notifications,
+               step->seconds > 0 ? step->notifications / step->seconds : 0.0,
+               (unsigned long long)step->rounds, (unsigned long long)step->incomplete);
+        printLatencyJson("delay", &step->delay);
+        printf(", ");
+        printLatencyJson("span", &step->span);
+        printf(" }");
+    }
+    printf("\n  ]\n}\n");
+    fflush(stdout);
+}
+
+static bool parseCounts(char *list)
+{
+    gConfig.steps = 0;
+    for (char *count = strtok(list, ","); count; count = strtok(NULL, ","))
+    {
+        size_t n = strtoul(count, NULL, 10);
+        if (n == 0 || n > FANOUT_MAX_OBSERVERS || gConfig.steps == FANOUT_MAX_STEPS)
+        {
+            return false;
+        }
+        gConfig.counts[gConfig.steps++] = n;
+    }
+    return gConfig.steps > 0;
+}
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-a host|multicast] [-n count[,count...]] [-d seconds]\n"
+            "       [-p pmin] [-D client.dat]\n", name);
+    fprintf(stderr, "  -a  address of the server (default 127.0.0.1), multicast discovers\n");
+    fprintf(stderr, "      every server on the network\n");
+    fprintf(stderr, "  -n  observer counts, one step each (default 1,100,250; at most %d\n",
+            FANOUT_MAX_OBSERVERS);
+    fprintf(stderr, "      and %d per server)\n", FANOUT_MAX_PER_SERVER);
+    fprintf(stderr, "  -d  measurement of each step in seconds (default 10)\n");
+    fprintf(stderr, "  -p  pmin of the observations in seconds (default 1)\n");
+    fprintf(stderr, "  -D  security database of the client in a secure build\n");
+    fprintf(stderr, "      (default %s)\n", FANOUT_CLIENT_DB_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    gClientDbFile = FANOUT_CLIENT_DB_FILE;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:n:d:p:D:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                gConfig.host = (0 == strcmp(optarg, "multicast")) ? NULL : optarg;
+                break;
+            case 'n':
+                if (!parseCounts(optarg))
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'd':
+                gConfig.seconds = atof(optarg);
+                break;
+            case 'p':
+                gConfig.pmin = atof(optarg);
+                break;
+            case 'D':
+                gClientDbFile = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (gConfig.seconds <= 0 || gConfig.pmin <= 0)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#if IS_SECURE_MODE
+    OCPersistentStorage ps = { benchFopen, fread, fwrite, fclose, unlink };
+    OCRegisterPersistentStorageHandler(&ps);
+#endif
+    if (OCInit(NULL, 0, OC_CLIENT) != OC_STACK_OK)
+    {
+        fprintf(stderr, "OCStack init error\n");
+        return EXIT_FAILURE;
+    }
+    initMainLoopEvent();
+    signal(SIGINT, handleSigInt);
+
+    int status = EXIT_FAILURE;
+    if (discoverTargets() == 0)
+    {
+        fprintf(stderr, "%zu target(s) on %zu server(s), first %s at %s:%u%s\n", gTargetCount,
+                gServerCount, gTargets[0].uri, gTargets[0].addr.addr, gTargets[0].addr.port,
+                (gTargets[0].addr.flags & OC_FLAG_SECURE) ? " (secure)" : "");
+
+        size_t steps = 0;
+        while (steps < gConfig.steps && !gQuit)
+        {
+            runStep(&gSteps[steps], gConfig.counts[steps]);
+            steps++;
+        }
+        reportSteps(steps);
+        for (size_t s = 0; s < steps; s++)
+        {
+            free(gSteps[s].delay.ns);
+            free(gSteps[s].span.ns);
+        }
+        status = EXIT_SUCCESS;
+    }
+
+    deinitMainLoopEvent();
+    OCStop();
+    return status;
+}
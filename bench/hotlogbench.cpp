@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Hot Path Log Benchmark
+// Description: Cost per log call, binary records vs a formatted line
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../hotlog.h"
+
+#define TAG "BENCH"
+
+/* Records are written in bursts of half a ring, and the clock stops while
+ * the drainer catches up, so the numbers are the caller's cost without
+ * drops. The formatted line is what OIC_LOG_V does per call: a timestamp,
+ * the message, and a line buffered write. */
+
+#define BENCH_BURST     (HOTLOG_RING_RECORDS / 2)
+#define BENCH_THREADS   4
+
+HOTLOG_EVENT(gBenchEvent, "bpm%u: entity handler, flags 0x%x, method %d");
+HOTLOG_EVENT(gBenchTextEvent, "bpm%u: query[%s]");
+
+typedef struct BENCHRUN {
+    long calls;
+    bool text;
+    double ns;
+} BenchRun;
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Waits until the drainer has formatted everything written so far */
+static void waitDrained(uint64_t expected)
+{
+    uint64_t written, dropped;
+    getHotLogStats(&written, &dropped);
+    while (written + dropped < expected)
+    {
+        struct timespec pause = { 0, 1000000 };
+        nanosleep(&pause, NULL);
+        getHotLogStats(&written, &dropped);
+    }
+}
+
+static void *runCalls(void *data)
+{
+    BenchRun *run = (BenchRun *)data;
+    double ns = 0;
+    for (long done = 0; done < run->calls; )
+    {
+        long burst = (run->calls - done < BENCH_BURST) ? run->calls - done : BENCH_BURST;
+        double start = nowNs();
+        for (long i = 0; i < burst; i++)
+        {
+            if (run->text)
+            {
+                writeHotLog(HOTLOG_INFO, &gBenchTextEvent, (int32_t)i, 0, 0, 0,
+                        "if=oic.if.baseline");
+            }
+            else
+            {
+                writeHotLog(HOTLOG_INFO, &gBenchEvent, (int32_t)i, 0x2, 0, 0, NULL);
+            }
+        }
+        ns += nowNs() - start;
+        done += burst;
+
+        // Other threads share the drainer: wait for this thread's share only
+        struct timespec pause = { 0, (HOTLOG_DRAIN_MS + 20) * 1000000L };
+        nanosleep(&pause, NULL);
+    }
+    run->ns = ns / run->calls;
+    return NULL;
+}
+
+static double timeThreads(int threads, long calls, bool text)
+{
+    pthread_t thread[BENCH_THREADS];
+    BenchRun runs[BENCH_THREADS];
+    for (int t = 0; t < threads; t++)
+    {
+        runs[t].calls = calls;
+        runs[t].text = text;
+        pthread_create(&thread[t], NULL, runCalls, &runs[t]);
+    }
+    double ns = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(thread[t], NULL);
+        ns += runs[t].ns;
+    }
+    return ns / threads;
+}
+
+static double timeFormatted(FILE *out, long calls)
+{
+    double start = nowNs();
+    for (long i = 0; i < calls; i++)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        struct tm local;
+        localtime_r(&now.tv_sec, &local);
+        fprintf(out, "%02d:%02d.%03d I: %s: query[%s] flags 0x%x\n", local.tm_min,
+                local.tm_sec, (int)(now.tv_nsec / 1000000), TAG, "if=oic.if.baseline",
+                (unsigned)i);
+    }
+    return (nowNs() - start) / calls;
+}
+
+#if HOTLOG_LEVEL > HOTLOG_DEBUG
+static double timeDisabled(long calls)
+{
+    double start = nowNs();
+    for (long i = 0; i < calls; i++)
+    {
+        HOTLOG(HOTLOG_DEBUG, gBenchEvent, i, 0x2, 0, 0);
+    }
+    return (nowNs() - start) / calls;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    long calls = (argc > 1) ? atol(argv[1]) : 20 * BENCH_BURST;
+    FILE *out = fopen("/dev/null", "w");
+    if (!out || calls <= 0)
+    {
+        fprintf(stderr, "Usage: %s [calls]\n", argv[0]);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOLBF, 0);
+
+    printf("%ld calls per thread, hot path log level %d\n", calls, HOTLOG_LEVEL);
+    printf("%-40s %10.1f ns/call\n", "OIC_LOG_V style formatted line", timeFormatted(out, calls));
+#if HOTLOG_LEVEL > HOTLOG_DEBUG
+    printf("%-40s %10.1f ns/call\n", "HOTLOG below the build level", timeDisabled(calls));
+#endif
+
+    if (startHotLog(out) != 0)
+    {
+        return 1;
+    }
+    printf("%-40s %10.1f ns/call\n", "HOTLOG, 4 integers", timeThreads(1, calls, false));
+    printf("%-40s %10.1f ns/call\n", "HOTLOG_TEXT, query", timeThreads(1, calls, true));
+    printf("%-40s %10.1f ns/call\n", "HOTLOG, 4 threads", timeThreads(BENCH_THREADS, calls, false));
+
+    uint64_t written, dropped;
+    waitDrained((uint64_t)calls * (2 + BENCH_THREADS));
+    getHotLogStats(&written, &dropped);
+    stopHotLog();
+    printf("%llu records drained, %llu dropped\n", (unsigned long long)written,
+            (unsigned long long)dropped);
+
+    fclose(out);
+    return 0;
+}
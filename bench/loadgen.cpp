@@ -0,0 +1,674 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Load Generator
+// Description: Client driving GETs and observe registrations at a server,
+//              reporting throughput and latency percentiles as JSON
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <atomic>
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "../common.h"
+#include "benchclient.h"
+
+/* Discovers the Atomic Measurements of a server (over loopback by default)
+ * and drives requests at them from several threads. Each thread keeps at
+ * most its share of the concurrency outstanding; with a rate the requests
+ * follow a fixed schedule and latency counts from the scheduled time, so a
+ * stalled server is not hidden by requests that were never sent. The stack
+ * is not thread safe: every call into it, and the response callbacks run
+ * by OCProcess(), hold gStackLock.
+ *
+ * The JSON report goes to stdout, a summary to stderr. With -G the exit
+ * status is 2 when the p99 or the error rate is over the limit. */
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define LOADGEN_MAX_THREADS     64
+#define LOADGEN_MAX_TARGETS     4096
+#define LOADGEN_MAX_WINDOW      1024        // outstanding requests per thread
+#define LOADGEN_DISCOVERY_MS    5000
+#define LOADGEN_DISCOVERY_QUIET_MS 500
+#define LOADGEN_TIMEOUT_MS      5000
+#define LOADGEN_POLL_MS         10
+
+#define LOADGEN_CLIENT_DB_FILE  "loadgen.dat"
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+typedef enum {
+    LOAD_BATCH = 0,
+    LOAD_LL,
+    LOAD_BASELINE,
+    LOAD_OBSERVE,           // registration until its first response
+    LOAD_KIND_COUNT
+} LoadKind;
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_PENDING,
+    SLOT_DONE,              // answered, an observation still to cancel
+} SlotState;
+
+typedef struct LOADSLOT {
+    SlotState state;
+    LoadKind kind;
+    OCDoHandle handle;
+    uint64_t startNs;
+    uint64_t doneNs;
+    OCStackResult result;
+    struct LOADTHREAD *thread;
+} LoadSlot;
+
+typedef struct LOADTHREAD {
+    pthread_t thread;
+    pthread_cond_t cond;        // a response arrived, waited on with gStackLock
+    unsigned int index;
+    size_t window;
+    double intervalNs;          // 0: as fast as the window allows
+    LoadSlot slots[LOADGEN_MAX_WINDOW];
+    LatencyList latency[LOAD_KIND_COUNT];
+    uint64_t sent;
+    uint64_t errors[LOAD_KIND_COUNT];
+    uint64_t timeouts[LOAD_KIND_COUNT];
+} LoadThread;
+
+typedef struct LOADCONFIG {
+    const char *host;           // NULL: multicast discovery
+    unsigned int threads;
+    size_t concurrency;
+    double rate;                // requests/s over all threads, 0 for closed loop
+    double seconds;
+    bool kinds[LOAD_KIND_COUNT];
+    uint32_t timeoutMs;
+    double gateP99Us;           // 0: no gate
+    double gateErrorPercent;
+} LoadConfig;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static pthread_mutex_t gStackLock = PTHREAD_MUTEX_INITIALIZER;
+
+static BenchTarget gTargets[LOADGEN_MAX_TARGETS];
+static BenchTargetList gTargetList = { gTargets, 0, LOADGEN_MAX_TARGETS, 0 };
+
+static LoadConfig gConfig = {
+    "127.0.0.1", 4, 32, 0, 10, { true, true, true, false }, LOADGEN_TIMEOUT_MS, 0, 0
+};
+static LoadThread gThreads[LOADGEN_MAX_THREADS];
+static uint64_t gStartNs = 0;
+static uint64_t gEndNs = 0;
+
+static const char *gKindNames[LOAD_KIND_COUNT] = { "batch", "ll", "baseline", "observe" };
+static const char *gKindQueries[LOAD_KIND_COUNT] = {
+    "?if=" OC_RSRVD_INTERFACE_BATCH, "?if=" OC_RSRVD_INTERFACE_LL,
+    "?if=" OC_RSRVD_INTERFACE_DEFAULT, ""
+};
+
+//-----------------------------------------------------------------------------
+// Callback functions
+//-----------------------------------------------------------------------------
+
+/* Response handlers, run by OCProcess() with gStackLock held; discoveryCb()
+ * is in benchclient.h */
+OCStackApplicationResult responseCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse);
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static void getDeadline(uint64_t ns, struct timespec *deadline)
+{
+    deadline->tv_sec = ns / 1000000000ull;
+    deadline->tv_nsec = ns % 1000000000ull;
+}
+
+/* Completes the slot of a request. A slot whose request was cancelled has
+ * another handle, or none, by now. */
+OCStackApplicationResult responseCb(void *ctx, OCDoHandle handle,
+        OCClientResponse *clientResponse)
+{
+    LoadSlot *slot = (LoadSlot *)ctx;
+    if (slot->state != SLOT_PENDING || slot->handle != handle)
+    {
+        // A notification of an observation that is being cancelled
+        return OC_STACK_KEEP_TRANSACTION;
+    }
+
+    slot->doneNs = nowNs();
+    slot->result = clientResponse ? clientResponse->result : OC_STACK_ERROR;
+    slot->state = SLOT_DONE;
+    pthread_cond_signal(&slot->thread->cond);
+
+    // An observation stays until its thread cancels it
+    return (slot->kind == LOAD_OBSERVE) ? OC_STACK_KEEP_TRANSACTION : OC_STACK_DELETE_TRANSACTION;
+}
+
+/* Next kind in the configured mix, round robin */
+static LoadKind getNextKind(uint64_t n)
+{
+    LoadKind enabled[LOAD_KIND_COUNT];
+    size_t count = 0;
+    for (int k = 0; k < LOAD_KIND_COUNT; k++)
+    {
+        if (gConfig.kinds[k])
+        {
+            enabled[count++] = (LoadKind)k;
+        }
+    }
+    return enabled[n % count];
+}
+
+/* Sends one request from slot; gStackLock held */
+static bool sendRequest(LoadThread *thread, LoadSlot *slot, uint64_t startNs)
+{
+    uint64_t n = thread->sent * gConfig.threads + thread->index;
+    const BenchTarget *target = &gTargets[n % gTargetList.count];
+    slot->kind = getNextKind(n / gTargetList.count);
+
+    char uri[MAX_URI_LENGTH + 32];
+    snprintf(uri, sizeof(uri), "%s%s", target->uri, gKindQueries[slot->kind]);
+
+    OCCallbackData cbData = { slot, responseCb, NULL };
+    OCMethod method = (slot->kind == LOAD_OBSERVE) ? OC_REST_OBSERVE : OC_REST_GET;
+    slot->startNs = startNs;
+    slot->state = SLOT_PENDING;
+    OCStackResult result = OCDoResource(&slot->handle, method, uri, &target->addr, NULL,
+            CT_DEFAULT, OC_LOW_QOS, &cbData, NULL, 0);
+    thread->sent++;
+    if (result != OC_STACK_OK)
+    {
+        thread->errors[slot->kind]++;
+        slot->state = SLOT_FREE;
+        slot->handle = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* Records the answered requests, cancels the observations they registered
+ * and gives up on the ones past the timeout; gStackLock held. Returns the
+ * number of slots in use. */
+static size_t collectResponses(LoadThread *thread, uint64_t now)
+{
+    size_t busy = 0;
+    for (size_t i = 0; i < thread->window; i++)
+    {
+        LoadSlot *slot = &thread->slots[i];
+        if (slot->state == SLOT_DONE)
+        {
+            if (slot->result > OC_STACK_RESOURCE_CHANGED)
+            {
+                thread->errors[slot->kind]++;
+            }
+            else
+            {
+                addLatency(&thread->latency[slot->kind], slot->doneNs - slot->startNs);
+            }
+            if (slot->kind == LOAD_OBSERVE)
+            {
+                OCCancel(slot->handle, OC_LOW_QOS, NULL, 0);
+            }
+            slot->state = SLOT_FREE;
+            slot->handle = NULL;
+        }
+        else if (slot->state == SLOT_PENDING
+                 && now - slot->startNs > gConfig.timeoutMs * 1000000ull)
+        {
+            thread->timeouts[slot->kind]++;
+            OCCancel(slot->handle, OC_LOW_QOS, NULL, 0);
+            slot->state = SLOT_FREE;
+            slot->handle = NULL;
+        }
+        busy += (slot->state != SLOT_FREE) ? 1 : 0;
+    }
+    return busy;
+}
+
+static void *loadThread(void *data)
+{
+    LoadThread *thread = (LoadThread *)data;
+    // Threads are staggered over one interval
+    uint64_t start = gStartNs + (uint64_t)(thread->intervalNs * thread->index / gConfig.threads);
+    uint64_t scheduled = 0;         // requests due so far, with a rate
+
+    pthread_mutex_lock(&gStackLock);
+    while (!gQuit)
+    {
+        uint64_t now = nowNs();
+        size_t busy = collectResponses(thread, now);
+        if (now >= gEndNs)
+        {
+            if (busy == 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            bool sent = false;
+            for (size_t i = 0; i < thread->window && busy < thread->window; i++)
+            {
+                if (thread->slots[i].state != SLOT_FREE)
+                {
+                    continue;
+                }
+                uint64_t startNs = now;
+                if (thread->intervalNs > 0)
+                {
+                    startNs = start + (uint64_t)(scheduled * thread->intervalNs);
+                    if (startNs > now)
+                    {
+                        break;
+                    }
+                    scheduled++;
+                }
+                busy += sendRequest(thread, &thread->slots[i], startNs) ? 1 : 0;
+                sent = true;
+            }
+            if (sent)
+            {
+                wakeMainLoop();
+            }
+        }
+
+        // Until a response, the next scheduled request or the next timeout check
+        uint64_t wake = now + LOADGEN_POLL_MS * 1000000ull;
+        if (thread->intervalNs > 0 && now < gEndNs && busy < thread->window)
+        {
+            uint64_t next = start + (uint64_t)(scheduled * thread->intervalNs);
+            if (next < wake)
+            {
+                wake = (next > now) ? next : now;
+            }
+        }
+        struct timespec deadline;
+        getDeadline(wake, &deadline);
+        if (wake > now)
+        {
+            pthread_cond_timedwait(&thread->cond, &gStackLock, &deadline);
+        }
+    }
+
+    // Whatever is still outstanding after a SIGINT is not counted
+    for (size_t i = 0; i < thread->window; i++)
+    {
+        if (thread->slots[i].state != SLOT_FREE)
+        {
+            OCCancel(thread->slots[i].handle, OC_LOW_QOS, NULL, 0);
+            thread->slots[i].state = SLOT_FREE;
+        }
+    }
+    pthread_mutex_unlock(&gStackLock);
+    return NULL;
+}
+
+/* Runs the stack until *stop is set or until untilNs */
+static void runStack(const std::atomic<bool> *stop, uint64_t untilNs)
+{
+    while ((!stop || !stop->load()) && nowNs() < untilNs)
+    {
+        uint32_t nextEventTime = LOADGEN_POLL_MS;
+        pthread_mutex_lock(&gStackLock);
+#ifdef WITH_PROCESS_EVENT
+        OCProcessEvent(&nextEventTime);
+#else
+        OCProcess();
+        nextEventTime = 1;
+#endif
+        pthread_mutex_unlock(&gStackLock);
+        if (nextEventTime > LOADGEN_POLL_MS)
+        {
+            nextEventTime = LOADGEN_POLL_MS;
+        }
+        waitMainLoop(nextEventTime);
+    }
+}
+
+static int discoverTargets()
+{
+    char uri[MAX_URI_LENGTH];
+    if (gConfig.host)
+    {
+        snprintf(uri, sizeof(uri), "coap://%s:5683%s?rt=%s", gConfig.host,
+                OC_RSRVD_WELL_KNOWN_URI, BENCH_AM_TYPE);
+    }
+    else
+    {
+        snprintf(uri, sizeof(uri), "%s?rt=%s", OC_MULTICAST_DISCOVERY_URI, BENCH_AM_TYPE);
+    }
+
+    OCCallbackData cbData = { &gTargetList, discoveryCb, NULL };
+    OCDoHandle handle = NULL;
+    pthread_mutex_lock(&gStackLock);
+    OCStackResult result = OCDoResource(&handle, OC_REST_DISCOVER, uri, NULL, NULL, CT_DEFAULT,
+            OC_LOW_QOS, &cbData, NULL, 0);
+    pthread_mutex_unlock(&gStackLock);
+    if (result != OC_STACK_OK)
+    {
+        fprintf(stderr, "Discovery failed: %s\n", getResult(result));
+        return -1;
+    }
+
+    // Every instance of a server comes in one answer; other servers may
+    // answer later, so wait until the answers stop
+    uint64_t end = nowNs() + LOADGEN_DISCOVERY_MS * 1000000ull;
+    size_t known = 0;
+    while (!gQuit && nowNs() < end)
+    {
+        runStack(NULL, nowNs() + LOADGEN_DISCOVERY_QUIET_MS * 1000000ull);
+        pthread_mutex_lock(&gStackLock);
+        size_t found = gTargetList.count;
+        pthread_mutex_unlock(&gStackLock);
+        if (found > 0 && found == known)
+        {
+            break;
+        }
+        known = found;
+    }
+
+    pthread_mutex_lock(&gStackLock);
+    OCCancel(handle, OC_LOW_QOS, NULL, 0);
+    pthread_mutex_unlock(&gStackLock);
+
+    if (gTargetList.count == 0)
+    {
+        fprintf(stderr, "No %s found\n", BENCH_AM_TYPE);
+        return -1;
+    }
+    return 0;
+}
+
+static std::atomic<bool> gLoadDone(false);
+
+static void *loadWaiter(void *data)
+{
+    for (unsigned int t = 0; t < gConfig.threads; t++)
+    {
+        pthread_join(gThreads[t].thread, NULL);
+    }
+    gLoadDone = true;
+    wakeMainLoop();
+    return NULL;
+}
+
+/* Merges the threads' latencies of a kind, or of every kind for
+ * LOAD_KIND_COUNT, sorted */
+static void mergeLatency(int kind, LatencyList *merged)
+{
+    memset(merged, 0, sizeof(LatencyList));
+    for (unsigned int t = 0; t < gConfig.threads; t++)
+    {
+        for (int k = 0; k < LOAD_KIND_COUNT; k++)
+        {
+            if (kind != LOAD_KIND_COUNT && k != kind)
+            {
+                continue;
+            }
+            const LatencyList *list = &gThreads[t].latency[k];
+            for (size_t i = 0; i < list->count; i++)
+            {
+                addLatency(merged, list->ns[i]);
+            }
+        }
+    }
+    qsort(merged->ns, merged->count, sizeof(uint64_t), compareNs);
+}
+
+static void printLatencyJson(const LatencyList *list)
+{
+    printf("\"completed\": %zu, \"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, "
+           "\"max_us\": %.1f", list->count, getPercentileUs(list, 50), getPercentileUs(list, 99),
+           getPercentileUs(list, 99.9), getPercentileUs(list, 100));
+}
+
+/* Prints the report; returns the exit status of the gate */
+static int reportLoad(double elapsed)
+{
+    uint64_t sent = 0;
+    uint64_t errors[LOAD_KIND_COUNT] = { 0 };
+    uint64_t timeouts[LOAD_KIND_COUNT] = { 0 };
+    uint64_t failed = 0;
+    for (unsigned int t = 0; t < gConfig.threads; t++)
+    {
+        sent += gThreads[t].sent;
+        for (int k = 0; k < LOAD_KIND_COUNT; k++)
+        {
+            errors[k] += gThreads[t].errors[k];
+            timeouts[k] += gThreads[t].timeouts[k];
+            failed += gThreads[t].errors[k] + gThreads[t].timeouts[k];
+        }
+    }
+
+    LatencyList all;
+    mergeLatency(LOAD_KIND_COUNT, &all);
+    double throughput = (elapsed > 0) ? all.count / elapsed : 0;
+
+    printf("{\n");
+    printf("  \"host\": \"%s\", \"secure\": %s, \"targets\": %zu,\n",
+            gConfig.host ? gConfig.host : "multicast",
+            (gTargets[0].addr.flags & OC_FLAG_SECURE) ? "true" : "false", gTargetList.count);
+    printf("  \"threads\": %u, \"concurrency\": %zu, \"rate\": %.1f, \"seconds\": %.3f,\n",
+            gConfig.threads, gConfig.concurrency, gConfig.rate, elapsed);
+    printf("  \"sent\": %llu, \"failed\": %llu, \"throughput\": %.1f,\n",
+            (unsigned long long)sent, (unsigned long long)failed, throughput);
+    printf("  \"all\": { ");
+    printLatencyJson(&all);
+    printf(" },\n");
+    printf("  \"kinds\": {");
+    bool first = true;
+    for (int k = 0; k < LOAD_KIND_COUNT; k++)
+    {
+        if (!gConfig.kinds[k])
+        {
+            continue;
+        }
+        LatencyList list;
+        mergeLatency(k, &list);
+        printf("%s\n    \"%s\": { ", first ? "" : ",", gKindNames[k]);
+        printLatencyJson(&list);
+        printf(", \"errors\": %llu, \"timeouts\": %llu }", (unsigned long long)errors[k],
+                (unsigned long long)timeouts[k]);
+        free(list.ns);
+        first = false;
+    }
+    printf("\n  }\n}\n");
+    fflush(stdout);
+
+    double p99 = getPercentileUs(&all, 99);
+    double errorPercent = sent ? 100.0 * failed / sent : 0;
+    fprintf(stderr, "%llu sent, %zu completed (%.1f/s), %llu failed; p50 %.1f us, p99 %.1f us, "
+            "p99.9 %.1f us\n", (unsigned long long)sent, all.count, throughput,
+            (unsigned long long)failed, getPercentileUs(&all, 50), p99,
+            getPercentileUs(&all, 99.9));
+    free(all.ns);
+
+    if (gConfig.gateP99Us > 0
+        && (all.count == 0 || p99 > gConfig.gateP99Us || errorPercent > gConfig.gateErrorPercent))
+    {
+        fprintf(stderr, "Gate failed: p99 %.1f us (limit %.1f), errors %.2f%% (limit %.2f%%)\n",
+                p99, gConfig.gateP99Us, errorPercent, gConfig.gateErrorPercent);
+        return 2;
+    }
+    return 0;
+}
+
+static bool parseKinds(char *list)
+{
+    memset(gConfig.kinds, 0, sizeof(gConfig.kinds));
+    bool any = false;
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+        int k = 0;
+        while (k < LOAD_KIND_COUNT && strcmp(name, gKindNames[k]) != 0)
+        {
+            k++;
+        }
+        if (k == LOAD_KIND_COUNT)
+        {
+            return false;
+        }
+        gConfig.kinds[k] = true;
+        any = true;
+    }
+    return any;
+}
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-a host|multicast] [-t threads] [-c concurrency] [-r rate]\n"
+            "       [-d seconds] [-k kinds] [-T timeout-ms] [-G p99-us[,error-percent]]\n"
+            "       [-D client.dat]\n", name);
+    fprintf(stderr, "  -a  address of the server (default 127.0.0.1), multicast discovers\n");
+    fprintf(stderr, "      every server on the network\n");
+    fprintf(stderr, "  -t  client threads (default 4, at most %d)\n", LOADGEN_MAX_THREADS);
+    fprintf(stderr, "  -c  requests outstanding at once, over all threads (default 32)\n");
+    fprintf(stderr, "  -r  requests per second, 0 sends as fast as -c allows (default 0)\n");
+    fprintf(stderr, "  -d  duration in seconds (default 10)\n");
+    fprintf(stderr, "  -k  mix of batch, ll, baseline and observe, comma separated\n");
+    fprintf(stderr, "      (default batch,ll,baseline)\n");
+    fprintf(stderr, "  -T  a request unanswered after that many ms fails (default %d)\n",
+            LOADGEN_TIMEOUT_MS);
+    fprintf(stderr, "  -G  exit with 2 when the p99 is over p99-us or more than\n");
+    fprintf(stderr, "      error-percent of the requests failed (default 0)\n");
+    fprintf(stderr, "  -D  security database of the client in a secure build\n");
+    fprintf(stderr, "      (default %s)\n", LOADGEN_CLIENT_DB_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+    gClientDbFile = LOADGEN_CLIENT_DB_FILE;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:t:c:r:d:k:T:G:D:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                gConfig.host = (0 == strcmp(optarg, "multicast")) ? NULL : optarg;
+                break;
+            case 't':
+                gConfig.threads = (unsigned int)atoi(optarg);
+                break;
+            case 'c':
+                gConfig.concurrency = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                gConfig.rate = atof(optarg);
+                break;
+            case 'd':
+                gConfig.seconds = atof(optarg);
+                break;
+            case 'k':
+                if (!parseKinds(optarg))
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'T':
+                gConfig.timeoutMs = (uint32_t)atoi(optarg);
+                break;
+            case 'G':
+                if (sscanf(optarg, "%lf,%lf", &gConfig.gateP99Us, &gConfig.gateErrorPercent) < 1)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'D':
+                gClientDbFile = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (gConfig.threads == 0 || gConfig.threads > LOADGEN_MAX_THREADS
+        || gConfig.concurrency < gConfig.threads
+        || gConfig.concurrency > (size_t)gConfig.threads * LOADGEN_MAX_WINDOW
+        || gConfig.seconds <= 0 || gConfig.rate < 0 || gConfig.timeoutMs == 0)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#if IS_SECURE_MODE
+    OCPersistentStorage ps = { benchFopen, fread, fwrite, fclose, unlink };
+    OCRegisterPersistentStorageHandler(&ps);
+#endif
+    if (OCInit(NULL, 0, OC_CLIENT) != OC_STACK_OK)
+    {
+        fprintf(stderr, "OCStack init error\n");
+        return EXIT_FAILURE;
+    }
+    initMainLoopEvent();
+    signal(SIGINT, handleSigInt);
+
+    int status = EXIT_FAILURE;
+    if (discoverTargets() == 0)
+    {
+        fprintf(stderr, "%zu target(s), first %s at %s:%u%s\n", gTargetList.count, gTargets[0].uri,
+                gTargets[0].addr.addr, gTargets[0].addr.port,
+                (gTargets[0].addr.flags & OC_FLAG_SECURE) ? " (secure)" : "");
+
+        uint64_t start = nowNs();
+        gStartNs = start;
+        gEndNs = start + (uint64_t)(gConfig.seconds * 1e9);
+        // Deadlines come from nowNs(), on CLOCK_MONOTONIC: so must the waits
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        for (unsigned int t = 0; t < gConfig.threads; t++)
+        {
+            LoadThread *thread = &gThreads[t];
+            thread->index = t;
+            thread->window = gConfig.concurrency / gConfig.threads
+                    + ((t < gConfig.concurrency % gConfig.threads) ? 1 : 0);
+            thread->intervalNs = (gConfig.rate > 0) ? 1e9 * gConfig.threads / gConfig.rate : 0;
+            for (size_t i = 0; i < LOADGEN_MAX_WINDOW; i++)
+            {
+                thread->slots[i].thread = thread;
+            }
+            pthread_cond_init(&thread->cond, &attr);
+            pthread_create(&thread->thread, NULL, loadThread, thread);
+        }
+        pthread_condattr_destroy(&attr);
+
+        pthread_t waiter;
+        pthread_create(&waiter, NULL, loadWaiter, NULL);
+        runStack(&gLoadDone, UINT64_MAX);
+        pthread_join(waiter, NULL);
+
+        status = reportLoad((nowNs() - start) / 1e9);
+        for (unsigned int t = 0; t < gConfig.threads; t++)
+        {
+            pthread_cond_destroy(&gThreads[t].cond);
+            for (int k = 0; k < LOAD_KIND_COUNT; k++)
+            {
+                free(gThreads[t].latency[k].ns);
+            }
+        }
+    }
+
+    deinitMainLoopEvent();
+    OCStop();
+    return status;
+}
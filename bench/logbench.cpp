@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Measurement Log Benchmark
+// Description: Append throughput and recovery of the log per msync policy
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../measurementlog.h"
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void removeLog(const char *dir)
+{
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0)
+    {
+        fprintf(stderr, "cannot remove %s\n", dir);
+    }
+}
+
+static int runPolicy(const char *base, const char *name, MeasurementLogSync sync,
+        uint32_t syncMs, uint64_t records)
+{
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/%s", base, name);
+    removeLog(dir);
+
+    if (openMeasurementLog(dir, sync, syncMs) != 0)
+    {
+        return -1;
+    }
+
+    int32_t values[MEASUREMENT_VALUE_COUNT];
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        values[v] = 60 + 20 * (int32_t)v;
+    }
+
+    uint64_t retries = 0;
+    double start = nowSec();
+    for (uint64_t seq = 1; seq <= records; seq++)
+    {
+        // Producers never wait inside the log; the benchmark retries instead
+        while (appendMeasurementLog(0, seq, (int64_t)seq * 1000, values) != 0)
+        {
+            retries++;
+            sched_yield();
+        }
+    }
+    double queued = nowSec() - start;
+    closeMeasurementLog();
+    double elapsed = nowSec() - start;
+
+    MeasurementLogStats stats;
+    getMeasurementLogStats(&stats);
+
+    // Recovery: reopening must find every record
+    openMeasurementLog(dir, MLOG_SYNC_NONE, 0);
+    MeasurementLogStats recovered;
+    getMeasurementLogStats(&recovered);
+    closeMeasurementLog();
+
+    printf("%-10s %10.0f rec/s  append %6.0f ns/rec  queue-full %8llu  syncs %7llu  recovered seq %llu %s\n",
+            name, records / elapsed, queued * 1e9 / records, (unsigned long long)retries,
+            (unsigned long long)stats.syncs, (unsigned long long)recovered.lastSeq,
+            (recovered.lastSeq == records) ? "ok" : "MISMATCH");
+    removeLog(dir);
+    return (recovered.lastSeq == records) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *base = (argc > 1) ? argv[1] : "/tmp/bpm-logbench";
+    uint64_t records = (argc > 2) ? strtoull(argv[2], NULL, 10) : 1000000;
+
+    printf("%llu records of %zu bytes, segments of %d records, in %s\n",
+            (unsigned long long)records, sizeof(MeasurementRecord), MLOG_SEGMENT_RECORDS, base);
+
+    mkdir(base, 0755);
+
+    int result = 0;
+    result |= runPolicy(base, "none", MLOG_SYNC_NONE, 0, records);
+    result |= runPolicy(base, "1000ms", MLOG_SYNC_INTERVAL, 1000, records);
+    result |= runPolicy(base, "10ms", MLOG_SYNC_INTERVAL, 10, records);
+    result |= runPolicy(base, "always", MLOG_SYNC_ALWAYS, 0, records / 10);
+    removeLog(base);
+    return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
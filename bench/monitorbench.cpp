@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Monitor Table Benchmark
+// Description: Memory per instance and request cost as instances grow
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "../common.h"
+#include "../device/monitor.h"
+#include "../device/bloodpressure0.h"
+
+/* Results go to stderr: the stack and the resources log to stdout */
+
+#define BENCH_REQUESTS 200000
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int runInstances(size_t count, size_t history)
+{
+    if (OCInit(NULL, 0, OC_SERVER) != OC_STACK_OK)
+    {
+        fprintf(stderr, "OCInit failed\n");
+        return -1;
+    }
+
+    long before = getResidentKb();
+    if (initMonitorTable(count, history) != 0 || createMonitorResources() != 0)
+    {
+        return -1;
+    }
+    long after = getResidentKb();
+
+    // Requests spread over all instances in a fixed pseudo random order
+    const char *queries[] = { "", "if=oic.if.b", "if=oic.if.baseline", "if=oic.if.ll" };
+    uint32_t x = 12345;
+    double lookupNs = 0, handlerNs = 0;
+    for (int r = 0; r < BENCH_REQUESTS; r++)
+    {
+        x = x * 1103515245u + 12345u;
+        BPMonitor *monitor = getMonitor((x >> 8) % count);
+
+        // What the stack does first for every request: find the resource
+        double t0 = nowNs();
+        OCResourceHandle handle = OCGetResourceHandleAtUri(monitor->amUri);
+        double t1 = nowNs();
+
+        OCEntityHandlerRequest request;
+        memset(&request, 0, sizeof(request));
+        request.resource = handle;
+        request.method = OC_REST_GET;
+        request.query = (char *)queries[r & 3];
+        OCGetResourceHandler(handle)(OC_REQUEST_FLAG, &request, monitor);
+        double t2 = nowNs();
+
+        lookupNs += t1 - t0;
+        handlerNs += t2 - t1;
+    }
+
+    fprintf(stderr, "%6zu instances  %8.1f kB/instance  lookup %8.0f ns  handler %6.0f ns\n",
+            count, (double)(after - before) / count, lookupNs / BENCH_REQUESTS,
+            handlerNs / BENCH_REQUESTS);
+    OCStop();
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t max = (argc > 1) ? strtoul(argv[1], NULL, 10) : MONITOR_MAX_INSTANCES;
+    size_t history = (argc > 2) ? strtoul(argv[2], NULL, 10) : 0;
+
+    fprintf(stderr, "%d GET requests per run, history of %zu samples per instance\n",
+            BENCH_REQUESTS, history);
+
+    // One process per size, so every run starts from the same heap and stack
+    for (size_t count = 1; count <= max; count *= 4)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            exit(runInstances(count, history) ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
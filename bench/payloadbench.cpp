@@ -0,0 +1,420 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Payload Benchmark
+// Description: ns, allocations and bytes per call of the GET and payload paths
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "../common.h"
+#include "../query.h"
+#include "../arena.h"
+#include "../device/monitor.h"
+#include "../device/bloodpressure0.h"
+
+/* Drives the Atomic Measurement's request path directly, with synthetic
+ * requests and no network. malloc and friends are interposed: calls made
+ * by the measured function, the stack's included, are counted with the
+ * bytes asked for. Each case runs a few rounds and keeps the fastest, the
+ * least disturbed by the rest of the machine.
+ *
+ * The requests carry no request handle, so OCDoResponse() returns at its
+ * first check: the response paths are measured up to the stack, not the
+ * stack's encoding and send. Results go to stderr, as the stack logs to
+ * stdout. */
+
+#define BENCH_ITERATIONS    100000
+#define BENCH_ROUNDS        5
+#define BENCH_HISTORY       1000
+#define BENCH_CLOCK_SCALE   1e6
+#define BENCH_MERGED_SAMPLES 10     // published per merged notification round
+
+// Internals of bloodpressure0.cpp, built in with device_src
+OCRepPayload *getBP0Payload(BPMonitor *monitor, const ParsedQuery *query,
+        OCEntityHandlerResult *ehResult);
+OCRepPayload *getBP0HistoryPayload(BPMonitor *monitor, const ParsedQuery *query, Arena *arena,
+        OCEntityHandlerResult *ehResult);
+OCEntityHandlerResult sendBP0Response(OCRequestHandle requestHandle,
+        OCEntityHandlerResult ehResult, OCRepPayload *payload);
+OCEntityHandlerResult ProcessBP0GetRequest(BPMonitor *monitor, OCRequestHandle requestHandle,
+        const char *query, bool respondToErrors);
+void notifyBP0Observers(void *ctx);
+void startObserve(BPMonitor *monitor, OCObservationId obsId, const char *query);
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+typedef struct ALLOCCOUNT {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t frees;
+} AllocCount;
+
+typedef struct BENCHCASE {
+    const char *name;
+    const char *query;              // or the observers of a notification case
+    void (*run)(const struct BENCHCASE *bench);
+    void (*prepare)(const struct BENCHCASE *bench);     // before the clock, may be NULL
+} BenchCase;
+
+static __thread bool tCounting = false;
+static __thread AllocCount tAllocs;
+
+static BPMonitor *gMonitor = NULL;
+static ParsedQuery gParsed;
+static long gIterations = BENCH_ITERATIONS;
+static OCRepPayload **gPrepared = NULL;
+
+/* Counted only between startCounting() and stopCounting() */
+extern "C" void *malloc(size_t size)
+{
+    if (tCounting)
+    {
+        tAllocs.calls++;
+        tAllocs.bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (tCounting)
+    {
+        tAllocs.calls++;
+        tAllocs.bytes += count * size;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    if (tCounting)
+    {
+        tAllocs.calls++;
+        tAllocs.bytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    if (tCounting && ptr)
+    {
+        tAllocs.frees++;
+    }
+    __libc_free(ptr);
+}
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void startCounting()
+{
+    tAllocs.calls = 0;
+    tAllocs.bytes = 0;
+    tAllocs.frees = 0;
+    tCounting = true;
+}
+
+static void stopCounting()
+{
+    tCounting = false;
+}
+
+/* getBP0Payload() under the response lock, as a request holds it */
+static void runGetPayload(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        OCEntityHandlerResult ehResult;
+        pthread_mutex_lock(&gMonitor->responseLock);
+        getBP0Payload(gMonitor, &gParsed, &ehResult);
+        pthread_mutex_unlock(&gMonitor->responseLock);
+    }
+}
+
+/* A time range body, built and destroyed per request */
+static void runHistoryPayload(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        OCEntityHandlerResult ehResult;
+        OCRepPayloadDestroy(getBP0HistoryPayload(gMonitor, &gParsed, NULL, &ehResult));
+    }
+}
+
+/* The same body in the thread's arena, dropped by its reset */
+static void runArenaHistoryPayload(const BenchCase *bench)
+{
+    Arena *arena = getResponseArena();
+    for (long i = 0; i < gIterations; i++)
+    {
+        OCEntityHandlerResult ehResult;
+        getBP0HistoryPayload(gMonitor, &gParsed, arena, &ehResult);
+        resetArena(arena);
+    }
+}
+
+/* The send step with a cached body: the OCEntityHandlerResponse setup */
+static void runSendResponse(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        pthread_mutex_lock(&gMonitor->responseLock);
+        sendBP0Response(NULL, OC_EH_OK, gMonitor->baselinePayload);
+        pthread_mutex_unlock(&gMonitor->responseLock);
+    }
+}
+
+static void runProcessGet(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        ProcessBP0GetRequest(gMonitor, NULL, bench->query, false);
+    }
+}
+
+/* The whole entity handler, from a stack request; the worker pool is not
+ * running, so every GET is answered inline */
+static void runEntityHandler(const BenchCase *bench)
+{
+    OCEntityHandler handler = OCGetResourceHandler(gMonitor->amHandle);
+    OCEntityHandlerRequest request;
+    memset(&request, 0, sizeof(request));
+    request.resource = gMonitor->amHandle;
+    request.method = OC_REST_GET;
+    request.query = (char *)bench->query;
+    for (long i = 0; i < gIterations; i++)
+    {
+        handler(OC_REQUEST_FLAG, &request, gMonitor);
+    }
+}
+
+static void runLinkedHandler(const BenchCase *bench)
+{
+    OCEntityHandler handler = OCGetResourceHandler(gMonitor->linkHandles[0]);
+    OCEntityHandlerRequest request;
+    memset(&request, 0, sizeof(request));
+    request.resource = gMonitor->linkHandles[0];
+    request.method = OC_REST_GET;
+    request.query = (char *)bench->query;
+    for (long i = 0; i < gIterations; i++)
+    {
+        handler(OC_REQUEST_FLAG, &request, gMonitor);
+    }
+}
+
+/* Bodies built like the uncached ones, for the destruction case */
+static void prepareHistoryPayloads(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        OCEntityHandlerResult ehResult;
+        gPrepared[i] = getBP0HistoryPayload(gMonitor, &gParsed, NULL, &ehResult);
+    }
+}
+
+/* Time range requests answered with the arenas off */
+static void useHeap(const BenchCase *bench)
+{
+    setResponseArenaSize(0);
+}
+
+/* Observers of the batch body, in addition to the ones already there */
+static void addBatchObservers(const BenchCase *bench)
+{
+    ParsedQuery query;
+    parseQuery("pmin=0.05", &query);
+    clearObservers(&gMonitor->observers);
+    for (long i = 0; i < atol(bench->query); i++)
+    {
+        addObserver(&gMonitor->observers, (OCObservationId)(i + 1), &query, 0, 0);
+    }
+}
+
+/* Observers of a time range, getting merged notifications. No scheduler
+ * runs here: the notifier task is not started and the bench calls it. */
+static void addMergedObservers(const BenchCase *bench)
+{
+    clearObservers(&gMonitor->observers);
+    for (long i = 0; i < atol(bench->query); i++)
+    {
+        startObserve(gMonitor, (OCObservationId)(i + 1), "since=0&pmin=0.05");
+    }
+}
+
+/* Publishes sample number i: values that change a little from one to the next */
+static void publishBenchSample(long i, BPMeasurement *sample)
+{
+    int32_t values[MEASUREMENT_VALUE_COUNT];
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        values[v] = 120 - 25 * (int32_t)v + (int32_t)(i % (7 - 2 * (long)(v % 3)));
+    }
+    publishMeasurement(&gMonitor->snapshot, values, sample);
+}
+
+/* Several samples per round, all of them in the merged body */
+static void runMergedNotify(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        for (int j = 0; j < BENCH_MERGED_SAMPLES; j++)
+        {
+            BPMeasurement sample;
+            publishBenchSample(j, &sample);
+            appendHistory(&gMonitor->history, &sample);
+        }
+        notifyBP0Observers(gMonitor);
+    }
+}
+
+/* A new sample per round of notifications; every observer is due, as the
+ * virtual clock runs far ahead of pmin between two calls */
+static void runNotify(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        BPMeasurement sample;
+        publishBenchSample(i, &sample);
+        notifyBP0Observers(gMonitor);
+    }
+}
+
+static void runDestroy(const BenchCase *bench)
+{
+    for (long i = 0; i < gIterations; i++)
+    {
+        OCRepPayloadDestroy(gPrepared[i]);
+    }
+}
+
+static const BenchCase gCases[] = {
+    { "getBP0Payload batch", "", runGetPayload, NULL },
+    { "getBP0Payload batch rt subset", "rt=oic.r.pulserate", runGetPayload, NULL },
+    { "getBP0Payload baseline", "if=oic.if.baseline", runGetPayload, NULL },
+    { "getBP0Payload ll", "if=oic.if.ll", runGetPayload, NULL },
+    { "getBP0HistoryPayload limit 100 heap", "since=0&limit=100", runHistoryPayload, NULL },
+    { "getBP0HistoryPayload limit 100 arena", "since=0&limit=100", runArenaHistoryPayload, NULL },
+    { "sendBP0Response", "", runSendResponse, NULL },
+    { "ProcessBP0GetRequest batch", "", runProcessGet, NULL },
+    { "ProcessBP0GetRequest baseline", "if=oic.if.baseline", runProcessGet, NULL },
+    { "ProcessBP0GetRequest ll", "if=oic.if.ll", runProcessGet, NULL },
+    { "ProcessBP0GetRequest forbidden", "if=oic.if.s", runProcessGet, NULL },
+    { "ProcessBP0GetRequest history 10 heap", "since=0&limit=10", runProcessGet, useHeap },
+    { "ProcessBP0GetRequest history 10 arena", "since=0&limit=10", runProcessGet, NULL },
+    { "entity handler batch", "if=oic.if.b", runEntityHandler, NULL },
+    { "entity handler linked", "", runLinkedHandler, NULL },
+    { "notifyBP0Observers 1 observer", "1", runNotify, addBatchObservers },
+    { "notifyBP0Observers 100 observers", "100", runNotify, addBatchObservers },
+    { "notifyBP0Observers 250 observers", "250", runNotify, addBatchObservers },
+    { "notifyBP0Observers 100 merged", "100", runMergedNotify, addMergedObservers },
+    { "OCRepPayloadDestroy history 100", "since=0&limit=100", runDestroy,
+      prepareHistoryPayloads },
+};
+
+static void runCase(const BenchCase *bench)
+{
+    parseQuery(bench->query, &gParsed);
+    setResponseArenaSize(ARENA_DEFAULT_SIZE);
+
+    // Warm up the caches and the allocator
+    long iterations = gIterations;
+    gIterations = iterations / 10 + 1;
+    if (bench->prepare)
+    {
+        bench->prepare(bench);
+    }
+    bench->run(bench);
+    gIterations = iterations;
+
+    double best = 0;
+    AllocCount allocs = { 0, 0, 0 };
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        if (bench->prepare)
+        {
+            bench->prepare(bench);
+        }
+        startCounting();
+        double start = nowNs();
+        bench->run(bench);
+        double ns = nowNs() - start;
+        stopCounting();
+        if (round == 0 || ns < best)
+        {
+            best = ns;
+        }
+        allocs = tAllocs;
+    }
+    fprintf(stderr, "%-36s %10.1f %10.2f %10.1f %10.2f\n", bench->name, best / gIterations,
+            (double)allocs.calls / gIterations, (double)allocs.bytes / gIterations,
+            (double)allocs.frees / gIterations);
+}
+
+int main(int argc, char *argv[])
+{
+    gIterations = (argc > 1) ? atol(argv[1]) : BENCH_ITERATIONS;
+    const char *filter = (argc > 2) ? argv[2] : NULL;
+    if (gIterations <= 0)
+    {
+        fprintf(stderr, "Usage: %s [iterations] [case-substring]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (OCInit(NULL, 0, OC_SERVER) != OC_STACK_OK)
+    {
+        fprintf(stderr, "OCInit failed\n");
+        return EXIT_FAILURE;
+    }
+    // Far enough ahead between two notification rounds to pass any pmin
+    setClockScale(BENCH_CLOCK_SCALE);
+    if (initMonitorTable(1, BENCH_HISTORY) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    gMonitor = getMonitor(0);
+    for (int i = 0; i < BENCH_HISTORY; i++)
+    {
+        BPMeasurement sample;
+        publishBenchSample(i, &sample);
+        appendHistory(&gMonitor->history, &sample);
+    }
+    if (createMonitorResources() != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    gPrepared = (OCRepPayload **)calloc(gIterations, sizeof(OCRepPayload *));
+    if (!gPrepared)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%ld calls per round, best of %d rounds\n", gIterations, BENCH_ROUNDS);
+    fprintf(stderr, "%-36s %10s %10s %10s %10s\n", "case", "ns/op", "allocs/op", "bytes/op",
+            "frees/op");
+    for (size_t i = 0; i < sizeof(gCases) / sizeof(gCases[0]); i++)
+    {
+        if (!filter || strstr(gCases[i].name, filter))
+        {
+            runCase(&gCases[i]);
+        }
+    }
+
+    free(gPrepared);
+    OCStop();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Query Parser Benchmark
+// Description: Parse and dispatch cost per request, against the old strcmp chain
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../query.h"
+#include "../device/bpmresources.h"
+
+// Dispatch targets of the Atomic Measurement's GET
+enum {
+    TARGET_BATCH = 0,
+    TARGET_BASELINE,
+    TARGET_LL,
+    TARGET_HISTORY,
+    TARGET_SUBSET,
+    TARGET_REJECT
+};
+
+static const char *gTargetNames[] = { "batch", "baseline", "ll", "history", "subset", "reject" };
+
+typedef struct QUERYCASE {
+    const char *query;
+    int expected;
+} QueryCase;
+
+// The Atomic Measurement with one more link, of a type the query parser does
+// not know: an rt query of it is matched by name
+static constexpr const char *gWeightTypes[] = { "x.org.example.body.weight" };
+static constexpr ResourceDesc gWeightResource = {
+    "/myWeightResURI",
+    gWeightTypes, countOf(gWeightTypes),
+    nullptr, 0,
+    nullptr, 0,
+    nullptr, 0,
+    OC_OBSERVABLE
+};
+static constexpr LinkDesc gBenchLinks[] = {
+    gBPMLinks[0],
+    gBPMLinks[1],
+    { &gWeightResource, false }
+};
+static constexpr ResourceDesc gBenchResource = {
+    "/BloodPressureMonitorAMResURI",
+    gBPMTypes, countOf(gBPMTypes),
+    gBPMInterfaces, countOf(gBPMInterfaces),
+    nullptr, 0,
+    gBenchLinks, countOf(gBenchLinks),
+    OC_DISCOVERABLE | OC_OBSERVABLE
+};
+
+static uint32_t gRtLinkMasks[QUERY_RT_UNKNOWN + 1];
+
+static const QueryCase gCases[] = {
+    { "", TARGET_BATCH },
+    { "if=oic.if.b", TARGET_BATCH },
+    { "if=oic.if.baseline", TARGET_BASELINE },
+    { "if=oic.if.ll", TARGET_LL },
+    { "if=oic.if.baseline&pmin=1", TARGET_BASELINE },
+    { "pmin=0.5;if=oic.if.ll", TARGET_LL },
+    { "if=oic.if.b&rt=oic.r.pulserate", TARGET_SUBSET },
+    { "rt=oic.r.foo", TARGET_REJECT },
+    { "rt=x.org.example.body.weight", TARGET_SUBSET },
+    { "if=oic.if.s", TARGET_REJECT },
+    { "since=1500000000000&limit=100", TARGET_HISTORY },
+};
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The dispatch the Atomic Measurement used before the parser */
+static const char *findParam(const char *query, const char *name)
+{
+    size_t nameLen = strlen(name);
+    const char *p = query;
+    while (p && *p) {
+        if (0 == strncmp(p, name, nameLen) && p[nameLen] == '=') {
+            return p + nameLen + 1;
+        }
+        p = strpbrk(p, "&;");
+        if (p) {
+            p++;
+        }
+    }
+    return NULL;
+}
+
+static int dispatchStrcmp(const char *query)
+{
+    if (findParam(query, "since") || findParam(query, "limit")) {
+        return TARGET_HISTORY;
+    }
+    else if (strcmp(query, "if=oic.if.baseline") == 0) {
+        return TARGET_BASELINE;
+    }
+    else if (strcmp(query, "if=oic.if.ll") == 0) {
+        return TARGET_LL;
+    }
+    else if (strcmp(query, "if=oic.if.b") != 0 && strncmp(query, "if=", 3) == 0) {
+        return TARGET_REJECT;
+    }
+    else if (strncmp(query, "rt=", 3) == 0) {
+        return TARGET_REJECT;
+    }
+    return TARGET_BATCH;
+}
+
+/* The Atomic Measurement's own selection, selectQueryTarget() */
+static int dispatchParsed(const char *query)
+{
+    ParsedQuery parsed;
+    if (!parseQuery(query, &parsed)) {
+        return TARGET_REJECT;
+    }
+    uint32_t linkMask = 0;
+    switch (selectQueryTarget(&gBenchResource, gRtLinkMasks, &parsed, &linkMask)) {
+    case QUERY_TARGET_BATCH:
+        return (linkMask == (1u << countOf(gBenchLinks)) - 1) ? TARGET_BATCH : TARGET_SUBSET;
+    case QUERY_TARGET_BASELINE:
+        return TARGET_BASELINE;
+    case QUERY_TARGET_LL:
+        return TARGET_LL;
+    case QUERY_TARGET_HISTORY:
+        return TARGET_HISTORY;
+    default:
+        return TARGET_REJECT;
+    }
+}
+
+static double timeDispatch(int (*dispatch)(const char *), const char *query, long iterations)
+{
+    volatile int sink = 0;
+    double start = nowSec();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += dispatch(query);
+    }
+    (void)sink;
+    return (nowSec() - start) * 1e9 / iterations;
+}
+
+/* Every known name must come back from the hash as itself */
+static int checkNames()
+{
+    int failures = 0;
+    for (int i = QUERY_IF_NONE + 1; i < QUERY_IF_UNKNOWN; i++)
+    {
+        const char *name = getQueryInterfaceName((QueryInterface)i);
+        if (lookupQueryInterface(name, strlen(name)) != i)
+        {
+            fprintf(stderr, "interface %s does not hash to itself\n", name);
+            failures++;
+        }
+    }
+    for (int i = QUERY_RT_NONE + 1; i < QUERY_RT_UNKNOWN; i++)
+    {
+        const char *name = getQueryResourceTypeName((QueryResourceType)i);
+        if (lookupQueryResourceType(name, strlen(name)) != i)
+        {
+            fprintf(stderr, "resource type %s does not hash to itself\n", name);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[])
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 2000000;
+    int failures = checkNames();
+    initRtLinkMasks(&gBenchResource, gRtLinkMasks);
+
+    printf("%-34s %10s %10s %10s %10s\n", "query", "strcmp", "ns/req", "parser", "ns/req");
+    for (size_t i = 0; i < sizeof(gCases) / sizeof(gCases[0]); i++)
+    {
+        const QueryCase *c = &gCases[i];
+        int old = dispatchStrcmp(c->query);
+        int parsed = dispatchParsed(c->query);
+        if (parsed != c->expected)
+        {
+            failures++;
+        }
+
+        double oldNs = timeDispatch(dispatchStrcmp, c->query, iterations);
+        double parsedNs = timeDispatch(dispatchParsed, c->query, iterations);
+        printf("%-34s %10s %10.1f %10s %10.1f%s\n", c->query[0] ? c->query : "(none)",
+                gTargetNames[old], oldNs, gTargetNames[parsed], parsedNs,
+                (parsed != c->expected) ? "  WRONG" : "");
+    }
+
+    return failures ? 1 : 0;
+}
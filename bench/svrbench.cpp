@@ -0,0 +1,228 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] SVR Store Benchmark
+// Description: Onboarding time and fsyncs, plain file vs in-memory store
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../svrstore.h"
+
+/* An onboarding is replayed as the stack does it through OCPersistentStorage:
+ * each SVR update (doxm owned, device owner, pstat, credentials, ACLs, ...)
+ * reads the whole database and writes the whole database back. BENCH_UPDATES
+ * is about what a just works ownership transfer followed by provisioning of
+ * one credential and one ACL makes. The onboardings follow each other further
+ * apart than the store's window, so each one ends with the flusher's write,
+ * timed on its own as it is off the stack's thread. */
+
+#define BENCH_UPDATES   12
+
+typedef enum {
+    BENCH_FILE,             // fopen() in place, as before the store
+    BENCH_FILE_SYNC,        // the same made durable: temporary file, fsync, rename
+    BENCH_STORE
+} BenchMode;
+
+typedef struct BENCHRESULT {
+    double onboardUs;       // stack's time per onboarding
+    double flushUs;         // flusher's time per onboarding
+    double fsyncs;          // per onboarding
+    double flushes;         // per onboarding
+} BenchResult;
+
+static char gImage[64 * 1024];
+static size_t gImageSize;
+static const char *gDir;
+static unsigned long long gFsyncs;
+
+static double nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* An update's read of the database, then its write of a changed one */
+static bool updateOnce(BenchMode mode, const char *path, unsigned int update)
+{
+    char buffer[sizeof(gImage)];
+    FILE *fp = (mode == BENCH_STORE) ? openSvrStoreFile("rb") : fopen(path, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+    size_t size = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+    if (size == 0)
+    {
+        return false;
+    }
+    // The change itself does not matter, only that the bytes differ
+    buffer[update % size] ^= 1;
+
+    if (mode == BENCH_STORE)
+    {
+        fp = openSvrStoreFile("wb");
+        bool ok = fp && fwrite(buffer, 1, size, fp) == size;
+        return (fp && fclose(fp) == 0) && ok;
+    }
+
+    char temporary[600];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    fp = fopen((mode == BENCH_FILE_SYNC) ? temporary : path, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = fwrite(buffer, 1, size, fp) == size;
+    if (mode == BENCH_FILE_SYNC)
+    {
+        ok = (fflush(fp) == 0) && (fsync(fileno(fp)) == 0) && ok;
+        gFsyncs++;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (mode == BENCH_FILE_SYNC && ok)
+    {
+        ok = (rename(temporary, path) == 0);
+        int fd = open(gDir, O_RDONLY | O_DIRECTORY);
+        if (fd >= 0)
+        {
+            ok = (fsync(fd) == 0) && ok;
+            gFsyncs++;
+            close(fd);
+        }
+    }
+    return ok;
+}
+
+static bool resetDatabase(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = fwrite(gImage, 1, gImageSize, fp) == gImageSize;
+    return (fclose(fp) == 0) && ok;
+}
+
+static bool runMode(BenchMode mode, uint32_t flushMs, const char *path,
+        unsigned int onboardings, BenchResult *result)
+{
+    if (!resetDatabase(path))
+    {
+        fprintf(stderr, "cannot write %s\n", path);
+        return false;
+    }
+    if (mode == BENCH_STORE && openSvrStore(path, flushMs) != 0)
+    {
+        return false;
+    }
+    gFsyncs = 0;
+
+    double onboardUs = 0;
+    double flushUs = 0;
+    bool ok = true;
+    for (unsigned int i = 0; i < onboardings && ok; i++)
+    {
+        double start = nowUs();
+        for (unsigned int update = 0; update < BENCH_UPDATES && ok; update++)
+        {
+            ok = updateOnce(mode, path, i * BENCH_UPDATES + update);
+        }
+        onboardUs += nowUs() - start;
+
+        if (mode == BENCH_STORE)
+        {
+            // What the flusher does once the window is over
+            start = nowUs();
+            ok = (flushSvrStore() == 0) && ok;
+            flushUs += nowUs() - start;
+        }
+    }
+
+    SvrStoreStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (mode == BENCH_STORE)
+    {
+        getSvrStoreStats(&stats);
+        closeSvrStore();
+    }
+    else
+    {
+        stats.fsyncs = gFsyncs;
+        stats.flushes = (unsigned long long)onboardings * BENCH_UPDATES;
+    }
+    result->onboardUs = onboardUs / onboardings;
+    result->flushUs = flushUs / onboardings;
+    result->fsyncs = (double)stats.fsyncs / onboardings;
+    result->flushes = (double)stats.flushes / onboardings;
+    return ok;
+}
+
+static void printResult(const char *name, const BenchResult *result)
+{
+    printf("%-12s %12.1f %12.2f %12.1f %10.1f %10.1f\n", name, result->onboardUs,
+            result->onboardUs / BENCH_UPDATES, result->flushUs, result->flushes,
+            result->fsyncs);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int onboardings = (argc > 1) ? (unsigned int)atoi(argv[1]) : 50;
+    gDir = (argc > 2) ? argv[2] : "/tmp";
+    const char *source = (argc > 3) ? argv[3] : "server.dat";
+    if (onboardings == 0)
+    {
+        fprintf(stderr, "Usage: %s [onboardings] [dir] [svr-database]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(source, "rb");
+    if (in)
+    {
+        gImageSize = fread(gImage, 1, sizeof(gImage), in);
+        fclose(in);
+    }
+    if (gImageSize == 0)
+    {
+        // No database at hand: one of a provisioned device's size
+        gImageSize = 2048;
+        for (size_t i = 0; i < gImageSize; i++)
+        {
+            gImage[i] = (char)(i * 31);
+        }
+        source = "generated";
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/svrbench.dat", gDir);
+    printf("%u onboardings of %d updates, %zu byte database (%s), in %s\n",
+            onboardings, BENCH_UPDATES, gImageSize, source, gDir);
+    printf("%-12s %12s %12s %12s %10s %10s\n", "mode", "onboard us", "update us",
+            "flush us", "writes", "fsyncs");
+
+    BenchResult result;
+    if (runMode(BENCH_FILE, 0, path, onboardings, &result))
+    {
+        printResult("file", &result);
+    }
+    if (runMode(BENCH_FILE_SYNC, 0, path, onboardings, &result))
+    {
+        printResult("file+fsync", &result);
+    }
+    if (runMode(BENCH_STORE, 0, path, onboardings, &result))
+    {
+        printResult("store 0", &result);
+    }
+    if (runMode(BENCH_STORE, SVRSTORE_DEFAULT_FLUSH_MS, path, onboardings, &result))
+    {
+        printResult("store", &result);
+    }
+    unlink(path);
+    return 0;
+}
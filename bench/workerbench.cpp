@@ -0,0 +1,190 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Worker Pool Benchmark
+// Description: Head-of-line blocking of a mixed slow/fast load, inline vs pool
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "../workers.h"
+#include "../common.h"
+
+/* One dispatch thread plays the OCProcess() thread: requests arrive on a
+ * fixed schedule and it either serves each one itself or hands it to the
+ * worker pool, as the Atomic Measurement's entity handler does. A fast
+ * request costs a few microseconds of CPU, a slow one blocks like a sensor
+ * read. Latency is from arrival to completion.
+ *
+ * The stack lock is taken as the server takes it: the dispatcher holds it
+ * for each OCProcess() round, a fast request is built and sent under it
+ * like a cached body, and a slow one waits without it and then holds it for
+ * the send only, like a time range body. */
+
+#define BENCH_ARRIVAL_US    1000
+#define BENCH_FAST_US       20
+#define BENCH_SEND_US       5       // OCDoResponse(): encode and send
+
+typedef struct BENCHREQUEST {
+    uint64_t arrivalNs;
+    uint64_t doneNs;
+    uint32_t serviceUs;
+    bool slow;
+} BenchRequest;
+
+static BenchRequest *gRequests = NULL;
+static size_t gRequestCount = 0;
+static std::atomic<size_t> gDone(0);
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void sleepUntilNs(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ull;
+    ts.tv_nsec = ns % 1000000000ull;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void spinUs(uint32_t us)
+{
+    uint64_t end = nowNs() + us * 1000ull;
+    while (nowNs() < end)
+    {
+    }
+}
+
+/* Serves one request: a fast one computes, a slow one waits on a device;
+ * either sends under the stack lock */
+static void serveRequest(void *ctx)
+{
+    BenchRequest *request = (BenchRequest *)ctx;
+    if (request->slow)
+    {
+        sleepUntilNs(nowNs() + request->serviceUs * 1000ull);
+        lockStack();
+    }
+    else
+    {
+        lockStack();
+        spinUs(request->serviceUs);
+    }
+    spinUs(BENCH_SEND_US);
+    unlockStack();
+    request->doneNs = nowNs();
+    gDone++;
+}
+
+static int compareNs(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void reportLatency(const char *mode, const char *kind, bool slow)
+{
+    uint64_t *latency = (uint64_t *)malloc(gRequestCount * sizeof(uint64_t));
+    size_t n = 0;
+    for (size_t i = 0; i < gRequestCount; i++)
+    {
+        if (gRequests[i].slow == slow)
+        {
+            latency[n++] = gRequests[i].doneNs - gRequests[i].arrivalNs;
+        }
+    }
+    if (n > 0)
+    {
+        qsort(latency, n, sizeof(uint64_t), compareNs);
+        printf("%-8s %-5s %7zu %10.3f %10.3f %10.3f %10.3f\n", mode, kind, n,
+                latency[n / 2] / 1e6, latency[n * 90 / 100] / 1e6, latency[n * 99 / 100] / 1e6,
+                latency[n - 1] / 1e6);
+    }
+    free(latency);
+}
+
+/* Plays the arrival schedule; with a running pool every request is handed
+ * over, and served inline only when the pool's queue is full */
+static void runLoad(const char *mode, bool pooled, unsigned int slowPercent, uint32_t slowMs)
+{
+    uint32_t x = 12345;
+    for (size_t i = 0; i < gRequestCount; i++)
+    {
+        x = x * 1103515245u + 12345u;
+        gRequests[i].slow = ((x >> 8) % 100) < slowPercent;
+        gRequests[i].serviceUs = gRequests[i].slow ? slowMs * 1000 : BENCH_FAST_US;
+    }
+    gDone = 0;
+
+    size_t inlined = 0;
+    uint64_t start = nowNs() + 1000000;
+    for (size_t i = 0; i < gRequestCount; i++)
+    {
+        // A request that arrived while the dispatcher was busy waited for it
+        gRequests[i].arrivalNs = start + i * BENCH_ARRIVAL_US * 1000ull;
+        sleepUntilNs(gRequests[i].arrivalNs);
+
+        // The OCProcess() round that runs the entity handler
+        lockStack();
+        if (!pooled || !submitWork(serveRequest, &gRequests[i]))
+        {
+            serveRequest(&gRequests[i]);
+            inlined += pooled ? 1 : 0;
+        }
+        unlockStack();
+    }
+    while (gDone < gRequestCount)
+    {
+        sleepUntilNs(nowNs() + 1000000);
+    }
+
+    reportLatency(mode, "fast", false);
+    reportLatency(mode, "slow", true);
+    if (pooled)
+    {
+        printf("%-8s %zu request(s) answered inline, queue full\n", mode, inlined);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    gRequestCount = (argc > 1) ? strtoul(argv[1], NULL, 10) : 5000;
+    unsigned int slowPercent = (argc > 2) ? (unsigned int)atoi(argv[2]) : 2;
+    uint32_t slowMs = (argc > 3) ? (uint32_t)atoi(argv[3]) : 20;
+    unsigned int threads = (argc > 4) ? (unsigned int)atoi(argv[4]) : WORKER_DEFAULT_THREADS;
+    if (gRequestCount == 0 || slowPercent > 100)
+    {
+        fprintf(stderr, "Usage: %s [requests] [slow-percent] [slow-ms] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    gRequests = (BenchRequest *)calloc(gRequestCount, sizeof(BenchRequest));
+    if (!gRequests)
+    {
+        return 1;
+    }
+
+    printf("%zu requests, one every %d us: %u%% slow (%u ms), fast %d us, send %d us under "
+            "the stack lock; %u worker(s)\n", gRequestCount, BENCH_ARRIVAL_US, slowPercent,
+            slowMs, BENCH_FAST_US, BENCH_SEND_US, threads);
+    printf("%-8s %-5s %7s %10s %10s %10s %10s\n", "mode", "kind", "count",
+            "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    runLoad("inline", false, slowPercent, slowMs);
+
+    if (startWorkerPool(threads, WORKER_DEFAULT_QUEUE) != 0)
+    {
+        return 1;
+    }
+    runLoad("pool", true, slowPercent, slowMs);
+    stopWorkerPool();
+
+    free(gRequests);
+    return 0;
+}
@@ -17,15 +17,23 @@
 // limitations under the License.
 //
 //-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+#include "iotivity_config.h"
 #include "common.h"
 
 #include "ocstack.h"
 #include "logger.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <time.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #define TAG "sample-common"
 
@@ -93,9 +101,47 @@ void StripNewLineChar(char* str) {
 
 time_t _user_set_time = 0;
 
+// Virtual clock: from the origin on, both clocks advance _clock_scale times
+// faster than real time. A scale of 1 is the plain system clocks.
+static double _clock_scale = 1.0;
+static uint64_t _clock_origin_mono_ns = 0;
+static int64_t _clock_origin_real_ms = 0;
+
+static uint64_t getRealMonotonicNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Virtual nanoseconds elapsed since the origin */
+static uint64_t getVirtualElapsedNs(void) {
+    return (uint64_t)((getRealMonotonicNs() - _clock_origin_mono_ns) * _clock_scale);
+}
+
+/* Milliseconds since the epoch, before the user time offset */
+static int64_t getVirtualRealtimeMs(void) {
+    if (_clock_scale == 1.0) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    }
+    return _clock_origin_real_ms + (int64_t)(getVirtualElapsedNs() / 1000000);
+}
+
+void setClockScale(double scale) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    _clock_origin_real_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    _clock_origin_mono_ns = getRealMonotonicNs();
+    _clock_scale = (scale > 0) ? scale : 1.0;
+}
+
+double getClockScale(void) {
+    return _clock_scale;
+}
+
 void getCurrentTime(char * buf) {
-    time_t now;
-    time(&now);
+    time_t now = (time_t)(getVirtualRealtimeMs() / 1000);
     now -= _user_set_time;    
     struct tm* tm_info;
     tm_info = localtime(&now);
@@ -103,8 +149,7 @@ void getCurrentTime(char * buf) {
 }
 
 void setUserTime(char * buf) {
-    time_t now;
-    time(&now);
+    time_t now = (time_t)(getVirtualRealtimeMs() / 1000);
 
     struct tm _user_time = {0};
     int year, month, day, hour, min, sec, timezone = 0;
@@ -125,3 +170,111 @@ void setUserTime(char * buf) {
     _user_set_time = now - user_time;
 }
 
+
+int64_t getTimestampMs(void) {
+    return getVirtualRealtimeMs() - (int64_t)_user_set_time * 1000;
+}
+
+uint64_t getMonotonicMs(void) {
+    if (_clock_scale == 1.0) {
+        return getRealMonotonicNs() / 1000000;
+    }
+    return (_clock_origin_mono_ns + getVirtualElapsedNs()) / 1000000;
+}
+
+void getMonotonicDeadline(uint64_t ms, struct timespec *deadline) {
+    uint64_t ns;
+    if (_clock_scale == 1.0) {
+        ns = ms * 1000000ull;
+    } else {
+        // Invert getMonotonicMs(): virtual time since the origin, scaled down
+        int64_t elapsed = (int64_t)(ms * 1000000ull) - (int64_t)_clock_origin_mono_ns;
+        ns = _clock_origin_mono_ns + (uint64_t)((elapsed > 0 ? elapsed : 0) / _clock_scale);
+    }
+    deadline->tv_sec = (time_t)(ns / 1000000000ull);
+    deadline->tv_nsec = (long)(ns % 1000000000ull);
+}
+
+long getResidentKb(void) {
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Serializes the calls into the stack, initialized on first use
+static pthread_once_t _stack_lock_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _stack_lock;
+
+static void initStackLock(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&_stack_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void lockStack(void) {
+    pthread_once(&_stack_lock_once, initStackLock);
+    pthread_mutex_lock(&_stack_lock);
+}
+
+void unlockStack(void) {
+    pthread_mutex_unlock(&_stack_lock);
+}
+
+#ifdef WITH_PROCESS_EVENT
+// The stack signals this event whenever it has something for OCProcessEvent()
+static oc_event _main_loop_event = NULL;
+
+void initMainLoopEvent(void) {
+    if (!_main_loop_event) {
+        _main_loop_event = oc_event_new();
+        OCRegisterProcessEvent(_main_loop_event);
+    }
+}
+
+void deinitMainLoopEvent(void) {
+    if (_main_loop_event) {
+        OCRegisterProcessEvent(NULL);
+        oc_event_free(_main_loop_event);
+        _main_loop_event = NULL;
+    }
+}
+
+void wakeMainLoop(void) {
+    if (_main_loop_event) {
+        oc_event_signal(_main_loop_event);
+    }
+}
+
+int waitMainLoop(uint32_t timeoutMs) {
+    if (!_main_loop_event) {
+        return 0;
+    }
+    return (OC_WAIT_SUCCESS == oc_event_wait_for(_main_loop_event, timeoutMs)) ? 1 : 0;
+}
+#else
+// Stack built without WITH_PROCESS_EVENT: nothing can wake the loop early
+void initMainLoopEvent(void) {
+}
+
+void deinitMainLoopEvent(void) {
+}
+
+void wakeMainLoop(void) {
+}
+
+int waitMainLoop(uint32_t timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec  = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+    nanosleep(&timeout, NULL);
+    return 0;
+}
+#endif
@@ -23,6 +23,7 @@
 
 #define USE_HW 0
 #define IS_SECURE_MODE 1
+#include <time.h>
 #include "ocstack.h"
 
 
@@ -35,6 +36,44 @@ void StripNewLineChar(char* str);
 void getCurrentTime(char * buf);
 void setUserTime(char * buf);
 
+/* Milliseconds since the epoch on the same (user adjustable) clock as
+ * getCurrentTime(); used to timestamp measurement samples. */
+int64_t getTimestampMs(void);
+
+/* Milliseconds on a monotonic clock; used for periods and deadlines. */
+uint64_t getMonotonicMs(void);
+
+/* Absolute CLOCK_MONOTONIC deadline, for pthread_cond_timedwait(), at which
+ * getMonotonicMs() reaches ms. */
+void getMonotonicDeadline(uint64_t ms, struct timespec *deadline);
+
+/* Virtual clock for load and soak tests: getTimestampMs(), getMonotonicMs()
+ * and getCurrentTime() run scale times faster than real time from this call
+ * on. Set it before anything starts timing (scheduler, sampler). */
+void setClockScale(double scale);
+double getClockScale(void);
+
+/* Resident set size of the process in kB, from /proc/self/statm */
+long getResidentKb(void);
+
+/* The stack is not thread safe: OCProcess()/OCProcessEvent() and every call
+ * into the stack from another thread (responses of the workers, notifications
+ * of the scheduler) hold this lock. It is recursive, as entity handlers run
+ * inside OCProcess() and respond from there. Take it before any lock of a
+ * resource (responseLock), and never wait for another thread holding it. */
+void lockStack(void);
+void unlockStack(void);
+
+/* Main loop wakeup: lets other threads (e.g. a notifier) cut the main loop's
+ * wait short when they have queued work for OCProcess(). */
+void initMainLoopEvent(void);
+void deinitMainLoopEvent(void);
+void wakeMainLoop(void);
+
+/* Blocks until wakeMainLoop() is called, the stack signals incoming traffic
+ * or timeoutMs elapses. Returns 1 when woken up and 0 on timeout. */
+int waitMainLoop(uint32_t timeoutMs);
+
 #endif //OCSAMPLE_COMMON_H_
 
 
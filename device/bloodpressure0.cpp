@@ -21,7 +21,15 @@
 #include "logger.h"
 #include "ocpayload.h"
 #include "bloodpressure0.h"
+#include "monitor.h"
 #include "../common.h"
+#include "../scheduler.h"
+#include "../observers.h"
+#include "../query.h"
+#include "../workers.h"
+#include "../hotlog.h"
+#include "../metrics.h"
+#include "../arena.h"
 
 #include <time.h>   
 
@@ -31,42 +39,76 @@
 
 #define TAG "SERVER-BLOODPRESSURE-0"
 
+// Longest query a deferred request keeps; longer ones are answered inline
+#define BP0_DEFERRED_QUERY_LENGTH 256
+
+// Most samples one merged notification carries; older ones count as coalesced
+#define BP0_MERGE_MAX_SAMPLES HISTORY_MAX_LIMIT
+
 //-----------------------------------------------------------------------------
 // Typedefs
 //-----------------------------------------------------------------------------
 
-/* Structure to represent a resource */
-typedef struct BLOODPRESSURE0RESOURCE{
-    OCResourceHandle handle;
-} BloodPressure0Resource;
+/* Interfaces an observer can ask for; each gets its own notification body */
+typedef enum {
+    BP0_IF_BATCH = 0,
+    BP0_IF_BASELINE,
+    BP0_IF_LL,
+    BP0_IF_MERGED,              // a time range: every sample since the last notification
+    BP0_IF_COUNT
+} BP0Interface;
+
+/* A GET handed to the worker pool: what is needed to answer it once the
+ * entity handler has returned and the stack's request is gone */
+typedef struct BP0DEFERREDREQUEST {
+    BPMonitor *monitor;
+    OCRequestHandle requestHandle;
+    uint64_t receivedNs;            // getMetricsNs() when the handler ran
+    char query[BP0_DEFERRED_QUERY_LENGTH];
+} BP0DeferredRequest;
 
 //-----------------------------------------------------------------------------
 // Variables
 //-----------------------------------------------------------------------------
 
-static BloodPressure0Resource BP0;
+// Notification policy shared by every instance
+static BP0NotifyConfig gBP0NotifyConfig = { false, { 0 }, 0, 0 };
 
-const char *gBP0ResourceType = "oic.wk.atomicmeasurement";
-const char *gBP0ResourceUri = "/BloodPressureMonitorAMResURI";
+// Links selected by each resource type of an rt query, from the descriptors
+static uint32_t gBP0RtLinkMasks[QUERY_RT_UNKNOWN + 1];
 
-int diastolicBP = 120;
-int systolicBP = 80;
-int pulse_rate = 58;
+// Events of the request path, see hotlog.h
+HOTLOG_EVENT(gBP0RequestEvent, "bpm%u: entity handler, flags 0x%x, method %d");
+HOTLOG_EVENT(gBP0QueryEvent, "bpm%u: query[%s]");
+HOTLOG_EVENT(gBP0RefusedEvent, "bpm%u: refused with %d, query[%s]");
+HOTLOG_EVENT(gBP0InlineEvent, "bpm%u: worker queue full, answering inline");
 
 //-----------------------------------------------------------------------------
 // Function prototype
 //-----------------------------------------------------------------------------
 
-OCRepPayload* getBP0Payload(const char* uri, const char * query, OCEntityHandlerResult * ehResult);
+OCRepPayload* getBP0Payload(BPMonitor *monitor, const ParsedQuery *query, OCEntityHandlerResult * ehResult);
+OCRepPayload *getBP0TargetPayload(BPMonitor *monitor, QueryTarget target, uint32_t linkMask,
+        OCEntityHandlerResult *ehResult);
+
+/* Scheduler task notifying the observers that are due */
+void notifyBP0Observers(void *ctx);
 
-/* This method converts the payload to JSON format */
-OCRepPayload* constructBP0Response (OCEntityHandlerRequest *ehRequest, OCEntityHandlerResult * ehResult);
+/* Following methods build the cached responses once, at resource creation */
+bool buildBP0PayloadCache(BPMonitor *monitor);
 
-/* Following methods process the GET */
-OCEntityHandlerResult ProcessBP0GetRequest (OCEntityHandlerRequest *ehRequest,
-                                         OCRepPayload **payload);
+/* Sends payload, or an empty response when the request is refused */
+OCEntityHandlerResult sendBP0Response (OCRequestHandle requestHandle,
+        OCEntityHandlerResult ehResult, OCRepPayload *payload);
 
-int createBP0ResourceEx (const char *uri, BloodPressure0Resource *BP0Resource);       
+/* Following methods process the GET, on the OCProcess() thread or on a worker */
+OCEntityHandlerResult ProcessBP0GetRequest (BPMonitor *monitor, OCRequestHandle requestHandle,
+        const char *query, bool respondToErrors);
+bool deferBP0GetRequest (BPMonitor *monitor, OCEntityHandlerRequest *ehRequest,
+        uint64_t receivedNs);
+void runBP0DeferredRequest (void *ctx);
+
+int createBP0ResourceEx (BPMonitor *monitor);
 
 //-----------------------------------------------------------------------------
 // Callback functions
@@ -81,340 +123,862 @@ BP0OCEntityHandlerCb (OCEntityHandlerFlag flag,
 // Function Implementations
 //-----------------------------------------------------------------------------
 
-void generateRandomValue() {
-    srand(time(NULL));
-    int r = rand() % 20;
-    diastolicBP = 110 + r;  // 110~120 ranged value generate
-
-    r = rand() % 20;
-    systolicBP = 70 + r;    // 70~90 ranged value generate
+bool buildBP0PayloadCache(BPMonitor *monitor)
+{
+    // Keep the "rep" objects of the batch so the values can be patched in
+    // place per request
+    BPMeasurement sample;
+    readMeasurement(&monitor->snapshot, &sample);
+
+    monitor->baselinePayload = createBaselinePayload(&gBPMResource, monitor->linkUris);
+    monitor->linkListPayload = createLinkListPayload(&gBPMResource, monitor->linkUris);
+    OCRepPayload *batchPayload = createBatchPayload(&gBPMResource, monitor->linkUris, &sample,
+            monitor->batchItems, monitor->batchReps);
+    // The notifier's batch keeps every item chained between rounds; observers
+    // with an rt query get theirs relinked for the time of their notification
+    OCRepPayload *notifyPayload = createBatchPayload(&gBPMResource, monitor->linkUris, &sample,
+            monitor->notifyBatchItems, monitor->notifyBatchReps);
+    monitor->notifySeq = sample.seq;
+
+    if (!monitor->baselinePayload || !monitor->linkListPayload || !batchPayload || !notifyPayload)
+    {
+        OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+        return false;
+    }
+    return true;
+}
 
-    r = rand() % 20;
-    pulse_rate = 50 + r;    // 50~70 ranged value generate
+/* Links an rt query selects, see getRtLinkMask() */
+uint32_t getBP0RtLinkMask(const ParsedQuery *query)
+{
+    return getRtLinkMask(&gBPMResource, gBP0RtLinkMasks, query);
+}
 
-    OIC_LOG_V(INFO, TAG, "generated random value diastolic[%d] systolic[%d] pulserate[%d]", diastolicBP, systolicBP, pulse_rate);
+/* Patches sample into the batch template and chains the items of the links
+ * in linkMask into the body to send */
+OCRepPayload *patchBP0BatchPayload(BPMonitor *monitor, const BPMeasurement *sample,
+        uint32_t linkMask)
+{
+    patchBatchPayload(&gBPMResource, monitor->batchReps, sample);
+    return selectBatchItems(monitor->batchItems, BPM_LINK_COUNT, linkMask);
 }
 
+/* Patches the current sample into the batch template and returns the body
+ * of the links in linkMask */
+OCRepPayload *getBP0BatchPayload(BPMonitor *monitor, uint32_t linkMask)
+{
+    BPMeasurement sample;
+    readMeasurement(&monitor->snapshot, &sample);
+    return patchBP0BatchPayload(monitor, &sample, linkMask);
+}
 
-OCRepPayload *getBP0Payload(const char *uri, const char *query, OCEntityHandlerResult *ehResult)
+/* Columns of limit samples, taken up front so a history copy goes straight
+ * into the body */
+bool allocBP0ArenaRange(Arena *arena, size_t limit, HistoryRange *range)
 {
-    
-    OIC_LOG_V(INFO, TAG, "query[%s]", query);
-    *ehResult = OC_EH_OK;
+    range->count = 0;
+    range->timestamp = (int64_t *)allocArena(arena, limit * sizeof(int64_t));
+    bool allocated = (range->timestamp != NULL);
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        range->values[v] = (int64_t *)allocArena(arena, limit * sizeof(int64_t));
+        allocated = allocated && range->values[v];
+    }
+    return allocated;
+}
 
-    generateRandomValue();
+/* A time range body of the samples in range, in the arena */
+OCRepPayload *createBP0ArenaRangePayload(Arena *arena, int64_t since, const HistoryRange *range)
+{
+    OCRepPayload *payload = createArenaPayload(arena);
+    bool ok = payload
+            && setArenaPropInt(arena, payload, "since", since)
+            && setArenaPropInt(arena, payload, "count", (int64_t)range->count)
+            && setArenaPropString(arena, payload, "units", "mmHg");
+    if (ok && range->count > 0)
+    {
+        ok = setArenaIntArray(arena, payload, "timestamp", range->timestamp, range->count);
+        for (size_t v = 0; ok && v < MEASUREMENT_VALUE_COUNT; v++)
+        {
+            ok = setArenaIntArray(arena, payload, gMeasurementValueNames[v], range->values[v],
+                    range->count);
+        }
+    }
+    return ok ? payload : nullptr;
+}
 
-    size_t dimensions[MAX_REP_ARRAY_DEPTH] = { 0 };
-    if (strcmp(query, "if=oic.if.baseline") == 0) {
-        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.baseline
+/* The same on the heap; the body takes over the columns, which are freed
+ * when it cannot be allocated */
+OCRepPayload *createBP0RangePayload(int64_t since, HistoryRange *range)
+{
+    OCRepPayload* payload = OCRepPayloadCreate();
+    if (!payload)
+    {
+        freeHistoryRange(range);
+        return nullptr;
+    }
 
-        OCRepPayload* payload = OCRepPayloadCreate();
-        if(!payload)
+    OCRepPayloadSetPropInt(payload, "since", since);
+    OCRepPayloadSetPropInt(payload, "count", (int64_t)range->count);
+    OCRepPayloadSetPropString(payload, "units", "mmHg");
+    if (range->count > 0)
+    {
+        size_t dimensions[MAX_REP_ARRAY_DEPTH] = { range->count, 0, 0 };
+        OCRepPayloadSetIntArrayAsOwner(payload, "timestamp", range->timestamp, dimensions);
+        for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
         {
-            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
-            return nullptr;
+            OCRepPayloadSetIntArrayAsOwner(payload, gMeasurementValueNames[v], range->values[v],
+                    dimensions);
         }
+    }
+    else
+    {
+        freeHistoryRange(range);
+    }
+    return payload;
+}
 
-        dimensions[0] = 2;
-        const char *rtStr[] = {"oic.r.bloodpressuremonitor-am", "oic.wk.atomicmeasurement"};
-        OCRepPayloadSetStringArray(payload, "rt", (const char **)rtStr, dimensions);
-
-        dimensions[0] = 3;
-        const char *ifStr[] = {"oic.if.b", "oic.if.ll", "oic.if.baseline"};
-        OCRepPayloadSetStringArray(payload, "if", (const char **)ifStr, dimensions);
-
-        dimensions[0] = 1;
-        const char *rtsmStr[] = {"oic.r.blood.pressure"};
-        OCRepPayloadSetStringArray(payload, "rts-m", (const char **)rtsmStr, dimensions);
-
-        dimensions[0] = 2;
-        const char *rtsStr[] = {"oic.r.blood.pressure", "oic.r.pulserate"};
-        OCRepPayloadSetStringArray(payload, "rts", (const char **)rtsStr, dimensions);
-
-        OCRepPayloadSetPropString(payload, "id", "user_example_id");
-
-        OCRepPayload* href1 = OCRepPayloadCreate();
-        OCRepPayloadSetPropString(href1, "href", "/myBloodPressureResURI");
-        dimensions[0] = 1;
-        const char *href1RtStr[] = {"oic.r.blood.pressure"};
-        OCRepPayloadSetStringArray(href1, "rt", (const char **)href1RtStr, dimensions);
-        dimensions[0] = 2;
-        const char *href1IfStr[] = {"oic.if.s", "oic.if.baseline"};
-        OCRepPayloadSetStringArray(href1, "if", (const char **)href1IfStr, dimensions);
-
-        OCRepPayload* bp_p = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(bp_p, "bm", 2);
-        OCRepPayloadSetPropObject(href1, "p", bp_p);
-
-        OCRepPayload* href2 = OCRepPayloadCreate();
-        OCRepPayloadSetPropString(href2, "href", "/myPulseRateResURI");
-        dimensions[0] = 1;
-        const char *href2RtStr[] = {"oic.r.pulserate"};
-        OCRepPayloadSetStringArray(href2, "rt", (const char **)href2RtStr, dimensions);
-        dimensions[0] = 2;
-        const char *href2IfStr[] = {"oic.if.s", "oic.if.baseline"};
-        OCRepPayloadSetStringArray(href2, "if", (const char **)href2IfStr, dimensions);
-
-        OCRepPayload* pr_p = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(pr_p, "bm", 2);
-        OCRepPayloadSetPropObject(href2, "p", pr_p);
-
-        OCRepPayload * hrefs[] = { href1, href2};
-        dimensions[0] = 2;
-        OCRepPayloadSetPropObjectArray(payload, "links", (const OCRepPayload **)hrefs, dimensions);
-        return payload;
+/* Builds ?since=<ms>&limit=N in the arena */
+OCRepPayload *getBP0ArenaHistoryPayload(BPMonitor *monitor, int64_t since, size_t limit,
+        Arena *arena)
+{
+    HistoryRange range;
+    if (!allocBP0ArenaRange(arena, limit, &range))
+    {
+        return nullptr;
     }
-    else if (strcmp(query, "if=oic.if.b") == 0) {
-        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.b
-        OCRepPayload* payload = OCRepPayloadCreate();
-        if(!payload)
+    readHistoryInto(&monitor->history, since, limit, &range);
+    return createBP0ArenaRangePayload(arena, since, &range);
+}
+
+/* Builds ?since=<ms>&limit=N: past samples as one array per property. With
+ * an arena the body lives there and goes with the arena's reset; without
+ * one it is a heap payload for OCRepPayloadDestroy(). */
+OCRepPayload *getBP0HistoryPayload(BPMonitor *monitor, const ParsedQuery *query, Arena *arena,
+        OCEntityHandlerResult *ehResult)
+{
+    int64_t since = query->hasSince ? query->since : 0;
+    size_t limit = query->limit;
+    if (limit == 0)
+    {
+        limit = HISTORY_DEFAULT_LIMIT;
+    }
+    else if (limit > HISTORY_MAX_LIMIT)
+    {
+        limit = HISTORY_MAX_LIMIT;
+    }
+
+    if (arena)
+    {
+        OCRepPayload *payload = getBP0ArenaHistoryPayload(monitor, since, limit, arena);
+        if (!payload)
         {
             OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
-            return nullptr;
+            *ehResult = OC_EH_ERROR;
         }
+        return payload;
+    }
 
-        OCRepPayload* child1Rep = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(child1Rep, "systolic", systolicBP);
-        OCRepPayloadSetPropInt(child1Rep, "diastolic", diastolicBP);
-        OCRepPayloadSetPropString(child1Rep, "units", "mmHg");
-        OCRepPayloadSetPropObject(payload, "rep", child1Rep);
-        OCRepPayloadSetPropString(payload, "href", "/myBloodPressureResURI");
-
-        OCRepPayload* child2 = OCRepPayloadCreate();
+    // The payload takes over the columns copied out of the history
+    HistoryRange range;
+    OCRepPayload *payload = readHistory(&monitor->history, since, limit, &range) ?
+            createBP0RangePayload(since, &range) : nullptr;
+    if (!payload)
+    {
+        OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+        *ehResult = OC_EH_ERROR;
+    }
+    return payload;
+}
 
-        OCRepPayload* child2Rep = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(child2Rep, "pulserate", pulse_rate);
-        OCRepPayloadSetPropObject(child2, "rep", child2Rep);
-        OCRepPayloadSetPropString(child2, "href", "/myPulseRateResURI");
+/* Body of a merged notification: the samples after afterSeq up to sample, in
+ * the shape of a time range GET, "since" being the first one's timestamp, and
+ * how many it carries. A first notification, or one with nothing new, carries
+ * sample alone. Built
+ * in the arena when there is one, else on the heap for OCRepPayloadDestroy().
+ * Scheduler thread only. */
+OCRepPayload *getBP0MergedPayload(BPMonitor *monitor, uint64_t afterSeq,
+        const BPMeasurement *sample, Arena *arena, size_t *carried)
+{
+    size_t limit = 1;
+    if (afterSeq && sample->seq > afterSeq)
+    {
+        uint64_t count = sample->seq - afterSeq;
+        limit = (count > BP0_MERGE_MAX_SAMPLES) ? BP0_MERGE_MAX_SAMPLES : (size_t)count;
+    }
 
-        OCRepPayloadAppend(payload, child2);
-        return payload;
+    HistoryRange range;
+    if (arena)
+    {
+        if (!allocBP0ArenaRange(arena, limit, &range))
+        {
+            return nullptr;
+        }
     }
-    else if (strcmp(query, "if=oic.if.ll") == 0) {
-        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.ll
-        OCRepPayload* payload = OCRepPayloadCreate();
-        if(!payload)
+    else
+    {
+        range.count = 0;
+        range.timestamp = (int64_t *)malloc(limit * sizeof(int64_t));
+        bool allocated = (range.timestamp != NULL);
+        for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
         {
-            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+            range.values[v] = (int64_t *)malloc(limit * sizeof(int64_t));
+            allocated = allocated && range.values[v];
+        }
+        if (!allocated)
+        {
+            freeHistoryRange(&range);
             return nullptr;
         }
+    }
 
-        OCRepPayloadSetPropString(payload, "href", "/myBloodPressureResURI");
-        dimensions[0] = 1;
-        const char *chile1rtStr[] = {"oic.r.blood.pressure"};
-        OCRepPayloadSetStringArray(payload, "rt", (const char **)chile1rtStr, dimensions);
-        dimensions[0] = 2;
-        const char *child1ifStr[] = {"oic.if.s", "oic.if.baseline"};
-        OCRepPayloadSetStringArray(payload, "if", (const char **)child1ifStr, dimensions);
-
-        OCRepPayload* bp_p = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(bp_p, "bm", 2);
-        OCRepPayloadSetPropObject(payload, "p", bp_p);
-
-        OCRepPayload* child2 = OCRepPayloadCreate();
-        OCRepPayloadSetPropString(child2, "href", "/myPulseRateResURI");
-        dimensions[0] = 1;
-        const char *chile2rtStr[] = {"oic.r.pulserate"};
-        OCRepPayloadSetStringArray(child2, "rt", (const char **)chile2rtStr, dimensions);
-        dimensions[0] = 2;
-        const char *child2ifStr[] = {"oic.if.s", "oic.if.baseline"};
-        OCRepPayloadSetStringArray(child2, "if", (const char **)child2ifStr, dimensions);
-
-        OCRepPayload* pr_p = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(pr_p, "bm", 2);
-        OCRepPayloadSetPropObject(child2, "p", pr_p);
-
-        OCRepPayloadAppend(payload, child2);
-        return payload;
+    // Without a history (-H 0) only the sample at hand is known
+    if (limit == 1 || readHistoryAfter(&monitor->history, afterSeq, limit, &range) == 0)
+    {
+        range.timestamp[0] = sample->timestamp;
+        for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+        {
+            range.values[v][0] = sample->values[v];
+        }
+        range.count = 1;
     }
-    else if (strncmp(query, "if=", 3) == 0) {
-        *ehResult = OC_EH_FORBIDDEN;
-        OIC_LOG(ERROR, TAG, PCF("Interface not supported!"));
-        return nullptr;
+
+    int64_t since = range.timestamp[0];
+    *carried = range.count;
+    return arena ? createBP0ArenaRangePayload(arena, since, &range) :
+            createBP0RangePayload(since, &range);
+}
+
+/* True for payloads owned by the response cache, which are never destroyed */
+bool isBP0CachedPayload(const BPMonitor *monitor, const OCRepPayload *payload)
+{
+    if (payload == monitor->baselinePayload || payload == monitor->linkListPayload)
+    {
+        return true;
+    }
+    // A batch body starts with the item of its first selected link
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        if (payload == monitor->batchItems[link])
+        {
+            return true;
+        }
     }
-    else if (strncmp(query, "rt=", 3) == 0) {
-        // IUT responds to Batch RETRIEVE using an 'rt' query
+    return false;
+}
+
+/* Returns the payload of a target other than a time range, owned by the
+ * response cache. Callers must hold the monitor's responseLock until the
+ * response is sent. */
+OCRepPayload *getBP0TargetPayload(BPMonitor *monitor, QueryTarget target, uint32_t linkMask,
+        OCEntityHandlerResult *ehResult)
+{
+    *ehResult = OC_EH_OK;
+
+    switch (target)
+    {
+    case QUERY_TARGET_BASELINE:
+        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.baseline
+        return monitor->baselinePayload;
+    case QUERY_TARGET_LL:
+        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.ll
+        return monitor->linkListPayload;
+    case QUERY_TARGET_BATCH:
+        // IUT responds to /BloodPressureMonitorAMResURI?if=oic.if.b and to
+        // RETRIEVE without an Interface query, as the Default Interface of an
+        // Atomic Measurement Resource Type is oic.if.b; with an 'rt' query,
+        // with the links of the asked for types only
+        return getBP0BatchPayload(monitor, linkMask);
+    default:
+        // Interface not supported, or no link matches the rt query
         *ehResult = OC_EH_FORBIDDEN;
-        OIC_LOG(ERROR, TAG, PCF("rt query not supported!"));
         return nullptr;
     }
-    else {
-        // IUT responds to RETRIEVE without an Interface query
-        // Default Interface of an Atomic Measurement Resourt Type is oic.if.b
-        OCRepPayload* payload = OCRepPayloadCreate();
-        if(!payload)
+}
+
+/* The same from a parsed query */
+OCRepPayload *getBP0Payload(BPMonitor *monitor, const ParsedQuery *query, OCEntityHandlerResult *ehResult)
+{
+    uint32_t linkMask = 0;
+    QueryTarget target = selectQueryTarget(&gBPMResource, gBP0RtLinkMasks, query, &linkMask);
+    return getBP0TargetPayload(monitor, target, linkMask, ehResult);
+}
+
+/* Interface an observer asked for, which selects its notification body */
+BP0Interface getBP0ObserveInterface(const ParsedQuery *query)
+{
+    switch (query->iface)
+    {
+    case QUERY_IF_BASELINE:
+        return BP0_IF_BASELINE;
+    case QUERY_IF_LL:
+        return BP0_IF_LL;
+    default:
+        // Observing a time range: every sample, merged per notification
+        return (query->hasSince || query->hasLimit) ? BP0_IF_MERGED : BP0_IF_BATCH;
+    }
+}
+
+OCEntityHandlerResult sendBP0Response (OCRequestHandle requestHandle,
+        OCEntityHandlerResult ehResult, OCRepPayload *payload)
+{
+    OCEntityHandlerResponse response = { 0, 0, OC_EH_ERROR, 0, 0, { },{ 0 }, false };
+
+    // Format the response.  Note this requires some info about the request
+    response.requestHandle = requestHandle;
+    response.ehResult = ehResult;
+    response.payload = reinterpret_cast<OCPayload*>(payload);
+    response.numSendVendorSpecificHeaderOptions = 0;
+    memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
+    memset(response.resourceUri, 0, sizeof(response.resourceUri));
+    // Indicate that response is NOT in a persistent buffer
+    response.persistentBufferFlag = 0;
+
+    // Send the response; a worker's as well as the OCProcess() thread's
+    lockStack();
+    OCStackResult result = OCDoResponse(&response);
+    unlockStack();
+    if (result != OC_STACK_OK)
+    {
+        countMetric(gMonitors.amMetrics, METRIC_RESPONSE_FAILURES, 1);
+        OIC_LOG(ERROR, TAG, "Error sending response");
+        return OC_EH_ERROR;
+    }
+    return ehResult;
+}
+
+/* Answers a GET. A time range body belongs to the request and is built
+ * without the response lock, so a long one does not hold up the cached
+ * bodies. Errors are normally left to the stack; a deferred request has no
+ * stack to fall back on and sets respondToErrors. */
+OCEntityHandlerResult ProcessBP0GetRequest (BPMonitor *monitor, OCRequestHandle requestHandle,
+        const char *query, bool respondToErrors)
+{
+    HOTLOG_TEXT(HOTLOG_DEBUG, gBP0QueryEvent, query, monitor->index, 0);
+
+    OCEntityHandlerResult ehResult = OC_EH_OK;
+    OCRepPayload *payload = nullptr;
+    Arena *arena = nullptr;
+    bool locked = false;
+
+    // The same selection as querybench's
+    ParsedQuery parsed;
+    uint32_t linkMask = 0;
+    QueryTarget target = QUERY_TARGET_REJECT;
+    if (parseQuery(query, &parsed))
+    {
+        target = selectQueryTarget(&gBPMResource, gBP0RtLinkMasks, &parsed, &linkMask);
+    }
+
+    if (target == QUERY_TARGET_REJECT)
+    {
+        // Malformed query, interface not supported or no link of the rt query
+        ehResult = OC_EH_FORBIDDEN;
+    }
+    else if (target == QUERY_TARGET_HISTORY)
+    {
+        // Time range RETRIEVE of past samples
+        arena = getResponseArena();
+        payload = getBP0HistoryPayload(monitor, &parsed, arena, &ehResult);
+    }
+    else
+    {
+        // The stack lock comes first: the OCProcess() thread holds it when it
+        // takes the response lock
+        lockStack();
+        pthread_mutex_lock(&monitor->responseLock);
+        locked = true;
+        payload = getBP0TargetPayload(monitor, target, linkMask, &ehResult);
+    }
+
+    if (ehResult == OC_EH_OK)
+    {
+        ehResult = sendBP0Response(requestHandle, ehResult, payload);
+    }
+    else if (ehResult == OC_EH_FORBIDDEN || respondToErrors)
+    {
+        HOTLOG_TEXT(HOTLOG_INFO, gBP0RefusedEvent, query, monitor->index, ehResult);
+        if (ehResult == OC_EH_FORBIDDEN)
         {
-            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
-            return nullptr;
+            countMetric(gMonitors.amMetrics, METRIC_FORBIDDEN, 1);
         }
+        sendBP0Response(requestHandle, ehResult, nullptr);
+    }
 
-        OCRepPayload* child1Rep = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(child1Rep, "systolic", systolicBP);
-        OCRepPayloadSetPropInt(child1Rep, "diastolic", diastolicBP);
-        OCRepPayloadSetPropString(child1Rep, "units", "mmHg");
-        OCRepPayloadSetPropObject(payload, "rep", child1Rep);
-        OCRepPayloadSetPropString(payload, "href", "/myBloodPressureResURI");
+    // Cached payloads are reused by the next response, never destroyed; an
+    // arena body goes in one step, once the stack has encoded it
+    if (arena)
+    {
+        resetArena(arena);
+    }
+    else if (payload && !isBP0CachedPayload(monitor, payload))
+    {
+        OCRepPayloadDestroy(payload);
+    }
+    if (locked)
+    {
+        pthread_mutex_unlock(&monitor->responseLock);
+        unlockStack();
+    }
+    return ehResult;
+}
 
-        OCRepPayload* child2 = OCRepPayloadCreate();
+/* Worker job: answers a GET the entity handler deferred */
+void runBP0DeferredRequest (void *ctx)
+{
+    BP0DeferredRequest *request = (BP0DeferredRequest *)ctx;
+    ProcessBP0GetRequest(request->monitor, request->requestHandle, request->query, true);
+    recordLatency(gMonitors.amMetrics, METRIC_REQUEST_LATENCY, getMetricsNs() - request->receivedNs);
+    free(request);
+
+    // OCDoResponse() has sent the response from this thread. A separate
+    // response is confirmable: wake the main loop so that its next wait
+    // follows the stack's retransmission timer.
+    wakeMainLoop();
+}
 
-        OCRepPayload* child2Rep = OCRepPayloadCreate();
-        OCRepPayloadSetPropInt(child2Rep, "pulserate", pulse_rate);
-        OCRepPayloadSetPropObject(child2, "rep", child2Rep);
-        OCRepPayloadSetPropString(child2, "href", "/myPulseRateResURI");
+/* Hands a GET to the worker pool. The stack's request is only valid during
+ * the entity handler, so what the answer needs is copied. Returns false when
+ * the request has to be answered inline: no pool, a full queue or a query
+ * too long to keep. */
+bool deferBP0GetRequest (BPMonitor *monitor, OCEntityHandlerRequest *ehRequest,
+        uint64_t receivedNs)
+{
+    if (!isWorkerPoolRunning())
+    {
+        return false;
+    }
 
-        OCRepPayloadAppend(payload, child2);
-        return payload;
+    const char *query = ehRequest->query ? ehRequest->query : "";
+    size_t length = strlen(query);
+    if (length >= BP0_DEFERRED_QUERY_LENGTH)
+    {
+        return false;
+    }
+
+    BP0DeferredRequest *request = (BP0DeferredRequest *)malloc(sizeof(BP0DeferredRequest));
+    if (!request)
+    {
+        return false;
+    }
+    request->monitor = monitor;
+    request->requestHandle = ehRequest->requestHandle;
+    request->receivedNs = receivedNs;
+    memcpy(request->query, query, length + 1);
+
+    if (!submitWork(runBP0DeferredRequest, request))
+    {
+        HOTLOG(HOTLOG_WARNING, gBP0InlineEvent, monitor->index, 0, 0, 0);
+        free(request);
+        return false;
     }
+    return true;
 }
 
-OCRepPayload* constructBP0Response (OCEntityHandlerRequest *ehRequest, OCEntityHandlerResult * ehResult)
+/* Matches the notifier task to the registered observers of the Atomic
+ * Measurement and its linked resources: it runs at the smallest pmin, and only
+ * while somebody observes. Must be called with the monitor's observeLock held;
+ * returns a task the caller has to cancel unlocked. */
+SchedulerTask *updateBP0NotifyTask(BPMonitor *monitor)
 {
-    if(ehRequest->payload && ehRequest->payload->type != PAYLOAD_TYPE_REPRESENTATION)
+    SchedulerTask *stale = NULL;
+    uint32_t period = getMinObserverPeriod(&monitor->observers);
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
     {
-        OIC_LOG(ERROR, TAG, PCF("Incoming payload not a representation"));
-        return nullptr;
+        uint32_t linkPeriod = getMinObserverPeriod(&monitor->linkObservers[link]);
+        if (linkPeriod && (period == 0 || linkPeriod < period))
+        {
+            period = linkPeriod;
+        }
     }
 
-    return getBP0Payload(gBP0ResourceUri, ehRequest->query, ehResult);
+    // The coalescing window bounds the rounds whatever pmin the observers ask
+    // for; samples in between are superseded or merged
+    if (period && period < gBP0NotifyConfig.coalesceMs)
+    {
+        period = gBP0NotifyConfig.coalesceMs;
+    }
+
+    if (period == 0)
+    {
+        stale = monitor->notifyTask;
+        monitor->notifyTask = NULL;
+    }
+    else if (!monitor->notifyTask)
+    {
+        monitor->notifyTask = scheduleTask(notifyBP0Observers, monitor, period);
+    }
+    else if (period != monitor->notifyPeriodMs)
+    {
+        setTaskPeriod(monitor->notifyTask, period);
+    }
+    monitor->notifyPeriodMs = period;
+
+    return stale;
 }
 
-OCEntityHandlerResult ProcessBP0GetRequest (OCEntityHandlerRequest *ehRequest,
-    OCRepPayload **payload)
+void refreshBP0NotifyTask(BPMonitor *monitor)
 {
-    OCEntityHandlerResult ehResult;
+    pthread_mutex_lock(&monitor->observeLock);
+    SchedulerTask *stale = updateBP0NotifyTask(monitor);
+    pthread_mutex_unlock(&monitor->observeLock);
+
+    // Called from the entity handler, with the stack lock held, which the
+    // notifier takes: a running notifyBP0Observers() finishes on its own
+    releaseTask(stale);
+}
 
-    OCRepPayload *getResp = constructBP0Response(ehRequest, &ehResult);
+void setBP0NotifyConfig(const BP0NotifyConfig *config)
+{
+    gBP0NotifyConfig = *config;
+}
 
-    if(getResp)
+/* True when the sample moved past a deadband since the reference sample */
+bool isBP0SignificantChange(const BPMonitor *monitor, const BPMeasurement *sample)
+{
+    const BPMeasurement *reference = &monitor->reference;
+    if (reference->seq == 0)
     {
-        *payload = getResp;
+        return true;
     }
-    else
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
     {
-        ehResult = OC_EH_ERROR;
+        if (abs(sample->values[v] - reference->values[v]) > gBP0NotifyConfig.deadbands[v])
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    return ehResult;
+/* Sends payload to the due observers of one resource and counts them under
+ * its metrics source. Returns true when the stack no longer knew some of
+ * them; they are removed from the registry. */
+bool notifyBP0DueObservers(OCResourceHandle handle, ObserverRegistry *observers,
+        const ObserverIdList *due, OCRepPayload *payload, int metrics)
+{
+    bool lost = false;
+    uint64_t startNs = getMetricsNs();
+
+    // The stack takes at most UINT8_MAX ids per call
+    for (size_t i = 0; i < due->count; i += UINT8_MAX)
+    {
+        size_t count = due->count - i;
+        if (count > UINT8_MAX)
+        {
+            count = UINT8_MAX;
+        }
+        lockStack();
+        OCStackResult result = OCNotifyListOfObservers(handle, &due->ids[i],
+                (uint8_t)count, payload, OC_NA_QOS);
+        unlockStack();
+        if(OC_STACK_NO_OBSERVERS == result) {
+            // The stack dropped these observers without a deregistration
+            for (size_t j = i; j < i + count; j++)
+            {
+                removeObserver(observers, due->ids[j]);
+            }
+            lost = true;
+        }
+        else if (OC_STACK_OK != result)
+        {
+            countMetric(metrics, METRIC_RESPONSE_FAILURES, 1);
+            OIC_LOG_V(ERROR, TAG, "Notification failed: %s", getResult(result));
+        }
+    }
+    countMetric(metrics, METRIC_NOTIFICATIONS, due->count);
+    recordLatency(metrics, METRIC_NOTIFY_LATENCY, getMetricsNs() - startNs);
+    return lost;
 }
- 
-int threadQuitFlag = 0;
-void handleSigIntForTheread(int signum)
+
+/* Moves the due observers from first on that share the first one's link
+ * mask (byLinkMask) or last sample to the front, and returns them in *group.
+ * Returns the index past the group. */
+size_t takeBP0ObserverGroup(ObserverIdList *due, size_t first, bool byLinkMask,
+        ObserverIdList *group)
 {
-    if (signum == SIGINT)
+    size_t end = first;
+    for (size_t i = first; i < due->count; i++)
     {
-        threadQuitFlag = 1;
+        bool same = byLinkMask ? (due->linkMasks[i] == due->linkMasks[first]) :
+                                 (due->lastSeqs[i] == due->lastSeqs[first]);
+        if (same)
+        {
+            OCObservationId id = due->ids[i];
+            uint64_t lastSeq = due->lastSeqs[i];
+            uint32_t linkMask = due->linkMasks[i];
+            due->ids[i] = due->ids[end];
+            due->lastSeqs[i] = due->lastSeqs[end];
+            due->linkMasks[i] = due->linkMasks[end];
+            due->ids[end] = id;
+            due->lastSeqs[end] = lastSeq;
+            due->linkMasks[end++] = linkMask;
+        }
     }
+    *group = { &due->ids[first], &due->lastSeqs[first], &due->linkMasks[first],
+               end - first, end - first };
+    return end;
 }
 
-void *valueGenerateForObserveThread(void *data) {
-    struct timespec timeout;
-    timeout.tv_sec  = 2; 
-    timeout.tv_nsec = 0; 
+/* Sends the batch notifications of the due observers: the items of every
+ * link, or of the links their rt query selected. Observers with the same
+ * selection share one body, normally all of them. */
+bool notifyBP0BatchObservers(BPMonitor *monitor, ObserverIdList *due)
+{
+    bool lost = false;
+    size_t done = 0;
+    while (done < due->count)
+    {
+        ObserverIdList group;
+        done = takeBP0ObserverGroup(due, done, true, &group);
+        uint32_t linkMask = group.linkMasks[0] ? group.linkMasks[0] : BPM_ALL_LINKS;
+        OCRepPayload *payload = selectBatchItems(monitor->notifyBatchItems, BPM_LINK_COUNT,
+                linkMask);
+        lost |= notifyBP0DueObservers(monitor->amHandle, &monitor->observers, &group, payload,
+                gMonitors.amMetrics);
+    }
+    // Leave the full body chained for the next round
+    selectBatchItems(monitor->notifyBatchItems, BPM_LINK_COUNT, BPM_ALL_LINKS);
+    return lost;
+}
 
-    signal(SIGINT, handleSigIntForTheread);
-    while(!threadQuitFlag) {
-        generateRandomValue(); 
-        OCStackResult result = OCNotifyAllObservers(BP0.handle, OC_NA_QOS);
-        if(OC_STACK_NO_OBSERVERS == result) {
-            threadQuitFlag = 1;
+/* Sends the merged notifications of the due time range observers. Observers
+ * that had the same sample last share one body, normally all of them. */
+bool notifyBP0MergedObservers(BPMonitor *monitor, ObserverIdList *due,
+        const BPMeasurement *sample)
+{
+    bool lost = false;
+    int metrics = gMonitors.amMetrics;
+    Arena *arena = getResponseArena();
+    size_t done = 0;
+    while (done < due->count)
+    {
+        ObserverIdList group;
+        done = takeBP0ObserverGroup(due, done, false, &group);
+        uint64_t lastSeq = group.lastSeqs[0];
+
+        size_t carried = 0;
+        OCRepPayload *payload = getBP0MergedPayload(monitor, lastSeq, sample, arena, &carried);
+        if (!payload)
+        {
+            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+            countMetric(metrics, METRIC_RESPONSE_FAILURES, group.count);
+            continue;
+        }
+        lost |= notifyBP0DueObservers(monitor->amHandle, &monitor->observers, &group, payload,
+                metrics);
+
+        uint64_t missed = (lastSeq && sample->seq > lastSeq + carried) ?
+                sample->seq - lastSeq - carried : 0;
+        countMetric(metrics, METRIC_SAMPLES_MERGED, (carried - 1) * group.count);
+        countMetric(metrics, METRIC_SAMPLES_COALESCED, missed * group.count);
+        if (arena)
+        {
+            resetArena(arena);
+        }
+        else
+        {
+            OCRepPayloadDestroy(payload);
         }
-        nanosleep(&timeout, NULL);
     }
-    return NULL;
+    return lost;
 }
 
-void startObserve() {
-    char p[] = "valueGenerateForObserveThread";
-    pthread_t p_thread;
-    threadQuitFlag = 0;
-    int thread_id = pthread_create(&p_thread, NULL, valueGenerateForObserveThread, (void*)p);
-    if (thread_id < 0)
+/* Patches sample into the notification bodies, once per sample whatever
+ * the number of observers and rounds; scheduler thread only */
+void patchBP0NotifyPayloads(BPMonitor *monitor, const BPMeasurement *sample)
+{
+    if (sample->seq == monitor->notifySeq)
     {
-        perror("thread create error : ");
-        exit(0);
+        return;
     }
+    patchBatchPayload(&gBPMResource, monitor->notifyBatchReps, sample);
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        patchPropertyPayload(gBPMLinks[link].resource, monitor->notifyLinkPayloads[link], sample);
+    }
+    monitor->notifySeq = sample->seq;
 }
 
-void stopObserve() {
-    threadQuitFlag = 1;
+/* Scheduler task: looks at the latest sample, then notifies only the
+ * observers that are due. One sample serves every resource of the instance:
+ * it is read once and patched once into the notification bodies, which
+ * every observer of a body shares. They belong to this task, so the fan-out
+ * runs without the response lock. Whatever the sampling rate, an observer
+ * gets at most one notification per round: the newest sample, or with a time
+ * range query every sample since its last one, merged into one body. */
+void notifyBP0Observers(void *ctx) {
+    BPMonitor *monitor = (BPMonitor *)ctx;
+
+    pthread_mutex_lock(&monitor->observeLock);
+    uint32_t slack = monitor->notifyPeriodMs / 2;
+    pthread_mutex_unlock(&monitor->observeLock);
+
+    uint64_t now = getMonotonicMs();
+    BPMeasurement sample;
+    readMeasurement(&monitor->snapshot, &sample);
+    if (sample.seq != monitor->lastSeq)
+    {
+        // Periodic mode: every new sample counts as a change
+        monitor->lastSeq = sample.seq;
+        if (!gBP0NotifyConfig.onChange || isBP0SignificantChange(monitor, &sample))
+        {
+            monitor->reference = sample;
+            monitor->lastChangeMs = now;
+        }
+    }
+    patchBP0NotifyPayloads(monitor, &sample);
+
+    ObserverIdList *due = &monitor->dueObservers;
+    bool lost = false;
+    for (int variant = 0; variant < BP0_IF_COUNT; variant++)
+    {
+        if (collectDueObservers(&monitor->observers, variant, now, monitor->lastChangeMs, slack,
+                sample.seq, due) == 0)
+        {
+            continue;
+        }
+        if (variant == BP0_IF_MERGED)
+        {
+            lost |= notifyBP0MergedObservers(monitor, due, &sample);
+            continue;
+        }
+        if (variant == BP0_IF_BATCH)
+        {
+            lost |= notifyBP0BatchObservers(monitor, due);
+            // Keep newest: the samples in between are gone for these observers
+            countMetric(gMonitors.amMetrics, METRIC_SAMPLES_COALESCED,
+                    countSkippedSamples(due, sample.seq));
+            continue;
+        }
+
+        OCRepPayload *payload = (variant == BP0_IF_BASELINE) ? monitor->baselinePayload :
+                                monitor->linkListPayload;
+        lost |= notifyBP0DueObservers(monitor->amHandle, &monitor->observers, due, payload,
+                gMonitors.amMetrics);
+    }
+
+    // Observers of the linked resources get the body of that resource alone
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        ObserverRegistry *observers = &monitor->linkObservers[link];
+        if (collectDueObservers(observers, 0, now, monitor->lastChangeMs, slack, sample.seq,
+                due) == 0)
+        {
+            continue;
+        }
+        lost |= notifyBP0DueObservers(monitor->linkHandles[link], observers, due,
+                monitor->notifyLinkPayloads[link], gMonitors.linkMetrics[link]);
+        countMetric(gMonitors.linkMetrics[link], METRIC_SAMPLES_COALESCED,
+                countSkippedSamples(due, sample.seq));
+    }
+
+    if (lost)
+    {
+        refreshBP0NotifyTask(monitor);
+    }
+    wakeMainLoop();
+}
+
+void startObserve(BPMonitor *monitor, OCObservationId obsId, const char *query) {
+    ParsedQuery parsed;
+    parseQuery(query, &parsed);
+    // A batch observer with an rt query is sent the items of those links only;
+    // the registration's GET has refused a query that selects none
+    BP0Interface iface = getBP0ObserveInterface(&parsed);
+    uint32_t linkMask = (iface == BP0_IF_BATCH && parsed.rtMask) ? getBP0RtLinkMask(&parsed) : 0;
+    int count = addObserver(&monitor->observers, obsId, &parsed, iface, linkMask);
+
+    refreshBP0NotifyTask(monitor);
+
+    OIC_LOG_V(DEBUG, TAG, "%s: %d observer(s) registered", monitor->amUri, count);
+}
+
+void getBP0ObserveStats(BPMonitor *monitor, ObserverStats *stats) {
+    getObserverStats(&monitor->observers, stats);
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        ObserverStats linkStats;
+        getObserverStats(&monitor->linkObservers[link], &linkStats);
+        stats->observers += linkStats.observers;
+        stats->notified += linkStats.notified;
+        stats->heartbeats += linkStats.heartbeats;
+        stats->suppressed += linkStats.suppressed;
+    }
+}
+
+void logBP0ObserveStats(BPMonitor *monitor) {
+    ObserverStats stats;
+    getBP0ObserveStats(monitor, &stats);
+    OIC_LOG_V(INFO, TAG, "%s notifications: %llu sent (%llu heartbeats), %llu suppressed by deadband",
+            monitor->amUri, (unsigned long long)stats.notified,
+            (unsigned long long)stats.heartbeats, (unsigned long long)stats.suppressed);
+}
+
+void stopObserve(BPMonitor *monitor, OCObservationId obsId) {
+    // Only the last observer leaving stops the notifications
+    int count = removeObserver(&monitor->observers, obsId);
+    if (count == 0)
+    {
+        logBP0ObserveStats(monitor);
+    }
+
+    refreshBP0NotifyTask(monitor);
+
+    OIC_LOG_V(DEBUG, TAG, "%s: %d observer(s) registered", monitor->amUri, count);
 }
 
 
 OCEntityHandlerResult
 BP0OCEntityHandlerCb (OCEntityHandlerFlag flag,
         OCEntityHandlerRequest *entityHandlerRequest,
-        void* /*callbackParam*/)
+        void* callbackParam)
 {
-    OIC_LOG_V (INFO, TAG, "Inside entity handler - flags: 0x%x", flag);
+    // Every instance registers the same handler with its table entry
+    BPMonitor *monitor = (BPMonitor *)callbackParam;
 
     OCEntityHandlerResult ehResult = OC_EH_ERROR;
-    OCEntityHandlerResponse response = { 0, 0, OC_EH_ERROR, 0, 0, { },{ 0 }, false };
     // Validate pointer
     if (!entityHandlerRequest)
     {
         OIC_LOG (ERROR, TAG, "Invalid request pointer");
         return OC_EH_ERROR;
     }
-
-    OCRepPayload* payload = nullptr;
+    HOTLOG(HOTLOG_DEBUG, gBP0RequestEvent, monitor->index, flag, entityHandlerRequest->method, 0);
+    uint64_t receivedNs = getMetricsNs();
 
     if (flag & OC_REQUEST_FLAG)
     {
-        OIC_LOG (INFO, TAG, "Flag includes OC_REQUEST_FLAG");
-        if (entityHandlerRequest)
+        if (OC_REST_GET == entityHandlerRequest->method)
         {
-            if (OC_REST_GET == entityHandlerRequest->method)
+            countMetric(gMonitors.amMetrics, METRIC_REQUESTS, 1);
+            if (entityHandlerRequest->payload
+                && entityHandlerRequest->payload->type != PAYLOAD_TYPE_REPRESENTATION)
             {
-                OIC_LOG (INFO, TAG, "Received OC_REST_GET from client");
-
-                ehResult = ProcessBP0GetRequest (entityHandlerRequest, &payload);
+                OIC_LOG(ERROR, TAG, PCF("Incoming payload not a representation"));
             }
-
-            else
+            // A plain GET is answered by a worker, so that building the body
+            // never holds up the OCProcess() thread; an observe registration
+            // is answered with it
+            else if (!(flag & OC_OBSERVE_FLAG)
+                     && deferBP0GetRequest(monitor, entityHandlerRequest, receivedNs))
             {
-                OIC_LOG_V (INFO, TAG, "Received unsupported method %d from client",
-                        entityHandlerRequest->method);
-                ehResult = OC_EH_METHOD_NOT_ALLOWED;
+                ehResult = OC_EH_SLOW;
             }
-
-            if (ehResult == OC_EH_OK && ehResult != OC_EH_FORBIDDEN)
+            else
             {
-                // Format the response.  Note this requires some info about the request
-                response.requestHandle = entityHandlerRequest->requestHandle;
-                response.ehResult = ehResult;
-                response.payload = reinterpret_cast<OCPayload*>(payload);
-                response.numSendVendorSpecificHeaderOptions = 0;
-                memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
-                memset(response.resourceUri, 0, sizeof(response.resourceUri));
-                // Indicate that response is NOT in a persistent buffer
-                response.persistentBufferFlag = 0;
-
-                // Send the response
-                if (OCDoResponse(&response) != OC_STACK_OK)
-                {
-                    OIC_LOG(ERROR, TAG, "Error sending response");
-                    ehResult = OC_EH_ERROR;
-                }
-            } else if(ehResult == OC_EH_FORBIDDEN) {
-                OIC_LOG(INFO, TAG, "FORBIDDEN RESULT"); // FORBIDDEN RESULT
-                
-                response.requestHandle = entityHandlerRequest->requestHandle;
-                response.ehResult = ehResult;
-                response.payload = nullptr;//reinterpret_cast<OCPayload*>(payload);
-                response.numSendVendorSpecificHeaderOptions = 0;
-                memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
-                memset(response.resourceUri, 0, sizeof(response.resourceUri));
-                // Indicate that response is NOT in a persistent buffer
-                response.persistentBufferFlag = 0;
-
-                // Send the response
-                if (OCDoResponse(&response) != OC_STACK_OK)
-                {
-                    OIC_LOG(ERROR, TAG, "Error sending response");
-                    ehResult = OC_EH_ERROR;
-                }
+                ehResult = ProcessBP0GetRequest(monitor, entityHandlerRequest->requestHandle,
+                        entityHandlerRequest->query, false);
+                recordLatency(gMonitors.amMetrics, METRIC_REQUEST_LATENCY,
+                        getMetricsNs() - receivedNs);
             }
         }
+
+        else
+        {
+            // Unsupported method, logged with the request
+            ehResult = OC_EH_METHOD_NOT_ALLOWED;
+        }
     }
     
     else {
@@ -422,59 +986,50 @@ BP0OCEntityHandlerCb (OCEntityHandlerFlag flag,
     }
 
     if(flag & OC_OBSERVE_FLAG) {
-        if(OC_OBSERVE_REGISTER == entityHandlerRequest->obsInfo.action) {
+        if(OC_OBSERVE_REGISTER == entityHandlerRequest->obsInfo.action
+           && (flag & OC_REQUEST_FLAG) && ehResult != OC_EH_OK) {
+            // The GET was refused (or its response failed): no observer
+            OIC_LOG(DEBUG, TAG, "OBSERVER REGISTER REFUSED.");
+        }
+        else if(OC_OBSERVE_REGISTER == entityHandlerRequest->obsInfo.action) {
             ehResult = OC_EH_OK;
             OIC_LOG(DEBUG, TAG, "OBSERVER REGISTER RECEIVED.");
-            startObserve();
+            countMetric(gMonitors.amMetrics, METRIC_OBSERVE_REGISTERS, 1);
+            startObserve(monitor, entityHandlerRequest->obsInfo.obsId, entityHandlerRequest->query);
         }
         else if(OC_OBSERVE_DEREGISTER == entityHandlerRequest->obsInfo.action) {
             ehResult = OC_EH_OK;
             OIC_LOG(ERROR, TAG, "OBSERVER DEREGISTER RECEIVED.");
-            stopObserve();
+            countMetric(gMonitors.amMetrics, METRIC_OBSERVE_DEREGISTERS, 1);
+            stopObserve(monitor, entityHandlerRequest->obsInfo.obsId);
         }
-
-        response.requestHandle = entityHandlerRequest->requestHandle;
-        response.ehResult = ehResult;
-        response.payload = nullptr;//reinterpret_cast<OCPayload*>(payload);
-        response.numSendVendorSpecificHeaderOptions = 0;
-        memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
-        memset(response.resourceUri, 0, sizeof(response.resourceUri));
-        // Indicate that response is NOT in a persistent buffer
-        response.persistentBufferFlag = 0;
     }
 
     return ehResult;
 }
 
-int createBP0Resource () {
-    createBP0ResourceEx(gBP0ResourceUri, &BP0);
-    return 0;
-}
+int createBP0Resource (BPMonitor *monitor) {
+    // Instance 0 is created first
+    if (monitor->index == 0)
+    {
+        initRtLinkMasks(&gBPMResource, gBP0RtLinkMasks);
+    }
+    setObserverHeartbeat(&monitor->observers, gBP0NotifyConfig.heartbeatMs);
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        setObserverHeartbeat(&monitor->linkObservers[link], gBP0NotifyConfig.heartbeatMs);
+    }
 
-int createBP0ResourceEx (const char *uri, BloodPressure0Resource *BP0Resource)
-{
-    if (!uri)
+    // The sampler has already published a first sample for the batch template
+    if (!buildBP0PayloadCache(monitor))
     {
-        OIC_LOG(ERROR, TAG, "Resource URI cannot be NULL");
         return -1;
     }
+    return createBP0ResourceEx(monitor);
+}
 
-    OCStackResult res = OCCreateResource(&(BP0Resource->handle),
-            gBP0ResourceType,
-            OC_RSRVD_INTERFACE_BATCH,       
-            gBP0ResourceUri,
-            BP0OCEntityHandlerCb,
-            NULL,
-            OC_DISCOVERABLE | OC_OBSERVABLE 
-#if IS_SECURE_MODE
-            | OC_SECURE
-#endif
-        );
-    
-    OCResourceHandle rHandle = OCGetResourceHandleAtUri(gBP0ResourceUri);
-    OCBindResourceInterfaceToResource(rHandle, OC_RSRVD_INTERFACE_LL);   
-    OCBindResourceTypeToResource(rHandle, "oic.r.bloodpressuremonitor-am");
-    OIC_LOG_V(INFO, TAG, "Created BP0 resource with result: %s", getResult(res));
-
-    return 0;
+int createBP0ResourceEx (BPMonitor *monitor)
+{
+    return createDescribedResource(&gBPMResource, monitor->amUri, &monitor->amHandle,
+            BP0OCEntityHandlerCb, monitor);
 }
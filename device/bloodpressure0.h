@@ -1,6 +1,32 @@
 #ifndef BLOODPRESSURE0_H
 #define BLOODPRESSURE0_H
 
-int createBP0Resource ();
+#include <stdint.h>
+#include <stddef.h>
+#include "../observers.h"
+#include "measurement.h"
 
-#endif
\ No newline at end of file
+/* Notification policy of the Atomic Measurement */
+typedef struct BP0NOTIFYCONFIG {
+    bool onChange;              // notify only when a value moves past its deadband
+    int deadbands[MEASUREMENT_VALUE_COUNT]; // per MeasurementValue, in its units
+    uint32_t heartbeatMs;       // max silence for observers without pmax, 0 for none
+    uint32_t coalesceMs;        // least time between two notification rounds, 0 for pmin alone
+} BP0NotifyConfig;
+
+/* Applies to every instance; call before createBP0Resource() */
+void setBP0NotifyConfig(const BP0NotifyConfig *config);
+
+typedef struct BPMONITOR BPMonitor;
+
+/* Starts, retunes or stops the instance's notifier task after observers of
+ * any of its resources came or went */
+void refreshBP0NotifyTask(BPMonitor *monitor);
+
+/* Notification counters of one instance's observers, on all its resources */
+void getBP0ObserveStats(BPMonitor *monitor, ObserverStats *stats);
+
+/* Creates the Atomic Measurement of a monitor instance */
+int createBP0Resource (BPMonitor *monitor);
+
+#endif
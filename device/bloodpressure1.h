@@ -1,6 +0,0 @@
-#ifndef BLOODPRESSURE1_H
-#define BLOODPRESSURE1_H
-
-int createBP1Resource ();
-
-#endif
\ No newline at end of file
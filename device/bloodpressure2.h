@@ -1,6 +0,0 @@
-#ifndef BLOODPRESSURE2_H
-#define BLOODPRESSURE2_H
-
-int createBP2Resource ();
-
-#endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef BPMRESOURCES_H
+#define BPMRESOURCES_H
+
+#include <stddef.h>
+#include "descriptor.h"
+
+/* The resources of one blood pressure monitor: the Atomic Measurement and the
+ * resources it links. A new vital sign is its line in MEASUREMENT_VALUES
+ * (measurement.h) plus one more descriptor here, listed in gBPMLinks. */
+
+// Blood pressure (oic.r.blood.pressure)
+static constexpr const char *gBloodPressureTypes[] = { "oic.r.blood.pressure" };
+static constexpr const char *gBloodPressureInterfaces[] = {
+    OC_RSRVD_INTERFACE_SENSOR, OC_RSRVD_INTERFACE_DEFAULT
+};
+static constexpr PropertyDesc gBloodPressureProperties[] = {
+    measuredInt(MEASUREMENT_SYSTOLIC),
+    measuredInt(MEASUREMENT_DIASTOLIC),
+    fixedString("units", "mmHg")
+};
+static constexpr ResourceDesc gBloodPressureResource = {
+    "/myBloodPressureResURI",
+    gBloodPressureTypes, countOf(gBloodPressureTypes),
+    gBloodPressureInterfaces, countOf(gBloodPressureInterfaces),
+    gBloodPressureProperties, countOf(gBloodPressureProperties),
+    nullptr, 0,
+    OC_OBSERVABLE
+};
+
+// Pulse rate (oic.r.pulserate)
+static constexpr const char *gPulseRateTypes[] = { "oic.r.pulserate" };
+static constexpr const char *gPulseRateInterfaces[] = {
+    OC_RSRVD_INTERFACE_SENSOR, OC_RSRVD_INTERFACE_DEFAULT
+};
+static constexpr PropertyDesc gPulseRateProperties[] = {
+    measuredInt(MEASUREMENT_PULSERATE)
+};
+static constexpr ResourceDesc gPulseRateResource = {
+    "/myPulseRateResURI",
+    gPulseRateTypes, countOf(gPulseRateTypes),
+    gPulseRateInterfaces, countOf(gPulseRateInterfaces),
+    gPulseRateProperties, countOf(gPulseRateProperties),
+    nullptr, 0,
+    OC_OBSERVABLE
+};
+
+// Atomic Measurement (oic.r.bloodpressuremonitor-am)
+static constexpr LinkDesc gBPMLinks[] = {
+    { &gBloodPressureResource, true },
+    { &gPulseRateResource, false }
+};
+static constexpr const char *gBPMTypes[] = {
+    "oic.r.bloodpressuremonitor-am", "oic.wk.atomicmeasurement"
+};
+static constexpr const char *gBPMInterfaces[] = {
+    OC_RSRVD_INTERFACE_BATCH, OC_RSRVD_INTERFACE_LL, OC_RSRVD_INTERFACE_DEFAULT
+};
+static constexpr ResourceDesc gBPMResource = {
+    "/BloodPressureMonitorAMResURI",
+    gBPMTypes, countOf(gBPMTypes),
+    gBPMInterfaces, countOf(gBPMInterfaces),
+    nullptr, 0,
+    gBPMLinks, countOf(gBPMLinks),
+    OC_DISCOVERABLE | OC_OBSERVABLE
+};
+
+#define BPM_LINK_COUNT  countOf(gBPMLinks)
+#define BPM_ALL_LINKS   ((1u << BPM_LINK_COUNT) - 1)
+
+static_assert(BPM_LINK_COUNT > 0 && BPM_LINK_COUNT <= DESCRIPTOR_MAX_LINKS,
+        "an Atomic Measurement links 1..DESCRIPTOR_MAX_LINKS resources");
+
+#endif
@@ -0,0 +1,398 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Resource Descriptors
+// Description: Builds resources and their payloads from resource descriptors
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ocstack.h"
+#include "logger.h"
+#include "ocpayload.h"
+#include "descriptor.h"
+#include "../common.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-DESCRIPTOR"
+
+// Same id as the device's other bodies
+#define DESCRIPTOR_RESOURCE_ID "user_example_id"
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+int createDescribedResource(const ResourceDesc *desc, const char *uri, OCResourceHandle *handle,
+        OCEntityHandler handler, void *callbackParam)
+{
+    OCStackResult res = OCCreateResource(handle,
+            desc->types[0],
+            desc->interfaces[0],
+            uri,
+            handler,
+            callbackParam,
+            desc->policy
+#if IS_SECURE_MODE
+            | OC_SECURE
+#endif
+        );
+    if (res != OC_STACK_OK)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to create %s: %s", uri, getResult(res));
+        return -1;
+    }
+
+    for (size_t i = 1; i < desc->typeCount; i++)
+    {
+        OCBindResourceTypeToResource(*handle, desc->types[i]);
+    }
+    for (size_t i = 1; i < desc->interfaceCount; i++)
+    {
+        // The stack binds oic.if.baseline to every resource by itself
+        if (strcmp(desc->interfaces[i], OC_RSRVD_INTERFACE_DEFAULT) != 0)
+        {
+            OCBindResourceInterfaceToResource(*handle, desc->interfaces[i]);
+        }
+    }
+    OIC_LOG_V(DEBUG, TAG, "Created %s resource %s", desc->types[0], uri);
+
+    return 0;
+}
+
+static int32_t getMeasuredInt(const PropertyDesc *property, const BPMeasurement *sample)
+{
+    return sample->values[property->value];
+}
+
+bool hasDescribedInterface(const ResourceDesc *desc, QueryInterface iface)
+{
+    for (size_t i = 0; i < desc->interfaceCount; i++)
+    {
+        if (lookupQueryInterface(desc->interfaces[i], strlen(desc->interfaces[i])) == iface)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void setPropertyValues(const ResourceDesc *desc, OCRepPayload *payload,
+        const BPMeasurement *sample)
+{
+    for (size_t i = 0; i < desc->propertyCount; i++)
+    {
+        const PropertyDesc *property = &desc->properties[i];
+        if (property->kind == PROPERTY_MEASURED_INT)
+        {
+            OCRepPayloadSetPropInt(payload, property->name, getMeasuredInt(property, sample));
+        }
+        else
+        {
+            OCRepPayloadSetPropString(payload, property->name, property->text);
+        }
+    }
+}
+
+OCRepPayload *createPropertyPayload(const ResourceDesc *desc, const BPMeasurement *sample)
+{
+    OCRepPayload* payload = OCRepPayloadCreate();
+    if(!payload)
+    {
+        return nullptr;
+    }
+
+    setPropertyValues(desc, payload, sample);
+    return payload;
+}
+
+OCRepPayload *createResourcePayload(const ResourceDesc *desc, const BPMeasurement *sample)
+{
+    size_t dimensions[MAX_REP_ARRAY_DEPTH] = { 0 };
+
+    OCRepPayload* payload = OCRepPayloadCreate();
+    if(!payload)
+    {
+        return nullptr;
+    }
+
+    dimensions[0] = desc->typeCount;
+    OCRepPayloadSetStringArray(payload, "rt", (const char **)desc->types, dimensions);
+    OCRepPayloadSetPropString(payload, "id", DESCRIPTOR_RESOURCE_ID);
+    setPropertyValues(desc, payload, sample);
+    return payload;
+}
+
+void patchPropertyPayload(const ResourceDesc *desc, OCRepPayload *payload,
+        const BPMeasurement *sample)
+{
+    for (size_t i = 0; i < desc->propertyCount; i++)
+    {
+        const PropertyDesc *property = &desc->properties[i];
+        if (property->kind == PROPERTY_MEASURED_INT)
+        {
+            OCRepPayloadSetPropInt(payload, property->name, getMeasuredInt(property, sample));
+        }
+    }
+}
+
+OCRepPayload *createLinkPayload(const ResourceDesc *desc, const char *href)
+{
+    size_t dimensions[MAX_REP_ARRAY_DEPTH] = { 0 };
+
+    OCRepPayload* link = OCRepPayloadCreate();
+    if(!link)
+    {
+        return nullptr;
+    }
+
+    OCRepPayloadSetPropString(link, "href", href);
+    dimensions[0] = desc->typeCount;
+    OCRepPayloadSetStringArray(link, "rt", (const char **)desc->types, dimensions);
+    dimensions[0] = desc->interfaceCount;
+    OCRepPayloadSetStringArray(link, "if", (const char **)desc->interfaces, dimensions);
+
+    // Bitmap of the link's policy: 1 discoverable, 2 observable
+    OCRepPayload* p = OCRepPayloadCreate();
+    OCRepPayloadSetPropInt(p, "bm", desc->policy & (OC_DISCOVERABLE | OC_OBSERVABLE));
+    OCRepPayloadSetPropObjectAsOwner(link, "p", p);
+
+    return link;
+}
+
+OCRepPayload *createBaselinePayload(const ResourceDesc *desc, const ResourceUri *linkUris)
+{
+    size_t dimensions[MAX_REP_ARRAY_DEPTH] = { 0 };
+
+    OCRepPayload* payload = OCRepPayloadCreate();
+    if(!payload)
+    {
+        return nullptr;
+    }
+
+    dimensions[0] = desc->typeCount;
+    OCRepPayloadSetStringArray(payload, "rt", (const char **)desc->types, dimensions);
+
+    dimensions[0] = desc->interfaceCount;
+    OCRepPayloadSetStringArray(payload, "if", (const char **)desc->interfaces, dimensions);
+
+    // Types of the linked resources: rts-m the mandatory ones, rts all of them
+    const char *rtsm[DESCRIPTOR_MAX_LINKS];
+    const char *rts[DESCRIPTOR_MAX_LINKS];
+    size_t mandatory = 0;
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        rts[i] = desc->links[i].resource->types[0];
+        if (desc->links[i].mandatory)
+        {
+            rtsm[mandatory++] = rts[i];
+        }
+    }
+    dimensions[0] = mandatory;
+    OCRepPayloadSetStringArray(payload, "rts-m", rtsm, dimensions);
+    dimensions[0] = desc->linkCount;
+    OCRepPayloadSetStringArray(payload, "rts", rts, dimensions);
+
+    OCRepPayloadSetPropString(payload, "id", DESCRIPTOR_RESOURCE_ID);
+
+    OCRepPayload *hrefs[DESCRIPTOR_MAX_LINKS];
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        hrefs[i] = createLinkPayload(desc->links[i].resource, linkUris[i]);
+    }
+    dimensions[0] = desc->linkCount;
+    OCRepPayloadSetPropObjectArrayAsOwner(payload, "links", hrefs, dimensions);
+
+    return payload;
+}
+
+OCRepPayload *createLinkListPayload(const ResourceDesc *desc, const ResourceUri *linkUris)
+{
+    // The oic.if.ll body is the list of links itself
+    OCRepPayload* payload = createLinkPayload(desc->links[0].resource, linkUris[0]);
+    if(!payload)
+    {
+        return nullptr;
+    }
+
+    for (size_t i = 1; i < desc->linkCount; i++)
+    {
+        OCRepPayloadAppend(payload, createLinkPayload(desc->links[i].resource, linkUris[i]));
+    }
+    return payload;
+}
+
+OCRepPayload *createBatchPayload(const ResourceDesc *desc, const ResourceUri *linkUris,
+        const BPMeasurement *sample, OCRepPayload **items, OCRepPayload **reps)
+{
+    OCRepPayload* payload = nullptr;
+
+    // Each link is one item of the body, appended after the first
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        OCRepPayload* item = OCRepPayloadCreate();
+        OCRepPayload* rep = createPropertyPayload(desc->links[i].resource, sample);
+        if (!item || !rep)
+        {
+            // Destroying the body frees the items already chained: none of
+            // them may stay behind in items[] or reps[]
+            OCRepPayloadDestroy(item);
+            OCRepPayloadDestroy(rep);
+            OCRepPayloadDestroy(payload);
+            for (size_t j = 0; j < desc->linkCount; j++)
+            {
+                items[j] = nullptr;
+                reps[j] = nullptr;
+            }
+            return nullptr;
+        }
+
+        items[i] = item;
+        reps[i] = rep;
+        OCRepPayloadSetPropObjectAsOwner(item, "rep", rep);
+        OCRepPayloadSetPropString(item, "href", linkUris[i]);
+        if (payload)
+        {
+            OCRepPayloadAppend(payload, item);
+        }
+        else
+        {
+            payload = item;
+        }
+    }
+    return payload;
+}
+
+void patchBatchPayload(const ResourceDesc *desc, OCRepPayload *const *reps,
+        const BPMeasurement *sample)
+{
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        patchPropertyPayload(desc->links[i].resource, reps[i], sample);
+    }
+}
+
+OCRepPayload *selectBatchItems(OCRepPayload *const *items, size_t count, uint32_t linkMask)
+{
+    OCRepPayload *head = nullptr;
+    OCRepPayload *tail = nullptr;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!(linkMask & (1u << i)))
+        {
+            continue;
+        }
+        if (tail)
+        {
+            tail->next = items[i];
+        }
+        else
+        {
+            head = items[i];
+        }
+        tail = items[i];
+    }
+    if (tail)
+    {
+        tail->next = nullptr;
+    }
+    return head;
+}
+
+uint32_t getLinkMask(const ResourceDesc *desc, QueryResourceType rt)
+{
+    uint32_t linkMask = 0;
+    if (rt == QUERY_RT_NONE || rt == QUERY_RT_UNKNOWN)
+    {
+        // Every link type outside the enum looks up as UNKNOWN
+        return 0;
+    }
+
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        const ResourceDesc *link = desc->links[i].resource;
+        for (size_t j = 0; j < link->typeCount; j++)
+        {
+            if (lookupQueryResourceType(link->types[j], strlen(link->types[j])) == rt)
+            {
+                linkMask |= 1u << i;
+            }
+        }
+    }
+    return linkMask;
+}
+
+uint32_t getLinkMaskByName(const ResourceDesc *desc, const char *name, size_t length)
+{
+    uint32_t linkMask = 0;
+
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        const ResourceDesc *link = desc->links[i].resource;
+        for (size_t j = 0; j < link->typeCount; j++)
+        {
+            if (strncmp(link->types[j], name, length) == 0 && link->types[j][length] == '\0')
+            {
+                linkMask |= 1u << i;
+            }
+        }
+    }
+    return linkMask;
+}
+
+void initRtLinkMasks(const ResourceDesc *desc, uint32_t *rtLinkMasks)
+{
+    for (int rt = QUERY_RT_NONE; rt <= QUERY_RT_UNKNOWN; rt++)
+    {
+        rtLinkMasks[rt] = getLinkMask(desc, (QueryResourceType)rt);
+    }
+}
+
+uint32_t getRtLinkMask(const ResourceDesc *desc, const uint32_t *rtLinkMasks,
+        const ParsedQuery *query)
+{
+    uint32_t linkMask = 0;
+    for (int rt = QUERY_RT_NONE; rt <= QUERY_RT_UNKNOWN; rt++)
+    {
+        if (query->rtMask & QUERY_RT_BIT(rt))
+        {
+            linkMask |= rtLinkMasks[rt];
+        }
+    }
+    for (size_t i = 0; i < query->unknownRtCount; i++)
+    {
+        linkMask |= getLinkMaskByName(desc, query->unknownRts[i].text,
+                query->unknownRts[i].length);
+    }
+    return linkMask;
+}
+
+QueryTarget selectQueryTarget(const ResourceDesc *desc, const uint32_t *rtLinkMasks,
+        const ParsedQuery *query, uint32_t *linkMask)
+{
+    *linkMask = 0;
+    if (query->hasSince || query->hasLimit)
+    {
+        return QUERY_TARGET_HISTORY;
+    }
+
+    switch (query->iface)
+    {
+    case QUERY_IF_BASELINE:
+        return QUERY_TARGET_BASELINE;
+    case QUERY_IF_LL:
+        return QUERY_TARGET_LL;
+    case QUERY_IF_NONE:
+    case QUERY_IF_BATCH:
+        // The Default Interface of an Atomic Measurement is oic.if.b
+        *linkMask = query->rtMask ? getRtLinkMask(desc, rtLinkMasks, query)
+                                  : (1u << desc->linkCount) - 1;
+        return *linkMask ? QUERY_TARGET_BATCH : QUERY_TARGET_REJECT;
+    default:
+        return QUERY_TARGET_REJECT;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef DESCRIPTOR_H
+#define DESCRIPTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "measurement.h"
+#include "../query.h"
+
+/* Resource descriptors: a resource type is one constant table giving its
+ * types, interfaces, properties and linked resources. The tables are laid out
+ * by the compiler (see bpmresources.h); the payload builders below and the
+ * linked resource entity handler work from them, so there is no per-type code. */
+
+#define DESCRIPTOR_MAX_LINKS    8
+#define DESCRIPTOR_URI_LENGTH   64
+
+typedef char ResourceUri[DESCRIPTOR_URI_LENGTH];
+
+/* The body a GET query of a resource with links asks for */
+typedef enum {
+    QUERY_TARGET_BATCH = 0,     // the items of the links in the link mask
+    QUERY_TARGET_BASELINE,
+    QUERY_TARGET_LL,
+    QUERY_TARGET_HISTORY,       // a time range of past samples
+    QUERY_TARGET_REJECT         // nothing the resource serves: 403
+} QueryTarget;
+
+typedef enum {
+    PROPERTY_MEASURED_INT = 0,  // one of BPMeasurement's values
+    PROPERTY_FIXED_STRING       // constant string, such as the units
+} PropertyKind;
+
+typedef struct PROPERTYDESC {
+    const char *name;
+    PropertyKind kind;
+    MeasurementValue value;     // PROPERTY_MEASURED_INT
+    const char *text;
+} PropertyDesc;
+
+typedef struct RESOURCEDESC ResourceDesc;
+
+typedef struct LINKDESC {
+    const ResourceDesc *resource;
+    bool mandatory;             // listed in rts-m as well as in rts
+} LinkDesc;
+
+struct RESOURCEDESC {
+    const char *path;           // URI below the instance prefix
+    const char *const *types;   // types[0] registers the resource
+    size_t typeCount;
+    const char *const *interfaces;  // interfaces[0] registers the resource
+    size_t interfaceCount;
+    const PropertyDesc *properties;
+    size_t propertyCount;
+    const LinkDesc *links;
+    size_t linkCount;
+    uint8_t policy;             // OC_DISCOVERABLE, OC_OBSERVABLE
+};
+
+template<typename T, size_t N>
+constexpr size_t countOf(const T (&)[N])
+{
+    return N;
+}
+
+/* Named after the value, as the sampler and the history know it */
+constexpr PropertyDesc measuredInt(MeasurementValue value)
+{
+    return PropertyDesc{ gMeasurementValueNames[value], PROPERTY_MEASURED_INT, value, nullptr };
+}
+
+constexpr PropertyDesc fixedString(const char *name, const char *text)
+{
+    return PropertyDesc{ name, PROPERTY_FIXED_STRING, MEASUREMENT_VALUE_COUNT, text };
+}
+
+/* Registers desc at uri with every type and interface it lists */
+int createDescribedResource(const ResourceDesc *desc, const char *uri, OCResourceHandle *handle,
+        OCEntityHandler handler, void *callbackParam);
+
+/* True when desc lists the interface a query asked for */
+bool hasDescribedInterface(const ResourceDesc *desc, QueryInterface iface);
+
+/* The properties of desc with the values of sample */
+OCRepPayload *createPropertyPayload(const ResourceDesc *desc, const BPMeasurement *sample);
+
+/* Body of the resource itself: its types, id and properties. The measured
+ * values are updated in place with patchPropertyPayload(). */
+OCRepPayload *createResourcePayload(const ResourceDesc *desc, const BPMeasurement *sample);
+
+/* Updates the measured properties of a createPropertyPayload() body in place */
+void patchPropertyPayload(const ResourceDesc *desc, OCRepPayload *payload,
+        const BPMeasurement *sample);
+
+/* Link to desc at href, as listed in a collection's links */
+OCRepPayload *createLinkPayload(const ResourceDesc *desc, const char *href);
+
+/* oic.if.baseline body of a collection: its types, interfaces, the types of
+ * its links and the links; linkUris holds one URI per link of desc */
+OCRepPayload *createBaselinePayload(const ResourceDesc *desc, const ResourceUri *linkUris);
+
+/* oic.if.ll body of a collection: the list of its links */
+OCRepPayload *createLinkListPayload(const ResourceDesc *desc, const ResourceUri *linkUris);
+
+/* oic.if.b body of a collection: href and rep of every link. The item of
+ * each link is stored in items, so selectBatchItems() can chain any subset of
+ * them, and its rep object in reps, so patchBatchPayload() can update it in
+ * place. Returns the first item, which heads the full body; NULL with items
+ * and reps cleared when out of memory. */
+OCRepPayload *createBatchPayload(const ResourceDesc *desc, const ResourceUri *linkUris,
+        const BPMeasurement *sample, OCRepPayload **items, OCRepPayload **reps);
+void patchBatchPayload(const ResourceDesc *desc, OCRepPayload *const *reps,
+        const BPMeasurement *sample);
+
+/* Chains the items whose bit is set in linkMask (bit i for link i) into one
+ * body and returns its head, NULL for an empty mask. The items are relinked
+ * in place: the previous body is no longer valid. */
+OCRepPayload *selectBatchItems(OCRepPayload *const *items, size_t count, uint32_t linkMask);
+
+/* Bit i set when link i of desc has resource type rt; 0 for QUERY_RT_NONE
+ * and QUERY_RT_UNKNOWN, as those name no type */
+uint32_t getLinkMask(const ResourceDesc *desc, QueryResourceType rt);
+
+/* Bit i set when link i of desc has the resource type of the given name, for
+ * the types the query parser does not know */
+uint32_t getLinkMaskByName(const ResourceDesc *desc, const char *name, size_t length);
+
+/* Fills rtLinkMasks[rt] with getLinkMask(desc, rt) for every rt up to
+ * QUERY_RT_UNKNOWN, once per descriptor */
+void initRtLinkMasks(const ResourceDesc *desc, uint32_t *rtLinkMasks);
+
+/* Links an rt query selects: every link with one of the asked for types.
+ * Types the query parser does not know are matched by name. */
+uint32_t getRtLinkMask(const ResourceDesc *desc, const uint32_t *rtLinkMasks,
+        const ParsedQuery *query);
+
+/* What a parsed GET query of desc selects, with the links of a batch body in
+ * linkMask: all of them, or those of an rt query, which is rejected when no
+ * link matches it */
+QueryTarget selectQueryTarget(const ResourceDesc *desc, const uint32_t *rtLinkMasks,
+        const ParsedQuery *query, uint32_t *linkMask);
+
+#endif
@@ -0,0 +1,237 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Measurement History
+// Description: Ring buffer of past samples with time range lookups
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "logger.h"
+#include "history.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-HISTORY"
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+size_t getDefaultHistoryCapacity(size_t instances)
+{
+    uint64_t capacity = HISTORY_DEFAULT_BUDGET / HISTORY_SAMPLE_BYTES / (instances ? instances : 1);
+    return (capacity < HISTORY_DEFAULT_CAPACITY) ? (size_t)capacity : HISTORY_DEFAULT_CAPACITY;
+}
+
+bool initHistory(MeasurementHistory *history, size_t capacity)
+{
+    pthread_rwlock_init(&history->lock, NULL);
+    history->capacity = capacity;
+    history->count = 0;
+    history->first = 0;
+    history->lastSeq = 0;
+    history->timestamp = (int64_t *)malloc(capacity * sizeof(int64_t));
+    bool allocated = (history->timestamp != NULL);
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        history->values[v] = (int32_t *)malloc(capacity * sizeof(int32_t));
+        allocated = allocated && history->values[v];
+    }
+
+    if (!allocated)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to allocate a history of %zu samples", capacity);
+        deinitHistory(history);
+        return false;
+    }
+    OIC_LOG_V(DEBUG, TAG, "History holds up to %zu samples", capacity);
+    return true;
+}
+
+void deinitHistory(MeasurementHistory *history)
+{
+    pthread_rwlock_wrlock(&history->lock);
+    free(history->timestamp);
+    history->timestamp = NULL;
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        free(history->values[v]);
+        history->values[v] = NULL;
+    }
+    history->capacity = history->count = history->first = 0;
+    pthread_rwlock_unlock(&history->lock);
+}
+
+void appendHistory(MeasurementHistory *history, const BPMeasurement *sample)
+{
+    pthread_rwlock_wrlock(&history->lock);
+    history->lastSeq = sample->seq;
+    if (history->capacity == 0)
+    {
+        pthread_rwlock_unlock(&history->lock);
+        return;
+    }
+
+    size_t last = (history->first + history->count + history->capacity - 1) % history->capacity;
+    size_t slot = (history->first + history->count) % history->capacity;
+    if (history->count == history->capacity)
+    {
+        history->first = (history->first + 1) % history->capacity;
+    }
+    else
+    {
+        history->count++;
+    }
+
+    // A clock step backwards must not break the ordering the search relies on
+    int64_t timestamp = sample->timestamp;
+    if (history->count > 1 && timestamp < history->timestamp[last])
+    {
+        timestamp = history->timestamp[last];
+    }
+
+    history->timestamp[slot] = timestamp;
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        history->values[v][slot] = sample->values[v];
+    }
+    pthread_rwlock_unlock(&history->lock);
+}
+
+/* Logical index (0 = oldest) of the first sample with timestamp >= since */
+static size_t lowerBound(const MeasurementHistory *history, int64_t since)
+{
+    size_t low = 0;
+    size_t high = history->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (history->timestamp[(history->first + mid) % history->capacity] < since)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Copies count samples from logical index start, column by column, in at
+ * most two contiguous runs per column. Called with the lock held. */
+static void copyHistory(const MeasurementHistory *history, size_t start, size_t count,
+        HistoryRange *range)
+{
+    range->count = count;
+    if (count == 0)
+    {
+        // Nothing to copy, and no ring at all in a history of capacity 0
+        return;
+    }
+    size_t physical = (history->first + start) % history->capacity;
+    size_t run = history->capacity - physical;
+    if (run > count)
+    {
+        run = count;
+    }
+    for (size_t i = 0; i < run; i++)
+    {
+        range->timestamp[i] = history->timestamp[physical + i];
+    }
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        for (size_t i = 0; i < run; i++)
+        {
+            range->values[v][i] = history->values[v][physical + i];
+        }
+    }
+    for (size_t i = run; i < count; i++)
+    {
+        range->timestamp[i] = history->timestamp[i - run];
+        for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+        {
+            range->values[v][i] = history->values[v][i - run];
+        }
+    }
+}
+
+/* Samples of the range: at most limit from the first one >= since */
+static size_t findHistoryRange(const MeasurementHistory *history, int64_t since, size_t limit,
+        size_t *start)
+{
+    *start = lowerBound(history, since);
+    size_t count = history->count - *start;
+    return (count > limit) ? limit : count;
+}
+
+bool readHistory(MeasurementHistory *history, int64_t since, size_t limit, HistoryRange *range)
+{
+    memset(range, 0, sizeof(*range));
+
+    pthread_rwlock_rdlock(&history->lock);
+    size_t start;
+    size_t count = findHistoryRange(history, since, limit, &start);
+    if (count > 0)
+    {
+        range->timestamp = (int64_t *)malloc(count * sizeof(int64_t));
+        bool allocated = (range->timestamp != NULL);
+        for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+        {
+            range->values[v] = (int64_t *)malloc(count * sizeof(int64_t));
+            allocated = allocated && range->values[v];
+        }
+        if (!allocated)
+        {
+            pthread_rwlock_unlock(&history->lock);
+            freeHistoryRange(range);
+            return false;
+        }
+        copyHistory(history, start, count, range);
+    }
+    pthread_rwlock_unlock(&history->lock);
+    return true;
+}
+
+size_t readHistoryInto(MeasurementHistory *history, int64_t since, size_t limit,
+        HistoryRange *range)
+{
+    pthread_rwlock_rdlock(&history->lock);
+    size_t start;
+    size_t count = findHistoryRange(history, since, limit, &start);
+    copyHistory(history, start, count, range);
+    pthread_rwlock_unlock(&history->lock);
+    return count;
+}
+
+size_t readHistoryAfter(MeasurementHistory *history, uint64_t afterSeq, size_t limit,
+        HistoryRange *range)
+{
+    pthread_rwlock_rdlock(&history->lock);
+    // Sequence numbers are consecutive, the newest one held last
+    size_t count = (history->lastSeq > afterSeq) ? (size_t)(history->lastSeq - afterSeq) : 0;
+    if (count > history->count)
+    {
+        count = history->count;
+    }
+    if (count > limit)
+    {
+        count = limit;
+    }
+    copyHistory(history, history->count - count, count, range);
+    pthread_rwlock_unlock(&history->lock);
+    return count;
+}
+
+void freeHistoryRange(HistoryRange *range)
+{
+    free(range->timestamp);
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        free(range->values[v]);
+    }
+    memset(range, 0, sizeof(*range));
+}
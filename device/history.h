@@ -0,0 +1,68 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "measurement.h"
+
+/* Fixed capacity ring of past samples, stored column by column so range reads
+ * and the timestamp binary search touch only the data they need. Timestamps
+ * never decrease, which keeps the ring sorted. */
+
+#define HISTORY_DEFAULT_CAPACITY    86400   // one day at one sample per second, at most
+#define HISTORY_DEFAULT_BUDGET      (256ull << 20)  // bytes shared by the default histories
+#define HISTORY_MAX_BYTES           (1ull << 30)    // over all instances, or refused
+#define HISTORY_SAMPLE_BYTES        (sizeof(int64_t) + MEASUREMENT_VALUE_COUNT * sizeof(int32_t))
+#define HISTORY_DEFAULT_LIMIT       100
+#define HISTORY_MAX_LIMIT           1000
+
+typedef struct MEASUREMENTHISTORY {
+    pthread_rwlock_t lock;
+    size_t capacity;
+    size_t count;           // samples held, up to capacity
+    size_t first;           // physical index of the oldest sample
+    uint64_t lastSeq;       // seq of the newest sample appended, kept at capacity 0
+    int64_t *timestamp;
+    int32_t *values[MEASUREMENT_VALUE_COUNT];   // a column per MeasurementValue
+} MeasurementHistory;
+
+/* Samples copied out of the history, oldest first; owned by the caller and
+ * released with freeHistoryRange() unless handed over to a payload. */
+typedef struct HISTORYRANGE {
+    size_t count;
+    int64_t *timestamp;
+    int64_t *values[MEASUREMENT_VALUE_COUNT];
+} HistoryRange;
+
+/* Samples per instance when none is asked for: a day, cut down so that the
+ * histories of all instances fit in HISTORY_DEFAULT_BUDGET */
+size_t getDefaultHistoryCapacity(size_t instances);
+
+bool initHistory(MeasurementHistory *history, size_t capacity);
+void deinitHistory(MeasurementHistory *history);
+
+/* Appends a sample, overwriting the oldest one when full */
+void appendHistory(MeasurementHistory *history, const BPMeasurement *sample);
+
+/* Copies at most limit samples with timestamp >= since, oldest first.
+ * O(log n + k). Returns false when the copy cannot be allocated. */
+bool readHistory(MeasurementHistory *history, int64_t since, size_t limit, HistoryRange *range);
+
+/* The same into columns the caller provides, each with room for limit
+ * samples; sets range->count and returns it */
+size_t readHistoryInto(MeasurementHistory *history, int64_t since, size_t limit,
+        HistoryRange *range);
+
+/* The newest samples after sample afterSeq, at most limit, oldest first, into
+ * columns the caller provides; sets range->count and returns it. Fewer come
+ * back when the oldest ones were overwritten. The sampler appends on the
+ * scheduler thread, so a task there finds its snapshot sample already in. */
+size_t readHistoryAfter(MeasurementHistory *history, uint64_t afterSeq, size_t limit,
+        HistoryRange *range);
+
+void freeHistoryRange(HistoryRange *range);
+
+#endif
@@ -0,0 +1,253 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Linked Resources
+// Description: Behaviors of the resources linked by the Atomic Measurement
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ocstack.h"
+#include "logger.h"
+#include "ocpayload.h"
+#include "linkedresources.h"
+#include "monitor.h"
+#include "bloodpressure0.h"
+#include "../common.h"
+#include "../query.h"
+#include "../hotlog.h"
+#include "../metrics.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-LINKED"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+// Events of the request path, see hotlog.h
+HOTLOG_EVENT(gLinkedRequestEvent, "bpm%u link %d: entity handler, flags 0x%x, method %d");
+HOTLOG_EVENT(gLinkedRefusedEvent, "bpm%u link %d: interface not supported, query[%s]");
+
+//-----------------------------------------------------------------------------
+// Function prototype
+//-----------------------------------------------------------------------------
+
+/* Index in gBPMLinks of the resource a request is for, or -1 */
+int findLinkedResource(const BPMonitor *monitor, OCResourceHandle handle);
+
+/* Sends payload, or an empty response when the request is refused. A cached
+ * payload must stay under the monitor's responseLock until this returns. */
+OCEntityHandlerResult sendLinkedResponse (OCEntityHandlerRequest *ehRequest,
+        OCEntityHandlerResult ehResult, OCRepPayload *payload);
+
+/* Following methods process the GET and the observe registrations */
+OCEntityHandlerResult ProcessLinkedGetRequest (BPMonitor *monitor, int link,
+        OCEntityHandlerRequest *ehRequest);
+void startLinkedObserve (BPMonitor *monitor, int link, OCObservationId obsId, const char *query);
+void stopLinkedObserve (BPMonitor *monitor, int link, OCObservationId obsId);
+
+//-----------------------------------------------------------------------------
+// Callback functions
+//-----------------------------------------------------------------------------
+
+/* Entity Handler callback functions */
+OCEntityHandlerResult
+LinkedOCEntityHandlerCb (OCEntityHandlerFlag flag,
+        OCEntityHandlerRequest *entityHandlerRequest,
+        void* callbackParam);
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+int findLinkedResource(const BPMonitor *monitor, OCResourceHandle handle)
+{
+    for (size_t i = 0; i < BPM_LINK_COUNT; i++)
+    {
+        if (monitor->linkHandles[i] == handle)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+OCEntityHandlerResult sendLinkedResponse (OCEntityHandlerRequest *ehRequest,
+        OCEntityHandlerResult ehResult, OCRepPayload *payload)
+{
+    OCEntityHandlerResponse response = { 0, 0, OC_EH_ERROR, 0, 0, { },{ 0 }, false };
+
+    response.requestHandle = ehRequest->requestHandle;
+    response.ehResult = ehResult;
+    response.payload = reinterpret_cast<OCPayload*>(payload);
+    response.numSendVendorSpecificHeaderOptions = 0;
+    memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
+    memset(response.resourceUri, 0, sizeof(response.resourceUri));
+    // Indicate that response is NOT in a persistent buffer
+    response.persistentBufferFlag = 0;
+
+    lockStack();
+    OCStackResult result = OCDoResponse(&response);
+    unlockStack();
+    if (result != OC_STACK_OK)
+    {
+        OIC_LOG(ERROR, TAG, "Error sending response");
+        return OC_EH_ERROR;
+    }
+    return ehResult;
+}
+
+OCEntityHandlerResult ProcessLinkedGetRequest (BPMonitor *monitor, int link,
+        OCEntityHandlerRequest *ehRequest)
+{
+    const ResourceDesc *desc = gBPMLinks[link].resource;
+    int metrics = gMonitors.linkMetrics[link];
+
+    ParsedQuery parsed;
+    if (!parseQuery(ehRequest->query, &parsed)
+        || (parsed.iface != QUERY_IF_NONE && !hasDescribedInterface(desc, parsed.iface)))
+    {
+        HOTLOG_TEXT(HOTLOG_INFO, gLinkedRefusedEvent, ehRequest->query, monitor->index, link);
+        countMetric(metrics, METRIC_FORBIDDEN, 1);
+        if (sendLinkedResponse(ehRequest, OC_EH_FORBIDDEN, nullptr) == OC_EH_ERROR)
+        {
+            countMetric(metrics, METRIC_RESPONSE_FAILURES, 1);
+            return OC_EH_ERROR;
+        }
+        return OC_EH_FORBIDDEN;
+    }
+
+    // The cached body is patched from the snapshot under the response lock;
+    // nothing is allocated per request
+    BPMeasurement sample;
+    readMeasurement(&monitor->snapshot, &sample);
+
+    pthread_mutex_lock(&monitor->responseLock);
+    OCRepPayload *payload = monitor->linkPayloads[link];
+    patchPropertyPayload(desc, payload, &sample);
+    OCEntityHandlerResult ehResult = sendLinkedResponse(ehRequest, OC_EH_OK, payload);
+    pthread_mutex_unlock(&monitor->responseLock);
+    if (ehResult == OC_EH_ERROR)
+    {
+        countMetric(metrics, METRIC_RESPONSE_FAILURES, 1);
+    }
+
+    return ehResult;
+}
+
+void startLinkedObserve (BPMonitor *monitor, int link, OCObservationId obsId, const char *query)
+{
+    // Notifications come from the Atomic Measurement's notifier task, which
+    // serves every resource of the instance from the same sample
+    ParsedQuery parsed;
+    parseQuery(query, &parsed);
+    int count = addObserver(&monitor->linkObservers[link], obsId, &parsed, 0, 0);
+    refreshBP0NotifyTask(monitor);
+
+    OIC_LOG_V(DEBUG, TAG, "%s: %d observer(s) registered", monitor->linkUris[link], count);
+}
+
+void stopLinkedObserve (BPMonitor *monitor, int link, OCObservationId obsId)
+{
+    int count = removeObserver(&monitor->linkObservers[link], obsId);
+    refreshBP0NotifyTask(monitor);
+
+    OIC_LOG_V(DEBUG, TAG, "%s: %d observer(s) registered", monitor->linkUris[link], count);
+}
+
+OCEntityHandlerResult
+LinkedOCEntityHandlerCb (OCEntityHandlerFlag flag,
+        OCEntityHandlerRequest *entityHandlerRequest,
+        void* callbackParam)
+{
+    // Every linked resource of an instance registers this handler with its
+    // table entry; the request's handle tells them apart
+    BPMonitor *monitor = (BPMonitor *)callbackParam;
+
+    // Validate pointer
+    if (!entityHandlerRequest)
+    {
+        OIC_LOG (ERROR, TAG, "Invalid request pointer");
+        return OC_EH_ERROR;
+    }
+
+    int link = findLinkedResource(monitor, entityHandlerRequest->resource);
+    if (link < 0)
+    {
+        OIC_LOG (ERROR, TAG, "Request for an unknown resource");
+        return OC_EH_ERROR;
+    }
+    HOTLOG(HOTLOG_DEBUG, gLinkedRequestEvent, monitor->index, link, flag,
+            entityHandlerRequest->method);
+
+    OCEntityHandlerResult ehResult = OC_EH_ERROR;
+    if (flag & OC_REQUEST_FLAG)
+    {
+        if (OC_REST_GET == entityHandlerRequest->method)
+        {
+            uint64_t receivedNs = getMetricsNs();
+            countMetric(gMonitors.linkMetrics[link], METRIC_REQUESTS, 1);
+            ehResult = ProcessLinkedGetRequest(monitor, link, entityHandlerRequest);
+            recordLatency(gMonitors.linkMetrics[link], METRIC_REQUEST_LATENCY,
+                    getMetricsNs() - receivedNs);
+        }
+        else
+        {
+            // Unsupported method, logged with the request
+            ehResult = OC_EH_METHOD_NOT_ALLOWED;
+        }
+    }
+
+    if (flag & OC_OBSERVE_FLAG)
+    {
+        if (OC_OBSERVE_REGISTER == entityHandlerRequest->obsInfo.action
+            && (flag & OC_REQUEST_FLAG) && ehResult != OC_EH_OK)
+        {
+            // The GET was refused (or its response failed): no observer
+            OIC_LOG(DEBUG, TAG, "Observe registration refused");
+        }
+        else if (OC_OBSERVE_REGISTER == entityHandlerRequest->obsInfo.action)
+        {
+            countMetric(gMonitors.linkMetrics[link], METRIC_OBSERVE_REGISTERS, 1);
+            startLinkedObserve(monitor, link, entityHandlerRequest->obsInfo.obsId,
+                    entityHandlerRequest->query);
+            ehResult = OC_EH_OK;
+        }
+        else if (OC_OBSERVE_DEREGISTER == entityHandlerRequest->obsInfo.action)
+        {
+            countMetric(gMonitors.linkMetrics[link], METRIC_OBSERVE_DEREGISTERS, 1);
+            stopLinkedObserve(monitor, link, entityHandlerRequest->obsInfo.obsId);
+            ehResult = OC_EH_OK;
+        }
+    }
+
+    return ehResult;
+}
+
+int createLinkedResources (BPMonitor *monitor)
+{
+    // The sampler has already published a first sample for the templates
+    BPMeasurement sample;
+    readMeasurement(&monitor->snapshot, &sample);
+
+    for (size_t i = 0; i < BPM_LINK_COUNT; i++)
+    {
+        monitor->linkPayloads[i] = createResourcePayload(gBPMLinks[i].resource, &sample);
+        monitor->notifyLinkPayloads[i] = createResourcePayload(gBPMLinks[i].resource, &sample);
+        if (!monitor->linkPayloads[i] || !monitor->notifyLinkPayloads[i])
+        {
+            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+            return -1;
+        }
+        if (createDescribedResource(gBPMLinks[i].resource, monitor->linkUris[i],
+                &monitor->linkHandles[i], LinkedOCEntityHandlerCb, monitor) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
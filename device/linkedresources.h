@@ -0,0 +1,12 @@
+#ifndef LINKEDRESOURCES_H
+#define LINKEDRESOURCES_H
+
+typedef struct BPMONITOR BPMonitor;
+
+/* Creates every resource the Atomic Measurement of a monitor instance links,
+ * as described by gBPMLinks. They serve the instance's latest sample and are
+ * observable; their observers are notified by the Atomic Measurement's
+ * notifier task. */
+int createLinkedResources (BPMonitor *monitor);
+
+#endif
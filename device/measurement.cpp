@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Measurement Snapshot
+// Description: Versioned, lock-free readable store of the latest sample
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "measurement.h"
+#include "../common.h"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+// Seqlock writers must not interleave
+static pthread_mutex_t gPublishLock = PTHREAD_MUTEX_INITIALIZER;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+void publishMeasurement(MeasurementSnapshot *snapshot, const int32_t *values,
+        BPMeasurement *published)
+{
+    pthread_mutex_lock(&gPublishLock);
+
+    uint32_t version = snapshot->version.load(std::memory_order_relaxed);
+    uint64_t seq = snapshot->seq.load(std::memory_order_relaxed) + 1;
+    int64_t timestamp = getTimestampMs();
+
+    snapshot->version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    snapshot->seq.store(seq, std::memory_order_relaxed);
+    snapshot->timestamp.store(timestamp, std::memory_order_relaxed);
+    for (size_t i = 0; i < MEASUREMENT_VALUE_COUNT; i++)
+    {
+        snapshot->values[i].store(values[i], std::memory_order_relaxed);
+    }
+
+    snapshot->version.store(version + 2, std::memory_order_release);
+
+    pthread_mutex_unlock(&gPublishLock);
+
+    if (published)
+    {
+        published->seq = seq;
+        published->timestamp = timestamp;
+        for (size_t i = 0; i < MEASUREMENT_VALUE_COUNT; i++)
+        {
+            published->values[i] = values[i];
+        }
+    }
+}
+
+void readMeasurement(const MeasurementSnapshot *snapshot, BPMeasurement *out)
+{
+    uint32_t before, after;
+    do
+    {
+        before = snapshot->version.load(std::memory_order_acquire);
+
+        out->seq = snapshot->seq.load(std::memory_order_relaxed);
+        out->timestamp = snapshot->timestamp.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < MEASUREMENT_VALUE_COUNT; i++)
+        {
+            out->values[i] = snapshot->values[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = snapshot->version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
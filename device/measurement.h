@@ -0,0 +1,55 @@
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/* The values measured in a sample, one line per vital sign:
+ *   X(index, property name, simulated minimum, simulated spread)
+ * The snapshot, the history, the measurement log, the sources and the time
+ * range bodies all follow this list; a descriptor property names its value by
+ * index (bpmresources.h). A new vital sign is a line here and a descriptor. */
+#define MEASUREMENT_VALUES(X) \
+    X(MEASUREMENT_SYSTOLIC,  "systolic",  110, 20)  /* mmHg */ \
+    X(MEASUREMENT_DIASTOLIC, "diastolic",  70, 20)  /* mmHg */ \
+    X(MEASUREMENT_PULSERATE, "pulserate",  50, 20)  /* beats/min */
+
+#define MEASUREMENT_VALUE_INDEX(index, name, min, spread)   index,
+#define MEASUREMENT_VALUE_NAME(index, name, min, spread)    name,
+
+typedef enum {
+    MEASUREMENT_VALUES(MEASUREMENT_VALUE_INDEX)
+    MEASUREMENT_VALUE_COUNT
+} MeasurementValue;
+
+static constexpr const char *gMeasurementValueNames[] = {
+    MEASUREMENT_VALUES(MEASUREMENT_VALUE_NAME)
+};
+
+/* One blood pressure sample, as seen by every consumer of the measurement */
+typedef struct BPMEASUREMENT {
+    uint64_t seq;           // sample sequence number, 0 before the first sample
+    int64_t timestamp;      // milliseconds since the epoch (getTimestampMs)
+    int32_t values[MEASUREMENT_VALUE_COUNT];
+} BPMeasurement;
+
+/* Latest sample behind a seqlock: writers are serialized by a mutex, readers
+ * never block and retry until they have copied one consistent sample. */
+typedef struct MEASUREMENTSNAPSHOT {
+    std::atomic<uint32_t> version;  // odd while a write is in progress
+    std::atomic<uint64_t> seq;
+    std::atomic<int64_t> timestamp;
+    std::atomic<int32_t> values[MEASUREMENT_VALUE_COUNT];
+} MeasurementSnapshot;
+
+/* Stores a new sample of MEASUREMENT_VALUE_COUNT values; seq and timestamp
+ * are assigned here. The published sample, including them, is copied to
+ * *published when it is not NULL. */
+void publishMeasurement(MeasurementSnapshot *snapshot, const int32_t *values,
+        BPMeasurement *published);
+
+/* Copies the latest sample without taking any lock */
+void readMeasurement(const MeasurementSnapshot *snapshot, BPMeasurement *out);
+
+#endif
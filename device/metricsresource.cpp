@@ -0,0 +1,320 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Metrics Resource
+// Description: Defines "x.kr.re.etri.metrics", the server's runtime metrics
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ocstack.h"
+#include "logger.h"
+#include "ocpayload.h"
+#include "metricsresource.h"
+#include "descriptor.h"
+#include "../common.h"
+#include "../query.h"
+#include "../metrics.h"
+#include "../arena.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-METRICS-RESOURCE"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static OCResourceHandle gMetricsHandle = NULL;
+
+//-----------------------------------------------------------------------------
+// Function prototype
+//-----------------------------------------------------------------------------
+
+OCRepPayload *createMetricsPayload(bool baseline);
+OCRepPayload *createArenaMetricsPayload(bool baseline, Arena *arena);
+OCEntityHandlerResult ProcessMetricsGetRequest (OCEntityHandlerRequest *ehRequest);
+
+//-----------------------------------------------------------------------------
+// Callback functions
+//-----------------------------------------------------------------------------
+
+/* Entity Handler callback functions */
+OCEntityHandlerResult
+MetricsOCEntityHandlerCb (OCEntityHandlerFlag flag,
+        OCEntityHandlerRequest *entityHandlerRequest,
+        void* callbackParam);
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static_assert(countOf(gMetricsLatencyFields) == 5, "count, p50, p90, p99 and max");
+
+/* The values of gMetricsLatencyFields, in its order */
+static void getLatencyFieldValues(const LatencySummary *latency, uint64_t *values)
+{
+    values[0] = latency->count;
+    values[1] = latency->p50;
+    values[2] = latency->p90;
+    values[3] = latency->p99;
+    values[4] = latency->max;
+}
+
+/* Latencies in ns: count, p50, p90, p99 and max */
+static OCRepPayload *createLatencyPayload(const LatencySummary *latency)
+{
+    OCRepPayload *payload = OCRepPayloadCreate();
+    if (!payload)
+    {
+        return NULL;
+    }
+    uint64_t values[countOf(gMetricsLatencyFields)];
+    getLatencyFieldValues(latency, values);
+    for (size_t i = 0; i < countOf(gMetricsLatencyFields); i++)
+    {
+        OCRepPayloadSetPropInt(payload, gMetricsLatencyFields[i], (int64_t)values[i]);
+    }
+    return payload;
+}
+
+static OCRepPayload *createSourcePayload(int source)
+{
+    MetricsSummary summary;
+    readMetrics(source, &summary);
+
+    OCRepPayload *payload = OCRepPayloadCreate();
+    if (!payload)
+    {
+        return NULL;
+    }
+    OCRepPayloadSetPropString(payload, "name", getMetricsSourceName(source));
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+    {
+        OCRepPayloadSetPropInt(payload, gMetricsCounterProperties[c], (int64_t)summary.counters[c]);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+    {
+        OCRepPayload *latency = createLatencyPayload(&summary.latency[h]);
+        if (!latency || !OCRepPayloadSetPropObjectAsOwner(payload, gMetricsLatencyProperties[h],
+                latency))
+        {
+            OCRepPayloadDestroy(latency);
+            OCRepPayloadDestroy(payload);
+            return NULL;
+        }
+    }
+    return payload;
+}
+
+/* Built per request: the values change all the time, so there is nothing
+ * to cache */
+OCRepPayload *createMetricsPayload(bool baseline)
+{
+    OCRepPayload *payload = OCRepPayloadCreate();
+    int count = getMetricsSourceCount();
+    OCRepPayload **sources = (OCRepPayload **)calloc(count > 0 ? count : 1,
+            sizeof(OCRepPayload *));
+    if (!payload || !sources)
+    {
+        OCRepPayloadDestroy(payload);
+        free(sources);
+        return NULL;
+    }
+
+    if (baseline)
+    {
+        OCRepPayloadAddResourceType(payload, METRICS_RESOURCE_TYPE);
+        for (size_t i = 0; i < countOf(gMetricsInterfaces); i++)
+        {
+            OCRepPayloadAddInterface(payload, gMetricsInterfaces[i]);
+        }
+    }
+
+    for (int source = 0; source < count; source++)
+    {
+        sources[source] = createSourcePayload(source);
+        if (!sources[source])
+        {
+            for (int i = 0; i < source; i++)
+            {
+                OCRepPayloadDestroy(sources[i]);
+            }
+            free(sources);
+            OCRepPayloadDestroy(payload);
+            return NULL;
+        }
+    }
+    // The payload takes over the array and the objects
+    size_t dimensions[MAX_REP_ARRAY_DEPTH] = { (size_t)count, 0, 0 };
+    OCRepPayloadSetPropObjectArrayAsOwner(payload, "resources", sources, dimensions);
+    return payload;
+}
+
+static OCRepPayload *createArenaLatencyPayload(const LatencySummary *latency, Arena *arena)
+{
+    OCRepPayload *payload = createArenaPayload(arena);
+    if (!payload)
+    {
+        return NULL;
+    }
+    uint64_t values[countOf(gMetricsLatencyFields)];
+    getLatencyFieldValues(latency, values);
+    for (size_t i = 0; i < countOf(gMetricsLatencyFields); i++)
+    {
+        if (!setArenaPropInt(arena, payload, gMetricsLatencyFields[i], (int64_t)values[i]))
+        {
+            return NULL;
+        }
+    }
+    return payload;
+}
+
+static OCRepPayload *createArenaSourcePayload(int source, Arena *arena)
+{
+    MetricsSummary summary;
+    readMetrics(source, &summary);
+
+    OCRepPayload *payload = createArenaPayload(arena);
+    if (!payload || !setArenaPropString(arena, payload, "name", getMetricsSourceName(source)))
+    {
+        return NULL;
+    }
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+    {
+        if (!setArenaPropInt(arena, payload, gMetricsCounterProperties[c],
+                (int64_t)summary.counters[c]))
+        {
+            return NULL;
+        }
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+    {
+        OCRepPayload *latency = createArenaLatencyPayload(&summary.latency[h], arena);
+        if (!latency || !setArenaPropObject(arena, payload, gMetricsLatencyProperties[h], latency))
+        {
+            return NULL;
+        }
+    }
+    return payload;
+}
+
+/* The same body in the calling thread's arena; source names are registered
+ * once and outlive any response, so they are not copied */
+OCRepPayload *createArenaMetricsPayload(bool baseline, Arena *arena)
+{
+    OCRepPayload *payload = createArenaPayload(arena);
+    int count = getMetricsSourceCount();
+    OCRepPayload **sources = (OCRepPayload **)allocArena(arena, count * sizeof(OCRepPayload *));
+    if (!payload || !sources)
+    {
+        return NULL;
+    }
+
+    if (baseline)
+    {
+        addArenaResourceType(arena, payload, METRICS_RESOURCE_TYPE);
+        for (size_t i = 0; i < countOf(gMetricsInterfaces); i++)
+        {
+            addArenaInterface(arena, payload, gMetricsInterfaces[i]);
+        }
+    }
+
+    for (int source = 0; source < count; source++)
+    {
+        if (!(sources[source] = createArenaSourcePayload(source, arena)))
+        {
+            return NULL;
+        }
+    }
+    return setArenaObjectArray(arena, payload, "resources", sources, count) ? payload : NULL;
+}
+
+OCEntityHandlerResult ProcessMetricsGetRequest (OCEntityHandlerRequest *ehRequest)
+{
+    OCEntityHandlerResult ehResult = OC_EH_OK;
+    OCRepPayload *payload = nullptr;
+    Arena *arena = getResponseArena();
+
+    ParsedQuery parsed;
+    if (!parseQuery(ehRequest->query, &parsed)
+        || (parsed.iface != QUERY_IF_NONE && !hasDescribedInterface(&gMetricsResource, parsed.iface)))
+    {
+        ehResult = OC_EH_FORBIDDEN;
+    }
+    else
+    {
+        bool baseline = (parsed.iface == QUERY_IF_BASELINE);
+        payload = arena ? createArenaMetricsPayload(baseline, arena) : createMetricsPayload(baseline);
+        if (!payload)
+        {
+            OIC_LOG(ERROR, TAG, PCF("Failed to allocate Payload"));
+            if (arena)
+            {
+                resetArena(arena);
+            }
+            return OC_EH_ERROR;
+        }
+    }
+
+    OCEntityHandlerResponse response = { 0, 0, OC_EH_ERROR, 0, 0, { },{ 0 }, false };
+    response.requestHandle = ehRequest->requestHandle;
+    response.ehResult = ehResult;
+    response.payload = reinterpret_cast<OCPayload*>(payload);
+    response.numSendVendorSpecificHeaderOptions = 0;
+    memset(response.sendVendorSpecificHeaderOptions, 0, sizeof response.sendVendorSpecificHeaderOptions);
+    memset(response.resourceUri, 0, sizeof(response.resourceUri));
+    // Indicate that response is NOT in a persistent buffer
+    response.persistentBufferFlag = 0;
+
+    lockStack();
+    OCStackResult result = OCDoResponse(&response);
+    unlockStack();
+    if (result != OC_STACK_OK)
+    {
+        OIC_LOG(ERROR, TAG, "Error sending response");
+        ehResult = OC_EH_ERROR;
+    }
+    if (arena)
+    {
+        resetArena(arena);
+    }
+    else
+    {
+        OCRepPayloadDestroy(payload);
+    }
+    return ehResult;
+}
+
+OCEntityHandlerResult
+MetricsOCEntityHandlerCb (OCEntityHandlerFlag flag,
+        OCEntityHandlerRequest *entityHandlerRequest,
+        void* callbackParam)
+{
+    // Validate pointer
+    if (!entityHandlerRequest)
+    {
+        OIC_LOG (ERROR, TAG, "Invalid request pointer");
+        return OC_EH_ERROR;
+    }
+
+    if (!(flag & OC_REQUEST_FLAG))
+    {
+        OIC_LOG(ERROR, TAG, "Flag Error!");
+        return OC_EH_ERROR;
+    }
+    if (OC_REST_GET != entityHandlerRequest->method)
+    {
+        // Read only
+        return OC_EH_METHOD_NOT_ALLOWED;
+    }
+    return ProcessMetricsGetRequest(entityHandlerRequest);
+}
+
+int createMetricsResource(void)
+{
+    return createDescribedResource(&gMetricsResource, gMetricsResource.path, &gMetricsHandle,
+            MetricsOCEntityHandlerCb, NULL);
+}
@@ -0,0 +1,46 @@
+#ifndef METRICSRESOURCE_H
+#define METRICSRESOURCE_H
+
+#include "descriptor.h"
+#include "../metrics.h"
+
+/* Vendor resource serving the runtime metrics (metrics.h) of every source:
+ * the counters and the latency percentiles, read only. In secure mode it
+ * needs an ACL entry like the other resources. The descriptor and property
+ * names are here for iddgen as well. */
+
+#define METRICS_RESOURCE_URI    "/metrics"
+#define METRICS_RESOURCE_TYPE   "x.kr.re.etri.metrics"
+
+static constexpr const char *gMetricsTypes[] = { METRICS_RESOURCE_TYPE };
+static constexpr const char *gMetricsInterfaces[] = {
+    OC_RSRVD_INTERFACE_READ, OC_RSRVD_INTERFACE_DEFAULT
+};
+static constexpr ResourceDesc gMetricsResource = {
+    METRICS_RESOURCE_URI,
+    gMetricsTypes, countOf(gMetricsTypes),
+    gMetricsInterfaces, countOf(gMetricsInterfaces),
+    nullptr, 0,
+    nullptr, 0,
+    OC_DISCOVERABLE
+};
+
+// Property names of a source's object in "resources", in MetricCounter and
+// MetricHistogram order; a latency object has gMetricsLatencyFields
+static constexpr const char *gMetricsCounterProperties[] = {
+    "requests", "observeRegisters", "observeDeregisters", "notifications", "forbidden",
+    "responseFailures", "samplesCoalesced", "samplesMerged"
+};
+static constexpr const char *gMetricsLatencyProperties[] = {
+    "requestLatency", "notifyLatency"
+};
+static constexpr const char *gMetricsLatencyFields[] = { "count", "p50", "p90", "p99", "max" };
+
+static_assert(countOf(gMetricsCounterProperties) == METRIC_COUNTER_COUNT,
+        "a property per metrics counter");
+static_assert(countOf(gMetricsLatencyProperties) == METRIC_HISTOGRAM_COUNT,
+        "a property per latency histogram");
+
+int createMetricsResource(void);
+
+#endif
@@ -0,0 +1,151 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Monitor Table
+// Description: Index-addressed table of the hosted monitor instances
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "logger.h"
+#include "monitor.h"
+#include "bloodpressure0.h"
+#include "linkedresources.h"
+#include "../common.h"
+#include "../metrics.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-MONITOR"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+MonitorTable gMonitors = { NULL, 0, -1, { } };
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static void setMonitorUris(BPMonitor *monitor)
+{
+    char prefix[16] = "";
+    if (monitor->index > 0)
+    {
+        snprintf(prefix, sizeof(prefix), "/bpm%u", monitor->index);
+    }
+    snprintf(monitor->amUri, sizeof(ResourceUri), "%s%s", prefix, gBPMResource.path);
+    for (size_t i = 0; i < BPM_LINK_COUNT; i++)
+    {
+        snprintf(monitor->linkUris[i], sizeof(ResourceUri), "%s%s", prefix,
+                gBPMLinks[i].resource->path);
+    }
+}
+
+int initMonitorTable(size_t count, size_t historyCapacity)
+{
+    if (count == 0 || count > MONITOR_MAX_INSTANCES)
+    {
+        OIC_LOG_V(ERROR, TAG, "Instance count must be 1..%d", MONITOR_MAX_INSTANCES);
+        return -1;
+    }
+    // The sampler fills every ring, so all of it becomes resident in time
+    if (historyCapacity > HISTORY_MAX_BYTES / HISTORY_SAMPLE_BYTES / count)
+    {
+        OIC_LOG_V(ERROR, TAG, "%zu instances of %zu history samples take over %llu MiB",
+                count, historyCapacity, (unsigned long long)(HISTORY_MAX_BYTES >> 20));
+        return -1;
+    }
+
+    // Zeroed memory is a valid initial state for the atomics and pointers
+    gMonitors.monitors = (BPMonitor *)calloc(count, sizeof(BPMonitor));
+    if (!gMonitors.monitors)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate the monitor table");
+        return -1;
+    }
+    gMonitors.count = count;
+    gMonitors.amMetrics = registerMetricsSource(gBPMResource.types[0]);
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        gMonitors.linkMetrics[link] = registerMetricsSource(gBPMLinks[link].resource->types[0]);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        BPMonitor *monitor = getMonitor(i);
+        monitor->index = (uint32_t)i;
+        setMonitorUris(monitor);
+        pthread_mutex_init(&monitor->responseLock, NULL);
+        pthread_mutex_init(&monitor->observeLock, NULL);
+        initObserverRegistry(&monitor->observers);
+        for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+        {
+            initObserverRegistry(&monitor->linkObservers[link]);
+        }
+        if (historyCapacity == 0)
+        {
+            // Empty history: range queries return no samples
+            pthread_rwlock_init(&monitor->history.lock, NULL);
+        }
+        else if (!initHistory(&monitor->history, historyCapacity))
+        {
+            return -1;
+        }
+    }
+    OIC_LOG_V(INFO, TAG, "%zu monitor instance(s)", count);
+    return 0;
+}
+
+void deinitMonitorTable(void)
+{
+    for (size_t i = 0; i < gMonitors.count; i++)
+    {
+        BPMonitor *monitor = getMonitor(i);
+        deinitHistory(&monitor->history);
+        deinitObserverRegistry(&monitor->observers);
+        for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+        {
+            deinitObserverRegistry(&monitor->linkObservers[link]);
+        }
+        freeObserverIdList(&monitor->dueObservers);
+        pthread_mutex_destroy(&monitor->responseLock);
+        pthread_mutex_destroy(&monitor->observeLock);
+    }
+    free(gMonitors.monitors);
+    gMonitors.monitors = NULL;
+    gMonitors.count = 0;
+}
+
+int createMonitorResources(void)
+{
+    for (size_t i = 0; i < gMonitors.count; i++)
+    {
+        BPMonitor *monitor = getMonitor(i);
+        if (createBP0Resource(monitor) != 0 || createLinkedResources(monitor) != 0)
+        {
+            OIC_LOG_V(ERROR, TAG, "Failed to create the resources of instance %zu", i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void logMonitorFootprint(void)
+{
+    size_t historyBytes = 0;
+    if (gMonitors.count > 0)
+    {
+        // Reserved up front; pages become resident as the ring fills
+        historyBytes = getMonitor(0)->history.capacity * HISTORY_SAMPLE_BYTES;
+    }
+    OIC_LOG_V(INFO, TAG, "Per instance: %zu bytes of table, %zu bytes of history; "
+            "process resident %ld kB for %zu instance(s)",
+            sizeof(BPMonitor), historyBytes, getResidentKb(), gMonitors.count);
+}
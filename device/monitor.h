@@ -0,0 +1,99 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "ocstack.h"
+#include "ocpayload.h"
+#include "measurement.h"
+#include "history.h"
+#include "bpmresources.h"
+#include "../observers.h"
+#include "../scheduler.h"
+
+/* Every blood pressure monitor hosted by the process: an Atomic Measurement
+ * with the resources it links (bpmresources.h), and all of their state. Instances live in
+ * one contiguous table and are addressed by index; instance 0 keeps the
+ * original URIs, instance i > 0 is served under "/bpm<i>". */
+
+#define MONITOR_MAX_INSTANCES   4096
+
+typedef struct BPMONITOR {
+    uint32_t index;
+    ResourceUri amUri;
+    ResourceUri linkUris[BPM_LINK_COUNT];   // in gBPMLinks order
+    OCResourceHandle amHandle;
+    OCResourceHandle linkHandles[BPM_LINK_COUNT];
+
+    // Latest sample and the samples before it
+    MeasurementSnapshot snapshot;
+    MeasurementHistory history;
+
+    // Response cache: the baseline and ll bodies never change, the batch body
+    // and the bodies of the linked resources are templates whose measurement
+    // values are patched before each response. The batch items are chained
+    // per response, all of them or the ones an rt query selects.
+    OCRepPayload *baselinePayload;
+    OCRepPayload *linkListPayload;
+    OCRepPayload *batchItems[BPM_LINK_COUNT];
+    OCRepPayload *batchReps[BPM_LINK_COUNT];
+    OCRepPayload *linkPayloads[BPM_LINK_COUNT];
+    pthread_mutex_t responseLock;   // template patching, chaining + OCDoResponse
+
+    // Notification bodies: the notifier's own batch and linked resource
+    // templates, patched once per sample on the scheduler thread and shared
+    // by every observer of that body; the baseline and ll bodies above never
+    // change and are shared as they are. None of it is under responseLock,
+    // so a long fan-out does not hold up the GETs.
+    OCRepPayload *notifyBatchItems[BPM_LINK_COUNT];
+    OCRepPayload *notifyBatchReps[BPM_LINK_COUNT];
+    OCRepPayload *notifyLinkPayloads[BPM_LINK_COUNT];
+    uint64_t notifySeq;             // sample patched into them
+
+    // Observe state: one scheduler task serves the observers of all the
+    // instance's resources; it runs while at least one observer is
+    // registered, at the smallest pmin any of them asked for
+    ObserverRegistry observers;
+    ObserverRegistry linkObservers[BPM_LINK_COUNT];
+    ObserverIdList dueObservers;
+    pthread_mutex_t observeLock;
+    SchedulerTask *notifyTask;
+    uint32_t notifyPeriodMs;
+
+    // Change detection: the last sample that moved past the deadband, and when
+    BPMeasurement reference;
+    uint64_t lastChangeMs;
+    uint64_t lastSeq;
+} BPMonitor;
+
+typedef struct MONITORTABLE {
+    BPMonitor *monitors;
+    size_t count;
+    // Metrics sources (metrics.h), one per resource type over all instances
+    int amMetrics;
+    int linkMetrics[BPM_LINK_COUNT];
+} MonitorTable;
+
+extern MonitorTable gMonitors;
+
+/* Allocates count instances with their URIs, locks and histories of
+ * historyCapacity samples each; refuses histories over HISTORY_MAX_BYTES in
+ * all. Resources are created separately. */
+int initMonitorTable(size_t count, size_t historyCapacity);
+void deinitMonitorTable(void);
+
+static inline BPMonitor *getMonitor(size_t index)
+{
+    return &gMonitors.monitors[index];
+}
+
+/* Registers the three resources of every instance with the stack */
+int createMonitorResources(void);
+
+/* Logs the memory held per instance (table entry, history, cached payloads) */
+void logMonitorFootprint(void);
+
+#endif
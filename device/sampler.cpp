@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Sampler
+// Description: Periodic task moving readings from a source to the snapshot
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "logger.h"
+#include "sampler.h"
+#include "monitor.h"
+#include "../scheduler.h"
+#include "../measurementlog.h"
+#include "../hotlog.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-SAMPLER"
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static const MeasurementSource *gSource = NULL;
+static SchedulerTask *gSampleTask = NULL;
+static uint32_t gSamplePeriodMs = SAMPLER_DEFAULT_PERIOD_MS;
+static uint64_t gSourceErrors = 0;
+
+// One event per instance and round, see hotlog.h
+HOTLOG_EVENT(gSampleEvent, "bpm%u: sample %s[%d]");
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+/* When the next round is due: the source decides if it keeps a pace */
+static uint32_t advanceSource()
+{
+    uint32_t delay = gSource->advance ? gSource->advance() : 0;
+    return delay ? delay : gSamplePeriodMs;
+}
+
+static void sampleMonitor(BPMonitor *monitor)
+{
+    BPReading reading;
+    SourceResult result = gSource->read(monitor->index, &reading);
+    if (result != SOURCE_SAMPLE)
+    {
+        if (result == SOURCE_ERROR && gSourceErrors++ == 0)
+        {
+            OIC_LOG_V(ERROR, TAG, "%s source failed, keeping the last sample", gSource->name);
+        }
+        return;
+    }
+
+    BPMeasurement sample;
+    publishMeasurement(&monitor->snapshot, reading.values, &sample);
+    appendHistory(&monitor->history, &sample);
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        HOTLOG_TEXT(HOTLOG_DEBUG, gSampleEvent, gMeasurementValueNames[v], monitor->index,
+                sample.values[v]);
+    }
+
+    appendMeasurementLog(monitor->index, sample.seq, sample.timestamp, sample.values);
+}
+
+/* Scheduler task: one reading per instance, published to every consumer */
+void sampleMeasurement(void *ctx)
+{
+    for (size_t i = 0; i < gMonitors.count; i++)
+    {
+        sampleMonitor(getMonitor(i));
+    }
+
+    uint32_t delay = advanceSource();
+    if (gSampleTask)
+    {
+        setTaskPeriod(gSampleTask, delay);
+    }
+}
+
+int startSampler(const SamplerConfig *config)
+{
+    gSource = config->source;
+    if (!gSource->open(config->sourceArg))
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot open %s source", gSource->name);
+        return -1;
+    }
+
+    gSamplePeriodMs = config->periodMs;
+    for (size_t i = 0; i < gMonitors.count; i++)
+    {
+        sampleMonitor(getMonitor(i));
+    }
+    gSampleTask = scheduleTask(sampleMeasurement, NULL, advanceSource());
+    if (!gSampleTask)
+    {
+        gSource->close();
+        return -1;
+    }
+    OIC_LOG_V(INFO, TAG, "Sampling the %s source every %u ms", gSource->name, config->periodMs);
+    return 0;
+}
+
+void stopSampler(void)
+{
+    if (!gSource)
+    {
+        return;
+    }
+    cancelTask(gSampleTask);
+    gSampleTask = NULL;
+    gSource->close();
+    gSource = NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "source.h"
+
+/* The sampler is the only producer of measurements: a scheduler task reads
+ * the source every periodMs for every monitor instance and publishes to the
+ * instance's snapshot and history, and for instance 0 to the measurement
+ * log. Requests and notifications only read the snapshot. */
+
+#define SAMPLER_DEFAULT_PERIOD_MS 1000
+
+typedef struct SAMPLERCONFIG {
+    const MeasurementSource *source;
+    const char *sourceArg;      // passed to source->open(), may be NULL
+    uint32_t periodMs;
+} SamplerConfig;
+
+/* Opens the source, takes a first sample right away so the resources start
+ * from real values, then schedules the periodic task. Needs the scheduler
+ * and the monitor table. */
+int startSampler(const SamplerConfig *config);
+
+/* Cancels the task and closes the source */
+void stopSampler(void);
+
+#endif
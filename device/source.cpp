@@ -0,0 +1,406 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Measurement Sources
+// Description: Simulator, trace player and hardware backends of the sampler
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <atomic>
+#include "logger.h"
+#include "source.h"
+#include "../common.h"
+#include "../measurementlog.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-SOURCE"
+
+#define HW_LINE_LENGTH 128
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+// Simulator: every thread gets its own generator state, seeded on first use
+static std::atomic<uint64_t> gSimSeed(0);
+static std::atomic<uint64_t> gSimStreams(0);
+static __thread uint64_t tSimState = 0;
+
+// Simulated range of each measured value, from MEASUREMENT_VALUES
+#define SIM_VALUE_RANGE(index, name, min, spread)   { min, spread },
+static const struct {
+    int32_t low;
+    uint32_t span;
+} gSimRanges[] = {
+    MEASUREMENT_VALUES(SIM_VALUE_RANGE)
+};
+
+// Trace player: the whole file is loaded at open. Timestamps are kept only
+// when every reading has one.
+static BPReading *gTraceReadings = NULL;
+static int64_t *gTraceTimestamps = NULL;
+static size_t gTraceCount = 0;
+static size_t gTraceCapacity = 0;
+static size_t gTraceNext = 0;
+
+// Hardware: non-blocking device and the partial line read so far
+static int gHwFd = -1;
+static char gHwLine[HW_LINE_LENGTH];
+static size_t gHwLineLength = 0;
+
+static const MeasurementSource *gSources[] = {
+    &gSimulatorSource,
+    &gTraceSource,
+    &gHardwareSource
+};
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+/* Parses one column per measured value ("systolic,diastolic,pulserate"),
+ * optionally preceded by a timestamp which is stored in *timestamp (-1 when
+ * absent) if timestamp is not NULL */
+static bool parseReadingLine(const char *line, BPReading *reading, int64_t *timestamp)
+{
+    long long v[MEASUREMENT_VALUE_COUNT + 1];
+    size_t n = 0;
+    const char *p = line;
+    while (n < MEASUREMENT_VALUE_COUNT + 1)
+    {
+        char *end;
+        v[n] = strtoll(p, &end, 10);
+        if (end == p)
+        {
+            break;
+        }
+        n++;
+        if (*end != ',')
+        {
+            break;
+        }
+        p = end + 1;
+    }
+    if (n < MEASUREMENT_VALUE_COUNT)
+    {
+        return false;
+    }
+    size_t first = n - MEASUREMENT_VALUE_COUNT;
+    if (timestamp)
+    {
+        *timestamp = first ? v[0] : -1;
+    }
+    for (size_t i = 0; i < MEASUREMENT_VALUE_COUNT; i++)
+    {
+        reading->values[i] = (int32_t)v[first + i];
+    }
+    return true;
+}
+
+static uint64_t splitMix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/* xorshift64*: a few cycles per value and no shared state between threads */
+static uint64_t nextSimRandom()
+{
+    if (tSimState == 0)
+    {
+        tSimState = splitMix64(gSimSeed + gSimStreams.fetch_add(1)) | 1;
+    }
+    tSimState ^= tSimState >> 12;
+    tSimState ^= tSimState << 25;
+    tSimState ^= tSimState >> 27;
+    return tSimState * 0x2545F4914F6CDD1Dull;
+}
+
+/* Uniform value in [low, low + span) */
+static int32_t simRange(int32_t low, uint32_t span)
+{
+    return low + (int32_t)(((nextSimRandom() >> 32) * span) >> 32);
+}
+
+static bool openSimulator(const char *arg)
+{
+    if (arg)
+    {
+        gSimSeed = strtoull(arg, NULL, 0);
+    }
+    else
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        gSimSeed = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+    }
+    tSimState = 0;
+    OIC_LOG_V(INFO, TAG, "Simulator seed %llu", (unsigned long long)gSimSeed.load());
+    return true;
+}
+
+static SourceResult readSimulator(uint32_t instance, BPReading *reading)
+{
+    for (size_t i = 0; i < MEASUREMENT_VALUE_COUNT; i++)
+    {
+        reading->values[i] = simRange(gSimRanges[i].low, gSimRanges[i].span);
+    }
+    return SOURCE_SAMPLE;
+}
+
+static void closeSimulator()
+{
+}
+
+static bool addTraceReading(const BPReading *reading, int64_t timestamp)
+{
+    if (gTraceCount == gTraceCapacity)
+    {
+        size_t capacity = gTraceCapacity ? gTraceCapacity * 2 : 256;
+        BPReading *readings = (BPReading *)realloc(gTraceReadings, capacity * sizeof(BPReading));
+        if (readings)
+        {
+            gTraceReadings = readings;
+        }
+        int64_t *timestamps = (int64_t *)realloc(gTraceTimestamps, capacity * sizeof(int64_t));
+        if (timestamps)
+        {
+            gTraceTimestamps = timestamps;
+        }
+        if (!readings || !timestamps)
+        {
+            return false;
+        }
+        gTraceCapacity = capacity;
+    }
+    gTraceReadings[gTraceCount] = *reading;
+    gTraceTimestamps[gTraceCount] = timestamp;
+    gTraceCount++;
+    return true;
+}
+
+/* CSV: one reading per line, '#' starts a comment line */
+static bool loadCsvTrace(FILE *fp)
+{
+    char line[HW_LINE_LENGTH];
+    while (fgets(line, sizeof(line), fp))
+    {
+        BPReading reading;
+        int64_t timestamp;
+        if (line[0] == '#' || !parseReadingLine(line, &reading, &timestamp))
+        {
+            continue;
+        }
+        if (!addTraceReading(&reading, timestamp))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Measurement log segment, read as the log's recovery does: up to the first
+ * record that fails its CRC or does not follow the one before. The readings
+ * are instance 0's; the other instances play them shifted, as any trace. */
+static bool loadLogTrace(FILE *fp)
+{
+    MeasurementRecord record;
+    uint64_t lastSeq = 0;
+    while (fread(&record, sizeof(record), 1, fp) == 1
+            && isValidMeasurementRecord(&record) && record.seq > lastSeq)
+    {
+        lastSeq = record.seq;
+        if (record.instance != 0)
+        {
+            continue;
+        }
+        BPReading reading;
+        memcpy(reading.values, record.values, sizeof(reading.values));
+        if (!addTraceReading(&reading, record.timestamp))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool openTrace(const char *arg)
+{
+    if (!arg)
+    {
+        OIC_LOG(ERROR, TAG, "trace source needs a file: trace:<file>");
+        return false;
+    }
+    FILE *fp = fopen(arg, "r");
+    if (!fp)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot open trace %s: %s", arg, strerror(errno));
+        return false;
+    }
+
+    size_t len = strlen(arg);
+    bool binary = (len > 4 && 0 == strcmp(arg + len - 4, ".log"));
+    bool loaded = binary ? loadLogTrace(fp) : loadCsvTrace(fp);
+    fclose(fp);
+
+    if (!loaded || gTraceCount == 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Trace %s has no readings", arg);
+        return false;
+    }
+
+    // Replay at the recorded pace only when the spacing is known everywhere
+    bool timed = true;
+    for (size_t i = 0; i < gTraceCount; i++)
+    {
+        if (gTraceTimestamps[i] < 0)
+        {
+            timed = false;
+            break;
+        }
+    }
+    if (!timed)
+    {
+        free(gTraceTimestamps);
+        gTraceTimestamps = NULL;
+    }
+
+    gTraceNext = 0;
+    OIC_LOG_V(INFO, TAG, "Trace %s: %zu readings%s", arg, gTraceCount,
+            timed ? ", replayed at their recorded spacing" : "");
+    return true;
+}
+
+static SourceResult readTrace(uint32_t instance, BPReading *reading)
+{
+    *reading = gTraceReadings[(gTraceNext + instance) % gTraceCount];
+    return SOURCE_SAMPLE;
+}
+
+/* Steps to the next reading; returns its gap to the one just played */
+static uint32_t advanceTrace()
+{
+    gTraceNext = (gTraceNext + 1) % gTraceCount;
+    if (!gTraceTimestamps || gTraceNext == 0)
+    {
+        // Untimed trace, or wrapping around: one sampler period
+        return 0;
+    }
+    int64_t delay = gTraceTimestamps[gTraceNext] - gTraceTimestamps[gTraceNext - 1];
+    if (delay < 1)
+    {
+        return 1;
+    }
+    return (delay > UINT32_MAX) ? UINT32_MAX : (uint32_t)delay;
+}
+
+static void closeTrace()
+{
+    free(gTraceReadings);
+    free(gTraceTimestamps);
+    gTraceReadings = NULL;
+    gTraceTimestamps = NULL;
+    gTraceCount = gTraceCapacity = 0;
+}
+
+static bool openHardware(const char *arg)
+{
+    const char *device = arg ? arg : HW_DEFAULT_DEVICE;
+    gHwFd = open(device, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+    if (gHwFd < 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot open %s: %s", device, strerror(errno));
+        return false;
+    }
+    gHwLineLength = 0;
+    OIC_LOG_V(INFO, TAG, "Reading measurements from %s", device);
+    return true;
+}
+
+/* Consumes whatever the device has sent; the last complete line wins */
+static SourceResult readHardware(uint32_t instance, BPReading *reading)
+{
+    SourceResult result = SOURCE_NO_SAMPLE;
+    if (instance > 0)
+    {
+        return result;
+    }
+    char buf[256];
+    ssize_t len;
+    while ((len = read(gHwFd, buf, sizeof(buf))) > 0)
+    {
+        for (ssize_t i = 0; i < len; i++)
+        {
+            if (buf[i] != '\n' && buf[i] != '\r')
+            {
+                // Overlong lines are garbage; drop them
+                if (gHwLineLength < sizeof(gHwLine) - 1)
+                {
+                    gHwLine[gHwLineLength++] = buf[i];
+                }
+                continue;
+            }
+            gHwLine[gHwLineLength] = '\0';
+            if (gHwLineLength > 0 && parseReadingLine(gHwLine, reading, NULL))
+            {
+                result = SOURCE_SAMPLE;
+            }
+            gHwLineLength = 0;
+        }
+    }
+    if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+        OIC_LOG_V(ERROR, TAG, "Device read failed: %s", strerror(errno));
+        return SOURCE_ERROR;
+    }
+    return result;
+}
+
+static void closeHardware()
+{
+    if (gHwFd >= 0)
+    {
+        close(gHwFd);
+        gHwFd = -1;
+    }
+}
+
+const MeasurementSource gSimulatorSource = { "sim", openSimulator, readSimulator, closeSimulator, NULL };
+const MeasurementSource gTraceSource = { "trace", openTrace, readTrace, closeTrace, advanceTrace };
+const MeasurementSource gHardwareSource = { "hw", openHardware, readHardware, closeHardware, NULL };
+
+const MeasurementSource *getDefaultMeasurementSource(void)
+{
+#if USE_HW
+    return &gHardwareSource;
+#else
+    return &gSimulatorSource;
+#endif
+}
+
+const MeasurementSource *findMeasurementSource(const char *name)
+{
+    for (size_t i = 0; i < sizeof(gSources) / sizeof(gSources[0]); i++)
+    {
+        if (0 == strcmp(gSources[i]->name, name))
+        {
+            return gSources[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "measurement.h"
+
+/* Measurement sources: where the sampler gets its readings. A source is a
+ * table of callbacks; all of them run on the scheduler thread. Each sampling
+ * round reads once per monitor instance, then advances the source. */
+
+#define HW_DEFAULT_DEVICE "/dev/ttyUSB0"
+
+/* Raw values of one reading; seq and timestamp are assigned on publish */
+typedef struct BPREADING {
+    int32_t values[MEASUREMENT_VALUE_COUNT];
+} BPReading;
+
+typedef enum {
+    SOURCE_SAMPLE = 0,          // *reading holds a new reading
+    SOURCE_NO_SAMPLE,           // nothing new since the last call
+    SOURCE_ERROR
+} SourceResult;
+
+typedef struct MEASUREMENTSOURCE {
+    const char *name;
+    /* arg is what followed "name:" on the command line, or NULL */
+    bool (*open)(const char *arg);
+    SourceResult (*read)(uint32_t instance, BPReading *reading);
+    void (*close)(void);
+    /* Optional, called after each round: moves to the next reading and
+     * returns the ms until it is due, 0 for the sampler period. Lets
+     * recorded traces play back at their own pace. */
+    uint32_t (*advance)(void);
+} MeasurementSource;
+
+/* sim[:seed]     pseudo random readings from a per-thread xorshift generator
+ * trace:file     replays "systolic,diastolic,pulserate" lines (one column per
+ *                measured value), looping; with
+ *                a leading timestamp column (ms), or from a measurement log
+ *                segment (*.log), readings keep their recorded spacing.
+ *                Instance i plays the trace i readings ahead of instance 0.
+ * hw[:device]    reads the same lines from a serial device (HW_DEFAULT_DEVICE)
+ *                and feeds instance 0 only */
+extern const MeasurementSource gSimulatorSource;
+extern const MeasurementSource gTraceSource;
+extern const MeasurementSource gHardwareSource;
+
+/* hw when built with USE_HW, sim otherwise */
+const MeasurementSource *getDefaultMeasurementSource(void);
+
+/* Looks a source up by name; NULL when unknown */
+const MeasurementSource *findMeasurementSource(const char *name);
+
+#endif
@@ -0,0 +1,319 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Hot Path Log
+// Description: Per-thread rings of binary log records and their drainer
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <atomic>
+#include "logger.h"
+#include "hotlog.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-HOTLOG"
+
+#define HOTLOG_LINE_LENGTH 256
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* Single producer (the owning thread), single consumer (the drainer) ring.
+ * The positions only grow; a record is readable once head has passed it and
+ * writable again once tail has. */
+typedef struct HOTLOGRING {
+    HotLogRecord records[HOTLOG_RING_RECORDS];
+    std::atomic<uint64_t> head;         // written by the owner
+    char headPad[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> tail;         // written by the drainer
+    std::atomic<uint64_t> dropped;      // by the owner, ring full
+    uint64_t reportedDrops;             // drainer only
+    uint32_t thread;
+    struct HOTLOGRING *next;
+} HotLogRing;
+
+typedef struct HOTLOG {
+    FILE *out;
+    pthread_t thread;
+    pthread_cond_t cond;
+    bool quit;
+    std::atomic<bool> running;
+    std::atomic<HotLogRing *> rings;    // every ring ever created, newest first
+    std::atomic<uint32_t> threads;
+    std::atomic<uint64_t> written;      // by the drainer
+    uint64_t droppedBefore;             // drops before the last start
+} HotLog;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static HotLog gHotLog;
+static pthread_mutex_t gHotLogLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Rings live as long as the process: a thread keeps its ring across restarts
+static __thread HotLogRing *tHotLogRing = NULL;
+
+static const char gHotLogLevels[] = { 'D', 'I', 'W' };
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static HotLogRing *createHotLogRing()
+{
+    HotLogRing *ring = NULL;
+    if (posix_memalign((void **)&ring, 64, sizeof(HotLogRing)) != 0)
+    {
+        return NULL;
+    }
+    memset((void *)ring, 0, sizeof(HotLogRing));
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+    ring->thread = ++gHotLog.threads;
+
+    HotLogRing *first = gHotLog.rings.load();
+    do
+    {
+        ring->next = first;
+    } while (!gHotLog.rings.compare_exchange_weak(first, ring));
+    return ring;
+}
+
+void writeHotLog(int level, const HotLogEvent *event, int32_t a, int32_t b, int32_t c,
+        int32_t d, const char *text)
+{
+    if (!gHotLog.running.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    HotLogRing *ring = tHotLogRing;
+    if (!ring)
+    {
+        ring = tHotLogRing = createHotLogRing();
+        if (!ring)
+        {
+            return;
+        }
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= HOTLOG_RING_RECORDS)
+    {
+        ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        return;
+    }
+
+    HotLogRecord *record = &ring->records[head & (HOTLOG_RING_RECORDS - 1)];
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->timestampNs = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+    record->event = event;
+    record->thread = ring->thread;
+    record->level = (uint8_t)level;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+    record->args[3] = d;
+    size_t length = 0;
+    if (text)
+    {
+        while (length < HOTLOG_TEXT_LENGTH && text[length])
+        {
+            record->text[length] = text[length];
+            length++;
+        }
+    }
+    record->textLength = (uint8_t)length;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/* Expands the event's format with the record's values */
+static void formatHotLogRecord(FILE *out, const HotLogRecord *record)
+{
+    char line[HOTLOG_LINE_LENGTH];
+    time_t seconds = (time_t)(record->timestampNs / 1000000000ull);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    size_t n = (size_t)snprintf(line, sizeof(line), "%02d:%02d:%02d.%06u T%u %c: %s: ",
+            local.tm_hour, local.tm_min, local.tm_sec,
+            (unsigned)(record->timestampNs % 1000000000ull / 1000), record->thread,
+            gHotLogLevels[record->level], record->event->tag);
+
+    int arg = 0;
+    for (const char *f = record->event->format; *f && n < sizeof(line) - 1; f++)
+    {
+        if (*f != '%' || !f[1])
+        {
+            line[n++] = *f;
+            continue;
+        }
+        f++;
+        int written = 0;
+        switch (*f)
+        {
+        case 'd':
+            written = snprintf(line + n, sizeof(line) - n, "%d", (arg < 4) ? record->args[arg++] : 0);
+            break;
+        case 'u':
+            written = snprintf(line + n, sizeof(line) - n, "%u",
+                    (arg < 4) ? (uint32_t)record->args[arg++] : 0u);
+            break;
+        case 'x':
+            written = snprintf(line + n, sizeof(line) - n, "%x",
+                    (arg < 4) ? (uint32_t)record->args[arg++] : 0u);
+            break;
+        case 's':
+            written = snprintf(line + n, sizeof(line) - n, "%.*s", (int)record->textLength,
+                    record->text);
+            break;
+        default:
+            line[n] = *f;
+            written = 1;
+            break;
+        }
+        n += (size_t)written;
+        if (n > sizeof(line) - 1)
+        {
+            n = sizeof(line) - 1;
+        }
+    }
+    line[n++] = '\n';
+    fwrite(line, 1, n, out);
+}
+
+/* Formats everything the rings hold; returns the number of records */
+static size_t drainHotLog()
+{
+    size_t count = 0;
+    for (HotLogRing *ring = gHotLog.rings.load(); ring; ring = ring->next)
+    {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            formatHotLogRecord(gHotLog.out, &ring->records[tail & (HOTLOG_RING_RECORDS - 1)]);
+            count++;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped != ring->reportedDrops)
+        {
+            fprintf(gHotLog.out, "hotlog: %llu record(s) of thread T%u dropped\n",
+                    (unsigned long long)(dropped - ring->reportedDrops), ring->thread);
+            ring->reportedDrops = dropped;
+        }
+    }
+    if (count > 0)
+    {
+        fflush(gHotLog.out);
+    }
+    gHotLog.written += count;
+    return count;
+}
+
+void *hotLogThread(void *data)
+{
+    pthread_mutex_lock(&gHotLogLock);
+    while (!gHotLog.quit)
+    {
+        // On the condition's CLOCK_MONOTONIC: a wall clock step neither
+        // stalls the draining nor makes it spin
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += HOTLOG_DRAIN_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&gHotLog.cond, &gHotLogLock, &deadline);
+
+        // Formatting and writing happen outside the lock
+        pthread_mutex_unlock(&gHotLogLock);
+        drainHotLog();
+        pthread_mutex_lock(&gHotLogLock);
+    }
+    pthread_mutex_unlock(&gHotLogLock);
+
+    drainHotLog();
+    return NULL;
+}
+
+int startHotLog(FILE *out)
+{
+    if (gHotLog.running)
+    {
+        return 0;
+    }
+
+    gHotLog.out = out;
+    gHotLog.quit = false;
+    gHotLog.written = 0;
+    // Whatever was dropped before this start is not reported
+    gHotLog.droppedBefore = 0;
+    for (HotLogRing *ring = gHotLog.rings.load(); ring; ring = ring->next)
+    {
+        ring->reportedDrops = ring->dropped;
+        gHotLog.droppedBefore += ring->reportedDrops;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gHotLog.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&gHotLog.thread, NULL, hotLogThread, NULL) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create hot log drainer thread");
+        pthread_cond_destroy(&gHotLog.cond);
+        return -1;
+    }
+    gHotLog.running = true;
+    OIC_LOG_V(INFO, TAG, "Hot path log at level %d, drained every %d ms", HOTLOG_LEVEL,
+            HOTLOG_DRAIN_MS);
+    return 0;
+}
+
+void stopHotLog(void)
+{
+    if (!gHotLog.running)
+    {
+        return;
+    }
+    gHotLog.running = false;
+
+    pthread_mutex_lock(&gHotLogLock);
+    gHotLog.quit = true;
+    pthread_cond_signal(&gHotLog.cond);
+    pthread_mutex_unlock(&gHotLogLock);
+    pthread_join(gHotLog.thread, NULL);
+    pthread_cond_destroy(&gHotLog.cond);
+
+    uint64_t written, dropped;
+    getHotLogStats(&written, &dropped);
+    OIC_LOG_V(INFO, TAG, "Hot path log stopped: %llu records, %llu dropped",
+            (unsigned long long)written, (unsigned long long)dropped);
+}
+
+void getHotLogStats(uint64_t *written, uint64_t *dropped)
+{
+    *written = gHotLog.written;
+    *dropped = 0;
+    for (HotLogRing *ring = gHotLog.rings.load(); ring; ring = ring->next)
+    {
+        *dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    *dropped -= gHotLog.droppedBefore;
+}
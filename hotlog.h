@@ -0,0 +1,78 @@
+#ifndef HOTLOG_H
+#define HOTLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Hot path logging: events of the request and sampling paths are stored as
+ * fixed size binary records in a ring owned by the calling thread, with no
+ * formatting, lock or system call; a drainer thread formats them later, in
+ * order per thread. Calls below HOTLOG_LEVEL compile to nothing. Rare and
+ * error messages keep using OIC_LOG. */
+
+#define HOTLOG_DEBUG    0
+#define HOTLOG_INFO     1
+#define HOTLOG_WARNING  2
+#define HOTLOG_OFF      3
+
+#ifndef HOTLOG_LEVEL
+#define HOTLOG_LEVEL    HOTLOG_INFO
+#endif
+
+#define HOTLOG_RING_RECORDS 4096    // per thread, a power of two
+#define HOTLOG_TEXT_LENGTH  24      // longer text is cut
+#define HOTLOG_DRAIN_MS     100
+
+/* What an event prints. format takes the record's integers in order for
+ * %d, %u and %x (32 bit, no length modifiers) and its text for %s. */
+typedef struct HOTLOGEVENT {
+    const char *tag;
+    const char *format;
+} HotLogEvent;
+
+/* 64 bytes: one cache line per record */
+typedef struct HOTLOGRECORD {
+    uint64_t timestampNs;           // CLOCK_REALTIME
+    const HotLogEvent *event;
+    uint32_t thread;                // small id, in order of the first event
+    uint8_t level;
+    uint8_t textLength;
+    uint8_t reserved[2];
+    int32_t args[4];
+    char text[HOTLOG_TEXT_LENGTH];      // not terminated
+} HotLogRecord;
+
+static_assert(sizeof(HotLogRecord) == 64, "a hot log record is one cache line");
+
+/* Declares an event of the including file; uses its TAG */
+#define HOTLOG_EVENT(name, format) static const HotLogEvent name = { TAG, format }
+
+/* The level is a constant, so a disabled call is removed at compile time */
+#define HOTLOG(level, event, a, b, c, d) \
+    do { if ((level) >= HOTLOG_LEVEL) { \
+        writeHotLog((level), &(event), (int32_t)(a), (int32_t)(b), (int32_t)(c), \
+                (int32_t)(d), NULL); \
+    } } while (0)
+
+#define HOTLOG_TEXT(level, event, text, a, b) \
+    do { if ((level) >= HOTLOG_LEVEL) { \
+        writeHotLog((level), &(event), (int32_t)(a), (int32_t)(b), 0, 0, (text)); \
+    } } while (0)
+
+/* Starts the drainer, which formats every thread's records to out. Events
+ * written while it is not running are discarded. */
+int startHotLog(FILE *out);
+
+/* Drains what is left, reports dropped records and joins the drainer */
+void stopHotLog(void);
+
+/* Appends a record to the calling thread's ring; drops it, and counts the
+ * drop, when the drainer is behind and the ring is full */
+void writeHotLog(int level, const HotLogEvent *event, int32_t a, int32_t b, int32_t c,
+        int32_t d, const char *text);
+
+/* Records written and dropped since startHotLog(), over all threads */
+void getHotLogStats(uint64_t *written, uint64_t *dropped);
+
+#endif
@@ -0,0 +1,628 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Introspection Data Generator
+// Description: Build step writing the IDD of the descriptors as a C++ source
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "device/bpmresources.h"
+#include "device/metricsresource.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+/* The Introspection Device Data is a swagger 2.0 document in CBOR, built from
+ * the same descriptor tables the resources are created from: a path and a
+ * definition per resource, and for the Atomic Measurement a path per
+ * interface. The paths are those of instance 0; instance i > 0 serves the
+ * same resources under /bpm<i>. Maps and arrays are written with indefinite length, as
+ * json2cbor writes them, so nothing has to be counted ahead. */
+
+#define IDD_TITLE           "Blood Pressure Monitor IDD"
+#define IDD_VERSION         "v1.1.0-20181025"
+#define IDD_MAX_STRINGS     32
+#define IDD_BYTES_PER_LINE  12
+
+#define CBOR_UINT           0
+#define CBOR_TEXT           3
+#define CBOR_ARRAY          4
+#define CBOR_MAP            5
+#define CBOR_FALSE          0xf4
+#define CBOR_TRUE           0xf5
+#define CBOR_INDEFINITE     31
+#define CBOR_BREAK          0xff
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+typedef struct CBORBUFFER {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} CborBuffer;
+
+/* Distinct strings in the order first seen, for the enums of the links */
+typedef struct STRINGSET {
+    const char *items[IDD_MAX_STRINGS];
+    size_t count;
+} StringSet;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static void putByte(CborBuffer *cbor, uint8_t byte)
+{
+    if (cbor->size == cbor->capacity)
+    {
+        size_t capacity = cbor->capacity ? cbor->capacity * 2 : 4096;
+        uint8_t *grown = (uint8_t *)realloc(cbor->data, capacity);
+        if (!grown)
+        {
+            cbor->failed = true;
+            return;
+        }
+        cbor->data = grown;
+        cbor->capacity = capacity;
+    }
+    cbor->data[cbor->size++] = byte;
+}
+
+static void putHead(CborBuffer *cbor, uint8_t major, uint64_t value)
+{
+    int bytes = (value < 24) ? 0 : (value <= 0xff) ? 1 : (value <= 0xffff) ? 2 :
+                (value <= 0xffffffffULL) ? 4 : 8;
+    uint8_t info = (bytes == 0) ? (uint8_t)value :
+                   (bytes == 1) ? 24 : (bytes == 2) ? 25 : (bytes == 4) ? 26 : 27;
+    putByte(cbor, (uint8_t)(major << 5 | info));
+    for (int i = bytes - 1; i >= 0; i--)
+    {
+        putByte(cbor, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void putText(CborBuffer *cbor, const char *text)
+{
+    size_t length = strlen(text);
+    putHead(cbor, CBOR_TEXT, length);
+    for (size_t i = 0; i < length; i++)
+    {
+        putByte(cbor, (uint8_t)text[i]);
+    }
+}
+
+static void beginMap(CborBuffer *cbor)
+{
+    putByte(cbor, CBOR_MAP << 5 | CBOR_INDEFINITE);
+}
+
+static void beginArray(CborBuffer *cbor)
+{
+    putByte(cbor, CBOR_ARRAY << 5 | CBOR_INDEFINITE);
+}
+
+static void end(CborBuffer *cbor)
+{
+    putByte(cbor, CBOR_BREAK);
+}
+
+static void putTextEntry(CborBuffer *cbor, const char *key, const char *text)
+{
+    putText(cbor, key);
+    putText(cbor, text);
+}
+
+static void putUintEntry(CborBuffer *cbor, const char *key, uint64_t value)
+{
+    putText(cbor, key);
+    putHead(cbor, CBOR_UINT, value);
+}
+
+static void putBoolEntry(CborBuffer *cbor, const char *key, bool value)
+{
+    putText(cbor, key);
+    putByte(cbor, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+static void putTextArray(CborBuffer *cbor, const char *const *items, size_t count)
+{
+    beginArray(cbor);
+    for (size_t i = 0; i < count; i++)
+    {
+        putText(cbor, items[i]);
+    }
+    end(cbor);
+}
+
+static void putRef(CborBuffer *cbor, const char *key, const char *definition)
+{
+    char ref[128];
+    snprintf(ref, sizeof(ref), "#/definitions/%s", definition);
+    putText(cbor, key);
+    beginMap(cbor);
+    putTextEntry(cbor, "$ref", ref);
+    end(cbor);
+}
+
+static void addString(StringSet *set, const char *text)
+{
+    for (size_t i = 0; i < set->count; i++)
+    {
+        if (0 == strcmp(set->items[i], text))
+        {
+            return;
+        }
+    }
+    if (set->count < IDD_MAX_STRINGS)
+    {
+        set->items[set->count++] = text;
+    }
+}
+
+/* A read-only array of strings out of items; fixed ones must hold them all,
+ * in that order */
+static void putStringArraySchema(CborBuffer *cbor, const char *key,
+        const char *const *items, size_t count, size_t minItems, bool fixed)
+{
+    putText(cbor, key);
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "array");
+    putText(cbor, "items");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "string");
+    putText(cbor, "enum");
+    putTextArray(cbor, items, count);
+    end(cbor);
+    putUintEntry(cbor, "minItems", fixed ? count : minItems);
+    if (fixed)
+    {
+        putUintEntry(cbor, "maxItems", count);
+    }
+    putBoolEntry(cbor, "uniqueItems", true);
+    putBoolEntry(cbor, "readOnly", true);
+    if (fixed)
+    {
+        putText(cbor, "default");
+        putTextArray(cbor, items, count);
+    }
+    end(cbor);
+}
+
+/* Definition named after the resource's first type */
+static const char *getDefinitionName(const ResourceDesc *desc)
+{
+    return desc->types[0];
+}
+
+static void putQueryParameter(CborBuffer *cbor, const char *const *interfaces, size_t count)
+{
+    putText(cbor, "parameters");
+    beginArray(cbor);
+    beginMap(cbor);
+    putTextEntry(cbor, "name", "if");
+    putTextEntry(cbor, "in", "query");
+    putTextEntry(cbor, "type", "string");
+    putText(cbor, "enum");
+    putTextArray(cbor, interfaces, count);
+    end(cbor);
+    end(cbor);
+}
+
+/* GET of path, answered with the schema of definition */
+static void putPath(CborBuffer *cbor, const char *path, const char *const *interfaces,
+        size_t interfaceCount, const char *definition)
+{
+    putText(cbor, path);
+    beginMap(cbor);
+    putText(cbor, "get");
+    beginMap(cbor);
+    putTextEntry(cbor, "description", "");
+    putQueryParameter(cbor, interfaces, interfaceCount);
+    putText(cbor, "responses");
+    beginMap(cbor);
+    putText(cbor, "200");
+    beginMap(cbor);
+    putTextEntry(cbor, "description", "");
+    putRef(cbor, "schema", definition);
+    end(cbor);
+    end(cbor);
+    end(cbor);
+    end(cbor);
+}
+
+static void putPaths(CborBuffer *cbor, const ResourceDesc *collection,
+        const ResourceDesc *metrics)
+{
+    putText(cbor, "paths");
+    beginMap(cbor);
+    for (size_t i = 0; i < collection->interfaceCount; i++)
+    {
+        const char *iface = collection->interfaces[i];
+        char path[DESCRIPTOR_URI_LENGTH + 32];
+        snprintf(path, sizeof(path), "%s?if=%s", collection->path, iface);
+        const char *definition = (0 == strcmp(iface, OC_RSRVD_INTERFACE_LL)) ? "links" :
+                                 (0 == strcmp(iface, OC_RSRVD_INTERFACE_BATCH)) ? "batch" :
+                                 getDefinitionName(collection);
+        putPath(cbor, path, &collection->interfaces[i], 1, definition);
+    }
+    for (size_t i = 0; i < collection->linkCount; i++)
+    {
+        const ResourceDesc *desc = collection->links[i].resource;
+        putPath(cbor, desc->path, desc->interfaces, desc->interfaceCount,
+                getDefinitionName(desc));
+    }
+    putPath(cbor, metrics->path, metrics->interfaces, metrics->interfaceCount,
+            getDefinitionName(metrics));
+    end(cbor);
+}
+
+/* The properties the payload builders write for desc, see descriptor.h */
+static void putPropertySchemas(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    for (size_t i = 0; i < desc->propertyCount; i++)
+    {
+        const PropertyDesc *property = &desc->properties[i];
+        putText(cbor, property->name);
+        beginMap(cbor);
+        putTextEntry(cbor, "description", "");
+        if (property->kind == PROPERTY_MEASURED_INT)
+        {
+            putTextEntry(cbor, "type", "number");
+            putUintEntry(cbor, "minimum", 0);
+        }
+        else
+        {
+            putTextEntry(cbor, "type", "string");
+            putText(cbor, "enum");
+            putTextArray(cbor, &property->text, 1);
+        }
+        putBoolEntry(cbor, "readOnly", true);
+        end(cbor);
+    }
+}
+
+static void putResourceDefinition(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    putText(cbor, getDefinitionName(desc));
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putStringArraySchema(cbor, "rt", desc->types, desc->typeCount, 1, true);
+    putStringArraySchema(cbor, "if", desc->interfaces, desc->interfaceCount, 1, false);
+    putRef(cbor, "id", "id");
+    putPropertySchemas(cbor, desc);
+    end(cbor);
+
+    // Every measured value is in every body
+    putText(cbor, "required");
+    beginArray(cbor);
+    for (size_t i = 0; i < desc->propertyCount; i++)
+    {
+        if (desc->properties[i].kind == PROPERTY_MEASURED_INT)
+        {
+            putText(cbor, desc->properties[i].name);
+        }
+    }
+    end(cbor);
+    end(cbor);
+}
+
+static void putCollectionDefinition(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    StringSet rts = { { NULL }, 0 };
+    StringSet mandatory = { { NULL }, 0 };
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        const ResourceDesc *link = desc->links[i].resource;
+        for (size_t t = 0; t < link->typeCount; t++)
+        {
+            addString(&rts, link->types[t]);
+            if (desc->links[i].mandatory)
+            {
+                addString(&mandatory, link->types[t]);
+            }
+        }
+    }
+
+    putText(cbor, getDefinitionName(desc));
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putStringArraySchema(cbor, "rt", desc->types, desc->typeCount, 1, true);
+    putStringArraySchema(cbor, "if", desc->interfaces, desc->interfaceCount, 1, false);
+    putStringArraySchema(cbor, "rts", rts.items, rts.count, 1, false);
+    putStringArraySchema(cbor, "rts-m", mandatory.items, mandatory.count, 1, true);
+    putRef(cbor, "id", "id");
+    putRef(cbor, "links", "links");
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "rts-m");
+    end(cbor);
+    end(cbor);
+}
+
+/* A link of the collection, as createLinkPayload() writes it */
+static void putLinkDefinition(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    StringSet types = { { NULL }, 0 };
+    StringSet interfaces = { { NULL }, 0 };
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        const ResourceDesc *link = desc->links[i].resource;
+        for (size_t t = 0; t < link->typeCount; t++)
+        {
+            addString(&types, link->types[t]);
+        }
+        for (size_t f = 0; f < link->interfaceCount; f++)
+        {
+            addString(&interfaces, link->interfaces[f]);
+        }
+    }
+
+    putText(cbor, "link");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putRef(cbor, "href", "href");
+    putStringArraySchema(cbor, "rt", types.items, types.count, 1, false);
+    putStringArraySchema(cbor, "if", interfaces.items, interfaces.count, 1, false);
+    putText(cbor, "p");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putText(cbor, "bm");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "integer");
+    end(cbor);
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "bm");
+    end(cbor);
+    end(cbor);
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "href");
+    putText(cbor, "rt");
+    putText(cbor, "if");
+    end(cbor);
+    end(cbor);
+
+    putText(cbor, "links");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "array");
+    putRef(cbor, "items", "link");
+    end(cbor);
+}
+
+/* oic.if.b: href and rep of every link, see createBatchPayload() */
+static void putBatchDefinition(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    putText(cbor, "batch");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "array");
+    putUintEntry(cbor, "minItems", 1);
+    putUintEntry(cbor, "maxItems", desc->linkCount);
+    putText(cbor, "items");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putRef(cbor, "href", "href");
+    putText(cbor, "rep");
+    beginMap(cbor);
+    putText(cbor, "anyOf");
+    beginArray(cbor);
+    for (size_t i = 0; i < desc->linkCount; i++)
+    {
+        char ref[128];
+        snprintf(ref, sizeof(ref), "#/definitions/%s",
+                getDefinitionName(desc->links[i].resource));
+        beginMap(cbor);
+        putTextEntry(cbor, "$ref", ref);
+        end(cbor);
+    }
+    end(cbor);
+    end(cbor);
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "href");
+    putText(cbor, "rep");
+    end(cbor);
+    end(cbor);
+    end(cbor);
+}
+
+static void putIntegerSchema(CborBuffer *cbor, const char *key)
+{
+    putText(cbor, key);
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "integer");
+    putUintEntry(cbor, "minimum", 0);
+    putBoolEntry(cbor, "readOnly", true);
+    end(cbor);
+}
+
+/* /metrics: the counters and latencies of every source, see
+ * createMetricsPayload() */
+static void putMetricsDefinition(CborBuffer *cbor, const ResourceDesc *desc)
+{
+    putText(cbor, getDefinitionName(desc));
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putStringArraySchema(cbor, "rt", desc->types, desc->typeCount, 1, true);
+    putStringArraySchema(cbor, "if", desc->interfaces, desc->interfaceCount, 1, false);
+    putText(cbor, "resources");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "array");
+    putText(cbor, "items");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    putText(cbor, "name");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "string");
+    putBoolEntry(cbor, "readOnly", true);
+    end(cbor);
+    for (size_t i = 0; i < countOf(gMetricsCounterProperties); i++)
+    {
+        putIntegerSchema(cbor, gMetricsCounterProperties[i]);
+    }
+    for (size_t i = 0; i < countOf(gMetricsLatencyProperties); i++)
+    {
+        putRef(cbor, gMetricsLatencyProperties[i], "latency");
+    }
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "name");
+    end(cbor);
+    end(cbor);
+    end(cbor);
+    end(cbor);
+    putText(cbor, "required");
+    beginArray(cbor);
+    putText(cbor, "resources");
+    end(cbor);
+    end(cbor);
+
+    // Latencies in ns
+    putText(cbor, "latency");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "object");
+    putText(cbor, "properties");
+    beginMap(cbor);
+    for (size_t i = 0; i < countOf(gMetricsLatencyFields); i++)
+    {
+        putIntegerSchema(cbor, gMetricsLatencyFields[i]);
+    }
+    end(cbor);
+    end(cbor);
+}
+
+static void putDefinitions(CborBuffer *cbor, const ResourceDesc *collection,
+        const ResourceDesc *metrics)
+{
+    putText(cbor, "definitions");
+    beginMap(cbor);
+    putCollectionDefinition(cbor, collection);
+    for (size_t i = 0; i < collection->linkCount; i++)
+    {
+        putResourceDefinition(cbor, collection->links[i].resource);
+    }
+    putBatchDefinition(cbor, collection);
+    putLinkDefinition(cbor, collection);
+    putMetricsDefinition(cbor, metrics);
+
+    putText(cbor, "id");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "string");
+    putUintEntry(cbor, "maxLength", 64);
+    putBoolEntry(cbor, "readOnly", true);
+    end(cbor);
+    putText(cbor, "href");
+    beginMap(cbor);
+    putTextEntry(cbor, "type", "string");
+    putTextEntry(cbor, "format", "uri");
+    putUintEntry(cbor, "maxLength", 256);
+    end(cbor);
+    end(cbor);
+}
+
+static void writeIntrospectionData(CborBuffer *cbor, const ResourceDesc *collection,
+        const ResourceDesc *metrics)
+{
+    static const char *const json[] = { "application/json" };
+    static const char *const http[] = { "http" };
+
+    beginMap(cbor);
+    putTextEntry(cbor, "swagger", "2.0");
+    putText(cbor, "info");
+    beginMap(cbor);
+    putTextEntry(cbor, "title", IDD_TITLE);
+    putTextEntry(cbor, "version", IDD_VERSION);
+    end(cbor);
+    putText(cbor, "schemes");
+    putTextArray(cbor, http, 1);
+    putText(cbor, "consumes");
+    putTextArray(cbor, json, 1);
+    putText(cbor, "produces");
+    putTextArray(cbor, json, 1);
+    putPaths(cbor, collection, metrics);
+    putDefinitions(cbor, collection, metrics);
+    end(cbor);
+}
+
+static bool writeSource(const char *path, const CborBuffer *cbor)
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+    {
+        return false;
+    }
+    fprintf(out, "// Generated by iddgen from device/bpmresources.h and "
+            "device/metricsresource.h: do not edit\n\n");
+    fprintf(out, "#include \"introspection.h\"\n\n");
+    fprintf(out, "const uint8_t gIntrospectionData[] = {");
+    for (size_t i = 0; i < cbor->size; i++)
+    {
+        fprintf(out, "%s0x%02x,", (i % IDD_BYTES_PER_LINE) ? " " : "\n    ", cbor->data[i]);
+    }
+    fprintf(out, "\n};\n\nconst size_t gIntrospectionSize = sizeof(gIntrospectionData);\n");
+    return (fclose(out) == 0);
+}
+
+static bool writeCbor(const char *path, const CborBuffer *cbor)
+{
+    FILE *out = fopen(path, "wb");
+    if (!out)
+    {
+        return false;
+    }
+    bool ok = (fwrite(cbor->data, 1, cbor->size, out) == cbor->size);
+    return (fclose(out) == 0) && ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s source.cpp [idd.dat]\n", argv[0]);
+        return 1;
+    }
+
+    CborBuffer cbor = { NULL, 0, 0, false };
+    writeIntrospectionData(&cbor, &gBPMResource, &gMetricsResource);
+    if (cbor.failed)
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    if (!writeSource(argv[1], &cbor))
+    {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    // The raw document, to look at or to hand to a tool
+    if (argc > 2 && !writeCbor(argv[2], &cbor))
+    {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], argv[2]);
+        return 1;
+    }
+    free(cbor.data);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef INTROSPECTION_H
+#define INTROSPECTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Introspection Device Data (IDD) of the server, a swagger document in CBOR.
+ * It is generated at build time from the descriptors in device/bpmresources.h
+ * and device/metricsresource.h by iddgen (server.idd.cpp) and served from this
+ * read-only copy, so it follows the descriptors and there is no file to go
+ * missing or stale. It describes /metrics and the paths of instance 0 only;
+ * instance i > 0 serves the same resources under /bpm<i>. */
+
+extern const uint8_t gIntrospectionData[];
+extern const size_t gIntrospectionSize;
+
+#endif
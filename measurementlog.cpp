@@ -0,0 +1,573 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Measurement Log
+// Description: mmap'd, segment rotated, append-only log of samples
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <atomic>
+#include "logger.h"
+#include "measurementlog.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-MLOG"
+
+#define MLOG_SEGMENT_BYTES (MLOG_SEGMENT_RECORDS * sizeof(MeasurementRecord))
+#define MLOG_PATH_LENGTH 512
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* Bounded multi-producer queue (Vyukov): a producer claims a cell with one
+ * CAS and never waits for another thread */
+typedef struct MLOGCELL {
+    std::atomic<size_t> sequence;
+    MeasurementRecord record;
+} MLogCell;
+
+typedef struct MEASUREMENTLOG {
+    char dir[MLOG_PATH_LENGTH];
+    MeasurementLogSync sync;
+    uint32_t syncIntervalMs;
+
+    // Current segment, only touched by the writer thread after open
+    uint32_t segmentIndex;
+    int fd;
+    MeasurementRecord *records;
+    size_t tail;                // next free record in the segment
+    size_t syncedTail;          // records before this one are synced
+
+    MLogCell cells[MLOG_QUEUE_RECORDS];
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+    sem_t pending;              // posted once per queued record
+
+    pthread_t thread;
+    std::atomic<bool> open;
+    std::atomic<bool> quit;
+
+    std::atomic<uint64_t> appended;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> syncs;
+    std::atomic<uint64_t> lastSeq;
+
+    // Recovered at open: last sampleSeq per instance
+    uint64_t *sampleSeqs;
+    size_t sampleSeqCount;
+} MeasurementLog;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static MeasurementLog gLog;
+
+static uint32_t gCrcTable[256];
+static pthread_once_t gCrcOnce = PTHREAD_ONCE_INIT;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static void initCrcTable()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        gCrcTable[i] = c;
+    }
+}
+
+uint32_t getMeasurementRecordCrc(const MeasurementRecord *record)
+{
+    pthread_once(&gCrcOnce, initCrcTable);
+
+    const uint8_t *p = (const uint8_t *)record;
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < offsetof(MeasurementRecord, crc); i++)
+    {
+        c = gCrcTable[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+bool isValidMeasurementRecord(const MeasurementRecord *record)
+{
+    return record->seq != 0 && record->crc == getMeasurementRecordCrc(record);
+}
+
+static void getSegmentPath(uint32_t index, char *path, size_t len)
+{
+    snprintf(path, len, "%s/bpm-%08u.log", gLog.dir, index);
+}
+
+/* Highest segment index present in the log directory, 0 when empty */
+static uint32_t findLastSegment()
+{
+    uint32_t last = 0;
+    DIR *dir = opendir(gLog.dir);
+    if (!dir)
+    {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        unsigned int index;
+        if (sscanf(entry->d_name, "bpm-%08u.log", &index) == 1 && index > last)
+        {
+            last = index;
+        }
+    }
+    closedir(dir);
+    return last;
+}
+
+/* Length of the recoverable prefix of records: up to the first record that
+ * does not verify or does not follow the one before */
+static size_t scanRecords(const MeasurementRecord *records, size_t count)
+{
+    size_t tail = 0;
+    while (tail < count && isValidMeasurementRecord(&records[tail])
+            && (tail == 0 || records[tail].seq > records[tail - 1].seq))
+    {
+        tail++;
+    }
+    return tail;
+}
+
+/* Keeps the highest sampleSeq of each instance found in records */
+static void recoverSampleSeqs(const MeasurementRecord *records, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const MeasurementRecord *record = &records[i];
+        if (record->instance >= gLog.sampleSeqCount)
+        {
+            size_t grown = record->instance + 1;
+            uint64_t *seqs = (uint64_t *)realloc(gLog.sampleSeqs, grown * sizeof(uint64_t));
+            if (!seqs)
+            {
+                continue;
+            }
+            memset(seqs + gLog.sampleSeqCount, 0, (grown - gLog.sampleSeqCount) * sizeof(uint64_t));
+            gLog.sampleSeqs = seqs;
+            gLog.sampleSeqCount = grown;
+        }
+        if (record->sampleSeq > gLog.sampleSeqs[record->instance])
+        {
+            gLog.sampleSeqs[record->instance] = record->sampleSeq;
+        }
+    }
+}
+
+/* Recovers the full segment before the current one: instances missing from
+ * a segment just started were last recorded there */
+static void recoverPreviousSegment()
+{
+    char path[MLOG_PATH_LENGTH + 32];
+    getSegmentPath(gLog.segmentIndex - 1, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat st;
+    void *map = (fstat(fd, &st) == 0 && st.st_size == (off_t)MLOG_SEGMENT_BYTES) ?
+            mmap(NULL, MLOG_SEGMENT_BYTES, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return;
+    }
+    const MeasurementRecord *records = (const MeasurementRecord *)map;
+    size_t count = scanRecords(records, MLOG_SEGMENT_RECORDS);
+    recoverSampleSeqs(records, count);
+    if (gLog.tail == 0 && count > 0)
+    {
+        gLog.lastSeq = records[count - 1].seq;
+    }
+    munmap(map, MLOG_SEGMENT_BYTES);
+}
+
+static void syncSegment(int flags)
+{
+    if (!gLog.records || gLog.syncedTail == gLog.tail)
+    {
+        return;
+    }
+
+    // msync() wants a page aligned start
+    long page = sysconf(_SC_PAGESIZE);
+    size_t start = (gLog.syncedTail * sizeof(MeasurementRecord)) & ~((size_t)page - 1);
+    size_t end = gLog.tail * sizeof(MeasurementRecord);
+    if (msync((char *)gLog.records + start, end - start, flags) == 0)
+    {
+        gLog.syncs++;
+        gLog.syncedTail = gLog.tail;
+    }
+    else
+    {
+        OIC_LOG_V(ERROR, TAG, "msync failed: %s", strerror(errno));
+    }
+}
+
+static void closeSegment()
+{
+    if (gLog.records)
+    {
+        syncSegment((gLog.sync == MLOG_SYNC_NONE) ? MS_ASYNC : MS_SYNC);
+        munmap(gLog.records, MLOG_SEGMENT_BYTES);
+        gLog.records = NULL;
+    }
+    if (gLog.fd >= 0)
+    {
+        close(gLog.fd);
+        gLog.fd = -1;
+    }
+}
+
+static int openSegment(uint32_t index)
+{
+    char path[MLOG_PATH_LENGTH + 32];
+    getSegmentPath(index, path, sizeof(path));
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size != 0 && st.st_size != (off_t)MLOG_SEGMENT_BYTES)
+    {
+        // Another record format: leave it to its readers, start the next one
+        OIC_LOG_V(ERROR, TAG, "%s is not a segment of this format, left as it is", path);
+        close(fd);
+        return openSegment(index + 1);
+    }
+    if (ftruncate(fd, MLOG_SEGMENT_BYTES) != 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot size %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, MLOG_SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot map %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    gLog.segmentIndex = index;
+    gLog.fd = fd;
+    gLog.records = (MeasurementRecord *)map;
+
+    // Recovery: the segment ends at the first record that does not verify or
+    // does not follow the one before
+    size_t tail = scanRecords(gLog.records, MLOG_SEGMENT_RECORDS);
+    if (tail > 0)
+    {
+        gLog.lastSeq = gLog.records[tail - 1].seq;
+    }
+    // Shared pages reach the disk in any order: records written before a crash
+    // can sit past the torn one. Clear them all, or a later recovery would
+    // resume into them once the gap is overwritten.
+    static const MeasurementRecord empty = MeasurementRecord();
+    size_t cleared = 0;
+    for (size_t i = tail; i < MLOG_SEGMENT_RECORDS; i++)
+    {
+        if (memcmp(&gLog.records[i], &empty, sizeof(empty)) != 0)
+        {
+            memset(&gLog.records[i], 0, sizeof(MeasurementRecord));
+            cleared++;
+        }
+    }
+    if (cleared > 0)
+    {
+        OIC_LOG_V(INFO, TAG, "Segment %u: %zu records past the tail cleared", index, cleared);
+    }
+    gLog.tail = tail;
+    gLog.syncedTail = tail;
+    return 0;
+}
+
+static int writeRecord(const MeasurementRecord *record)
+{
+    if (gLog.tail == MLOG_SEGMENT_RECORDS)
+    {
+        closeSegment();
+        if (openSegment(gLog.segmentIndex + 1) != 0)
+        {
+            return -1;
+        }
+    }
+    MeasurementRecord *slot = &gLog.records[gLog.tail++];
+    *slot = *record;
+    slot->seq = gLog.lastSeq + 1;
+    slot->crc = getMeasurementRecordCrc(slot);
+    gLog.written++;
+    gLog.lastSeq = slot->seq;
+    return 0;
+}
+
+/* Moves every queued record into the segment; returns how many */
+static size_t drainQueue()
+{
+    size_t count = 0;
+    while (true)
+    {
+        MLogCell *cell = &gLog.cells[gLog.dequeuePos % MLOG_QUEUE_RECORDS];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if (seq != gLog.dequeuePos + 1)
+        {
+            break;
+        }
+        MeasurementRecord record = cell->record;
+        cell->sequence.store(gLog.dequeuePos + MLOG_QUEUE_RECORDS, std::memory_order_release);
+        gLog.dequeuePos++;
+
+        if (writeRecord(&record) != 0)
+        {
+            gLog.dropped++;
+        }
+        count++;
+    }
+    return count;
+}
+
+static uint64_t getMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Waits for a record, or until deadlineNs on CLOCK_MONOTONIC, so the msync
+ * interval holds whatever the wall clock does */
+static void waitPending(uint64_t deadlineNs)
+{
+#if defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2, 30)
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)(deadlineNs / 1000000000ull);
+    deadline.tv_nsec = (long)(deadlineNs % 1000000000ull);
+    sem_clockwait(&gLog.pending, CLOCK_MONOTONIC, &deadline);
+#else
+    // No sem_clockwait(): a CLOCK_REALTIME deadline for the time left, taken
+    // again on every wait; a step while waiting can stretch that wait only
+    uint64_t now = getMonotonicNs();
+    uint64_t left = (deadlineNs > now) ? deadlineNs - now : 0;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(left / 1000000000ull);
+    deadline.tv_nsec += (long)(left % 1000000000ull);
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    sem_timedwait(&gLog.pending, &deadline);
+#endif
+}
+
+void *measurementLogThread(void *data)
+{
+    uint64_t intervalNs = (uint64_t)gLog.syncIntervalMs * 1000000ull;
+    uint64_t nextSyncNs = getMonotonicNs() + intervalNs;
+
+    while (!gLog.quit)
+    {
+        if (gLog.sync == MLOG_SYNC_INTERVAL)
+        {
+            waitPending(nextSyncNs);
+        }
+        else
+        {
+            sem_wait(&gLog.pending);
+        }
+        // One post per record: the drain below consumes the others
+        while (sem_trywait(&gLog.pending) == 0)
+        {
+        }
+
+        size_t count = drainQueue();
+        if (gLog.sync == MLOG_SYNC_ALWAYS && count > 0)
+        {
+            syncSegment(MS_SYNC);
+        }
+        else if (gLog.sync == MLOG_SYNC_INTERVAL && getMonotonicNs() >= nextSyncNs)
+        {
+            syncSegment(MS_SYNC);
+            nextSyncNs = getMonotonicNs() + intervalNs;
+        }
+    }
+
+    drainQueue();
+    closeSegment();
+    return NULL;
+}
+
+int openMeasurementLog(const char *dir, MeasurementLogSync sync, uint32_t syncIntervalMs)
+{
+    if (gLog.open)
+    {
+        return 0;
+    }
+
+    snprintf(gLog.dir, sizeof(gLog.dir), "%s", dir);
+    if (mkdir(gLog.dir, 0755) != 0 && errno != EEXIST)
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot create %s: %s", gLog.dir, strerror(errno));
+        return -1;
+    }
+
+    gLog.sync = sync;
+    gLog.syncIntervalMs = syncIntervalMs ? syncIntervalMs : 1000;
+    gLog.fd = -1;
+    gLog.records = NULL;
+    gLog.appended = gLog.written = gLog.dropped = gLog.syncs = gLog.lastSeq = 0;
+
+    free(gLog.sampleSeqs);
+    gLog.sampleSeqs = NULL;
+    gLog.sampleSeqCount = 0;
+
+    uint32_t last = findLastSegment();
+    if (openSegment(last ? last : 1) != 0)
+    {
+        return -1;
+    }
+    if (gLog.segmentIndex > 1)
+    {
+        // A new segment is only created when the previous one is full
+        recoverPreviousSegment();
+    }
+    recoverSampleSeqs(gLog.records, gLog.tail);
+    OIC_LOG_V(INFO, TAG, "Log %s: segment %u, %zu records recovered, last seq %llu",
+            gLog.dir, gLog.segmentIndex, gLog.tail, (unsigned long long)gLog.lastSeq);
+
+    for (size_t i = 0; i < MLOG_QUEUE_RECORDS; i++)
+    {
+        gLog.cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    gLog.enqueuePos = 0;
+    gLog.dequeuePos = 0;
+    sem_init(&gLog.pending, 0, 0);
+    gLog.quit = false;
+
+    if (pthread_create(&gLog.thread, NULL, measurementLogThread, NULL) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create log writer thread");
+        closeSegment();
+        sem_destroy(&gLog.pending);
+        return -1;
+    }
+    gLog.open = true;
+    return 0;
+}
+
+void closeMeasurementLog(void)
+{
+    if (!gLog.open)
+    {
+        return;
+    }
+    gLog.open = false;
+    gLog.quit = true;
+    sem_post(&gLog.pending);
+    pthread_join(gLog.thread, NULL);
+    sem_destroy(&gLog.pending);
+    free(gLog.sampleSeqs);
+    gLog.sampleSeqs = NULL;
+    gLog.sampleSeqCount = 0;
+
+    OIC_LOG_V(INFO, TAG, "Log closed: %llu written, %llu dropped, %llu syncs",
+            (unsigned long long)gLog.written.load(), (unsigned long long)gLog.dropped.load(),
+            (unsigned long long)gLog.syncs.load());
+}
+
+int appendMeasurementLog(uint32_t instance, uint64_t sampleSeq, int64_t timestamp,
+        const int32_t *values)
+{
+    if (!gLog.open)
+    {
+        return -1;
+    }
+
+    size_t pos = gLog.enqueuePos.load(std::memory_order_relaxed);
+    MLogCell *cell;
+    while (true)
+    {
+        cell = &gLog.cells[pos % MLOG_QUEUE_RECORDS];
+        size_t seqNo = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seqNo - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (gLog.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // Writer is behind by a whole queue: drop rather than wait
+            gLog.dropped++;
+            return -1;
+        }
+        else
+        {
+            pos = gLog.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // seq and crc are the writer's: records are numbered in log order. Cleared
+    // first so that padding, if the values leave any, is written as zeros.
+    memset(&cell->record, 0, sizeof(cell->record));
+    cell->record.sampleSeq = sampleSeq;
+    cell->record.timestamp = timestamp;
+    cell->record.instance = instance;
+    memcpy(cell->record.values, values, sizeof(cell->record.values));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    gLog.appended++;
+    sem_post(&gLog.pending);
+    return 0;
+}
+
+uint64_t getMeasurementLogSampleSeq(uint32_t instance)
+{
+    return (instance < gLog.sampleSeqCount) ? gLog.sampleSeqs[instance] : 0;
+}
+
+void getMeasurementLogStats(MeasurementLogStats *stats)
+{
+    stats->appended = gLog.appended;
+    stats->written = gLog.written;
+    stats->dropped = gLog.dropped;
+    stats->syncs = gLog.syncs;
+    stats->lastSeq = gLog.lastSeq;
+}
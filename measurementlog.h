@@ -0,0 +1,71 @@
+#ifndef MEASUREMENTLOG_H
+#define MEASUREMENTLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "device/measurement.h"
+
+/* Persistent, append-only log of measurement samples. Records have a fixed
+ * size and a CRC, and are written through mmap into preallocated segment
+ * files (<dir>/bpm-00000001.log, ...) that rotate when full. Producers only
+ * enqueue: copying into the mapping and msync() happen on the log's own
+ * writer thread, so neither OCProcess() nor a request ever waits on disk.
+ * On startup the newest segment is scanned up to the first record that is
+ * invalid or does not have a higher seq than the one before, which drops a
+ * torn tail left by a crash; anything past it is cleared. Readers of segment
+ * files stop at the same point. */
+
+#define MLOG_SEGMENT_RECORDS    65536           // 3 MiB segments
+#define MLOG_QUEUE_RECORDS      8192            // producer -> writer queue, two
+                                                // rounds of 4096 instances
+
+/* One sample of one monitor instance. seq numbers the records of the log and
+ * is assigned by the writer; sampleSeq is the instance's own. The values follow
+ * MEASUREMENT_VALUES, so a new vital sign changes the record size and the
+ * segments written before it are left alone. */
+typedef struct MEASUREMENTRECORD {
+    uint64_t seq;
+    uint64_t sampleSeq;
+    int64_t timestamp;          // ms since the epoch
+    uint32_t instance;
+    int32_t values[MEASUREMENT_VALUE_COUNT];
+    uint32_t reserved;          // 0
+    uint32_t crc;               // CRC-32 of the fields above
+} MeasurementRecord;
+
+typedef enum {
+    MLOG_SYNC_NONE = 0,         // leave write-back to the kernel
+    MLOG_SYNC_INTERVAL,         // msync(MS_SYNC) every syncIntervalMs
+    MLOG_SYNC_ALWAYS            // msync(MS_SYNC) after every batch written
+} MeasurementLogSync;
+
+typedef struct MEASUREMENTLOGSTATS {
+    uint64_t appended;          // records accepted by appendMeasurementLog()
+    uint64_t written;           // records copied into a segment
+    uint64_t dropped;           // records lost because the queue was full
+    uint64_t syncs;             // msync() calls
+    uint64_t lastSeq;           // seq of the last written record
+} MeasurementLogStats;
+
+/* Opens (or creates) the log in dir and starts its writer thread */
+int openMeasurementLog(const char *dir, MeasurementLogSync sync, uint32_t syncIntervalMs);
+
+/* Drains the queue, syncs and unmaps everything */
+void closeMeasurementLog(void);
+
+/* Queues one record; never blocks. Returns 0, or -1 when the log is closed
+ * or the queue is full (the record is counted as dropped). */
+int appendMeasurementLog(uint32_t instance, uint64_t sampleSeq, int64_t timestamp,
+        const int32_t *values);
+
+/* sampleSeq of the last record of instance found when the log was opened, in
+ * the newest segment or the one before it; 0 when there is none */
+uint64_t getMeasurementLogSampleSeq(uint32_t instance);
+
+void getMeasurementLogStats(MeasurementLogStats *stats);
+
+/* Record validation, shared with readers of segment files */
+uint32_t getMeasurementRecordCrc(const MeasurementRecord *record);
+bool isValidMeasurementRecord(const MeasurementRecord *record);
+
+#endif
@@ -0,0 +1,427 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Runtime Metrics
+// Description: Per-thread counters and latency histograms, and their snapshot
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <atomic>
+#include "logger.h"
+#include "common.h"
+#include "arena.h"
+#include "metrics.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-METRICS"
+
+#define METRICS_NAME_LENGTH 32
+#define METRICS_PATH_LENGTH 256
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* Written by its owning thread only, read by anyone; a value is stored
+ * whole, so a reader sees it before or after an update, never half of it */
+typedef struct METRICSSHARD {
+    std::atomic<uint64_t> counters[METRICS_MAX_SOURCES][METRIC_COUNTER_COUNT];
+    std::atomic<uint64_t> buckets[METRICS_MAX_SOURCES][METRIC_HISTOGRAM_COUNT][METRICS_BUCKETS];
+    std::atomic<uint64_t> sums[METRICS_MAX_SOURCES][METRIC_HISTOGRAM_COUNT];   // ns
+    struct METRICSSHARD *next;
+} MetricsShard;
+
+typedef struct METRICSSNAPSHOT {
+    char path[METRICS_PATH_LENGTH];
+    uint32_t periodMs;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // on CLOCK_MONOTONIC, signalled to stop
+    pthread_t thread;
+    bool started;
+    bool quit;
+} MetricsSnapshot;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static char gMetricsNames[METRICS_MAX_SOURCES][METRICS_NAME_LENGTH];
+static std::atomic<int> gMetricsSourceCount(0);
+
+// Every shard ever created, newest first; shards live as long as the process
+static std::atomic<MetricsShard *> gMetricsShards(NULL);
+static __thread MetricsShard *tMetricsShard = NULL;
+
+static MetricsSnapshot gMetricsSnapshot = { "", 0, PTHREAD_MUTEX_INITIALIZER };
+
+static const char *gMetricsCounterNames[METRIC_COUNTER_COUNT] = {
+    "requests", "observe_registers", "observe_deregisters", "notifications", "forbidden",
+    "response_failures", "samples_coalesced", "samples_merged"
+};
+
+static const char *gMetricsHistogramNames[METRIC_HISTOGRAM_COUNT] = { "request", "notify" };
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+int registerMetricsSource(const char *name)
+{
+    int source = gMetricsSourceCount.load();
+    if (source >= METRICS_MAX_SOURCES)
+    {
+        OIC_LOG_V(ERROR, TAG, "No room for metrics source %s", name);
+        return -1;
+    }
+    snprintf(gMetricsNames[source], METRICS_NAME_LENGTH, "%s", name);
+    gMetricsSourceCount.store(source + 1);
+    return source;
+}
+
+int getMetricsSourceCount(void)
+{
+    return gMetricsSourceCount.load();
+}
+
+const char *getMetricsSourceName(int source)
+{
+    if (source < 0 || source >= gMetricsSourceCount.load())
+    {
+        return NULL;
+    }
+    return gMetricsNames[source];
+}
+
+uint64_t getMetricsNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static MetricsShard *getMetricsShard()
+{
+    MetricsShard *shard = tMetricsShard;
+    if (shard)
+    {
+        return shard;
+    }
+    // calloc zeroes the counters; std::atomic<uint64_t> has no other state
+    shard = (MetricsShard *)calloc(1, sizeof(MetricsShard));
+    if (!shard)
+    {
+        return NULL;
+    }
+    MetricsShard *first = gMetricsShards.load();
+    do
+    {
+        shard->next = first;
+    } while (!gMetricsShards.compare_exchange_weak(first, shard));
+    tMetricsShard = shard;
+    return shard;
+}
+
+/* Values below 16 have a bucket each; above, every power of two is cut in 16 */
+static size_t getMetricsBucket(uint64_t ns)
+{
+    if (ns < (1u << METRICS_SUB_BUCKET_BITS))
+    {
+        return (size_t)ns;
+    }
+    if (ns >> METRICS_VALUE_BITS)
+    {
+        return METRICS_BUCKETS - 1;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - METRICS_SUB_BUCKET_BITS;
+    return ((size_t)(msb - METRICS_SUB_BUCKET_BITS + 1) << METRICS_SUB_BUCKET_BITS)
+            + (size_t)((ns >> shift) & ((1u << METRICS_SUB_BUCKET_BITS) - 1));
+}
+
+/* The highest value that falls in the bucket */
+static uint64_t getMetricsBucketValue(size_t bucket)
+{
+    if (bucket < (1u << METRICS_SUB_BUCKET_BITS))
+    {
+        return bucket;
+    }
+    int shift = (int)(bucket >> METRICS_SUB_BUCKET_BITS) - 1;
+    uint64_t sub = (bucket & ((1u << METRICS_SUB_BUCKET_BITS) - 1)) + (1u << METRICS_SUB_BUCKET_BITS);
+    return ((sub + 1) << shift) - 1;
+}
+
+static void addMetric(std::atomic<uint64_t> *value, uint64_t n)
+{
+    value->store(value->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void countMetric(int source, MetricCounter counter, uint64_t n)
+{
+    if (source < 0 || source >= METRICS_MAX_SOURCES)
+    {
+        return;
+    }
+    MetricsShard *shard = getMetricsShard();
+    if (shard)
+    {
+        addMetric(&shard->counters[source][counter], n);
+    }
+}
+
+void recordLatency(int source, MetricHistogram histogram, uint64_t ns)
+{
+    if (source < 0 || source >= METRICS_MAX_SOURCES)
+    {
+        return;
+    }
+    MetricsShard *shard = getMetricsShard();
+    if (shard)
+    {
+        addMetric(&shard->buckets[source][histogram][getMetricsBucket(ns)], 1);
+        addMetric(&shard->sums[source][histogram], ns);
+    }
+}
+
+static void summarizeLatency(const uint64_t *buckets, LatencySummary *summary)
+{
+    memset(summary, 0, sizeof(LatencySummary));
+    for (size_t b = 0; b < METRICS_BUCKETS; b++)
+    {
+        summary->count += buckets[b];
+    }
+    if (summary->count == 0)
+    {
+        return;
+    }
+
+    uint64_t p50 = (summary->count * 50 + 99) / 100;
+    uint64_t p90 = (summary->count * 90 + 99) / 100;
+    uint64_t p99 = (summary->count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < METRICS_BUCKETS; b++)
+    {
+        if (buckets[b] == 0)
+        {
+            continue;
+        }
+        uint64_t value = getMetricsBucketValue(b);
+        if (seen < p50 && seen + buckets[b] >= p50)
+        {
+            summary->p50 = value;
+        }
+        if (seen < p90 && seen + buckets[b] >= p90)
+        {
+            summary->p90 = value;
+        }
+        if (seen < p99 && seen + buckets[b] >= p99)
+        {
+            summary->p99 = value;
+        }
+        seen += buckets[b];
+        summary->max = value;
+    }
+}
+
+void readMetrics(int source, MetricsSummary *summary)
+{
+    memset(summary, 0, sizeof(MetricsSummary));
+    if (source < 0 || source >= METRICS_MAX_SOURCES)
+    {
+        return;
+    }
+
+    static uint64_t buckets[METRIC_HISTOGRAM_COUNT][METRICS_BUCKETS];
+    static pthread_mutex_t bucketsLock = PTHREAD_MUTEX_INITIALIZER;
+    uint64_t sums[METRIC_HISTOGRAM_COUNT] = { 0 };
+    pthread_mutex_lock(&bucketsLock);
+    memset(buckets, 0, sizeof(buckets));
+    for (MetricsShard *shard = gMetricsShards.load(); shard; shard = shard->next)
+    {
+        for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+        {
+            summary->counters[c] += shard->counters[source][c].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+        {
+            for (size_t b = 0; b < METRICS_BUCKETS; b++)
+            {
+                buckets[h][b] += shard->buckets[source][h][b].load(std::memory_order_relaxed);
+            }
+            sums[h] += shard->sums[source][h].load(std::memory_order_relaxed);
+        }
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+    {
+        summarizeLatency(buckets[h], &summary->latency[h]);
+        summary->latency[h].sum = sums[h];
+    }
+    pthread_mutex_unlock(&bucketsLock);
+}
+
+int writeMetricsSnapshot(const char *path)
+{
+    char temporary[METRICS_PATH_LENGTH + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *out = fopen(temporary, "w");
+    if (!out)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to open %s", temporary);
+        return -1;
+    }
+
+    // Process wide: memory over time, next to the response arenas
+    ArenaStats arena;
+    getArenaStats(&arena);
+    fprintf(out, "# TYPE bpm_resident_bytes gauge\n");
+    fprintf(out, "bpm_resident_bytes %lld\n", (long long)getResidentKb() * 1024);
+    fprintf(out, "# TYPE bpm_arena_high_water_bytes gauge\n");
+    fprintf(out, "bpm_arena_high_water_bytes %zu\n", arena.highWater);
+    fprintf(out, "# TYPE bpm_arena_resets_total counter\n");
+    fprintf(out, "bpm_arena_resets_total %llu\n", (unsigned long long)arena.resets);
+    fprintf(out, "# TYPE bpm_arena_overflows_total counter\n");
+    fprintf(out, "bpm_arena_overflows_total %llu\n", (unsigned long long)arena.overflows);
+
+    // The text format wants the lines of a family together, after its TYPE
+    MetricsSummary summaries[METRICS_MAX_SOURCES];
+    int count = getMetricsSourceCount();
+    for (int source = 0; source < count; source++)
+    {
+        readMetrics(source, &summaries[source]);
+    }
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++)
+    {
+        fprintf(out, "# TYPE bpm_%s_total counter\n", gMetricsCounterNames[c]);
+        for (int source = 0; source < count; source++)
+        {
+            fprintf(out, "bpm_%s_total{resource=\"%s\"} %llu\n", gMetricsCounterNames[c],
+                    gMetricsNames[source], (unsigned long long)summaries[source].counters[c]);
+        }
+    }
+    fprintf(out, "# TYPE bpm_latency_ns summary\n");
+    for (int source = 0; source < count; source++)
+    {
+        const char *name = gMetricsNames[source];
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; h++)
+        {
+            const LatencySummary *latency = &summaries[source].latency[h];
+            const char *kind = gMetricsHistogramNames[h];
+            fprintf(out, "bpm_latency_ns{resource=\"%s\",kind=\"%s\",quantile=\"0.5\"} %llu\n",
+                    name, kind, (unsigned long long)latency->p50);
+            fprintf(out, "bpm_latency_ns{resource=\"%s\",kind=\"%s\",quantile=\"0.9\"} %llu\n",
+                    name, kind, (unsigned long long)latency->p90);
+            fprintf(out, "bpm_latency_ns{resource=\"%s\",kind=\"%s\",quantile=\"0.99\"} %llu\n",
+                    name, kind, (unsigned long long)latency->p99);
+            fprintf(out, "bpm_latency_ns{resource=\"%s\",kind=\"%s\",quantile=\"1\"} %llu\n",
+                    name, kind, (unsigned long long)latency->max);
+            fprintf(out, "bpm_latency_ns_sum{resource=\"%s\",kind=\"%s\"} %llu\n",
+                    name, kind, (unsigned long long)latency->sum);
+            fprintf(out, "bpm_latency_ns_count{resource=\"%s\",kind=\"%s\"} %llu\n",
+                    name, kind, (unsigned long long)latency->count);
+        }
+    }
+
+    if (fclose(out) != 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to write %s", temporary);
+        remove(temporary);
+        return -1;
+    }
+    if (rename(temporary, path) != 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to rename %s", temporary);
+        remove(temporary);
+        return -1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Callback functions
+//-----------------------------------------------------------------------------
+
+/* Writes a snapshot every period, on the same clock as the scheduler. A
+ * slow disk delays the next one rather than queueing them up. */
+void *metricsSnapshotThread(void *data)
+{
+    pthread_mutex_lock(&gMetricsSnapshot.lock);
+    uint64_t dueMs = getMonotonicMs() + gMetricsSnapshot.periodMs;
+    while (!gMetricsSnapshot.quit)
+    {
+        struct timespec deadline;
+        getMonotonicDeadline(dueMs, &deadline);
+        if (pthread_cond_timedwait(&gMetricsSnapshot.cond, &gMetricsSnapshot.lock,
+                &deadline) != ETIMEDOUT)
+        {
+            continue;
+        }
+        pthread_mutex_unlock(&gMetricsSnapshot.lock);
+        writeMetricsSnapshot(gMetricsSnapshot.path);
+        pthread_mutex_lock(&gMetricsSnapshot.lock);
+
+        uint64_t nowMs = getMonotonicMs();
+        dueMs += gMetricsSnapshot.periodMs;
+        if (dueMs <= nowMs)
+        {
+            dueMs = nowMs + gMetricsSnapshot.periodMs;
+        }
+    }
+    pthread_mutex_unlock(&gMetricsSnapshot.lock);
+    return NULL;
+}
+
+int startMetricsSnapshot(const char *path, uint32_t periodMs)
+{
+    if (gMetricsSnapshot.started)
+    {
+        return 0;
+    }
+    if (strlen(path) >= METRICS_PATH_LENGTH)
+    {
+        OIC_LOG_V(ERROR, TAG, "Metrics snapshot path too long: %s", path);
+        return -1;
+    }
+    snprintf(gMetricsSnapshot.path, sizeof(gMetricsSnapshot.path), "%s", path);
+    gMetricsSnapshot.periodMs = periodMs;
+    gMetricsSnapshot.quit = false;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gMetricsSnapshot.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&gMetricsSnapshot.thread, NULL, metricsSnapshotThread, NULL) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create metrics snapshot thread");
+        pthread_cond_destroy(&gMetricsSnapshot.cond);
+        return -1;
+    }
+    gMetricsSnapshot.started = true;
+    OIC_LOG_V(INFO, TAG, "Metrics snapshot to %s every %u ms", path, periodMs);
+    return 0;
+}
+
+void stopMetricsSnapshot(void)
+{
+    if (!gMetricsSnapshot.started)
+    {
+        return;
+    }
+    pthread_mutex_lock(&gMetricsSnapshot.lock);
+    gMetricsSnapshot.quit = true;
+    pthread_cond_signal(&gMetricsSnapshot.cond);
+    pthread_mutex_unlock(&gMetricsSnapshot.lock);
+    pthread_join(gMetricsSnapshot.thread, NULL);
+    pthread_cond_destroy(&gMetricsSnapshot.cond);
+    gMetricsSnapshot.started = false;
+
+    writeMetricsSnapshot(gMetricsSnapshot.path);
+}
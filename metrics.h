@@ -0,0 +1,78 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Runtime metrics: counters and latency histograms per source (a resource
+ * type, summed over the instances, or the OCProcess() loop). Every thread
+ * updates its own shard with plain relaxed stores, so recording takes no lock
+ * and no atomic read-modify-write; readers sum the shards. Histograms are log
+ * linear (HDR style): 16 buckets per power of two, about 6% resolution. */
+
+#define METRICS_MAX_SOURCES         8
+#define METRICS_SUB_BUCKET_BITS     4
+#define METRICS_VALUE_BITS          40      // about 18 minutes in ns; longer is counted there
+#define METRICS_BUCKETS             ((METRICS_VALUE_BITS - METRICS_SUB_BUCKET_BITS + 1) \
+                                     << METRICS_SUB_BUCKET_BITS)
+#define METRICS_DEFAULT_SNAPSHOT_MS 10000
+
+typedef enum {
+    METRIC_REQUESTS = 0,            // GETs, or OCProcess() calls of the loop
+    METRIC_OBSERVE_REGISTERS,
+    METRIC_OBSERVE_DEREGISTERS,
+    METRIC_NOTIFICATIONS,           // one per observer notified
+    METRIC_FORBIDDEN,
+    METRIC_RESPONSE_FAILURES,       // OCDoResponse() or notification errors
+    METRIC_SAMPLES_COALESCED,       // samples an observer never got, a newer one went instead
+    METRIC_SAMPLES_MERGED,          // samples sent along with a newer one in a merged notification
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_REQUEST_LATENCY = 0,     // request received to response sent, or one OCProcess()
+    METRIC_NOTIFY_LATENCY,          // one notification round of the resource
+    METRIC_HISTOGRAM_COUNT
+} MetricHistogram;
+
+/* Nanoseconds: the percentiles from the bucket bounds, the sum exact */
+typedef struct LATENCYSUMMARY {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t sum;
+} LatencySummary;
+
+typedef struct METRICSSUMMARY {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    LatencySummary latency[METRIC_HISTOGRAM_COUNT];
+} MetricsSummary;
+
+/* Adds a source at startup, before anything records; returns its id, or -1
+ * when the table is full. Recording with -1 does nothing. */
+int registerMetricsSource(const char *name);
+int getMetricsSourceCount(void);
+const char *getMetricsSourceName(int source);
+
+/* Monotonic clock for the latencies, real time whatever the clock scale */
+uint64_t getMetricsNs(void);
+
+void countMetric(int source, MetricCounter counter, uint64_t n);
+void recordLatency(int source, MetricHistogram histogram, uint64_t ns);
+
+/* Sums every thread's shard */
+void readMetrics(int source, MetricsSummary *summary);
+
+/* Writes every source in the Prometheus text format to path, through a
+ * temporary file renamed over it, so a reader never sees half a snapshot */
+int writeMetricsSnapshot(const char *path);
+
+/* Rewrites the snapshot every periodMs on a thread of its own, so the file
+ * writes never hold up the sampler or the notifiers; the stop joins it and
+ * writes a last snapshot */
+int startMetricsSnapshot(const char *path, uint32_t periodMs);
+void stopMetricsSnapshot(void);
+
+#endif
@@ -0,0 +1,261 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Observer Registry
+// Description: Tracks observers and their notification periods (pmin/pmax)
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "logger.h"
+#include "common.h"
+#include "observers.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-OBSERVERS"
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+void initObserverRegistry(ObserverRegistry *registry)
+{
+    pthread_mutex_init(&registry->lock, NULL);
+    registry->entries = NULL;
+    registry->count = 0;
+    registry->capacity = 0;
+    registry->heartbeatMs = 0;
+    registry->notified = 0;
+    registry->heartbeats = 0;
+    registry->suppressed = 0;
+}
+
+void deinitObserverRegistry(ObserverRegistry *registry)
+{
+    pthread_mutex_lock(&registry->lock);
+    free(registry->entries);
+    registry->entries = NULL;
+    registry->count = 0;
+    registry->capacity = 0;
+    pthread_mutex_unlock(&registry->lock);
+    pthread_mutex_destroy(&registry->lock);
+}
+
+static ObserverEntry *findObserver(ObserverRegistry *registry, OCObservationId id)
+{
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        if (registry->entries[i].id == id)
+        {
+            return &registry->entries[i];
+        }
+    }
+    return NULL;
+}
+
+int addObserver(ObserverRegistry *registry, OCObservationId id, const ParsedQuery *query,
+        int variant, uint32_t linkMask)
+{
+    uint32_t pmin = query->hasPmin ? query->pminMs : OBSERVE_DEFAULT_PMIN_MS;
+    uint32_t pmax = query->hasPmax ? query->pmaxMs : 0;
+    if (pmin < OBSERVE_MIN_PMIN_MS)
+    {
+        pmin = OBSERVE_MIN_PMIN_MS;
+    }
+    if (pmax && pmax < pmin)
+    {
+        pmax = pmin;
+    }
+
+    pthread_mutex_lock(&registry->lock);
+    ObserverEntry *entry = findObserver(registry, id);
+    if (!entry)
+    {
+        if (registry->count == registry->capacity)
+        {
+            size_t capacity = registry->capacity ? registry->capacity * 2 : 8;
+            ObserverEntry *entries = (ObserverEntry *)realloc(registry->entries,
+                    capacity * sizeof(ObserverEntry));
+            if (!entries)
+            {
+                pthread_mutex_unlock(&registry->lock);
+                OIC_LOG(ERROR, TAG, "Failed to grow observer registry");
+                return -1;
+            }
+            registry->entries = entries;
+            registry->capacity = capacity;
+        }
+        entry = &registry->entries[registry->count++];
+        entry->lastSeq = 0;
+    }
+    entry->id = id;
+    entry->variant = variant;
+    entry->linkMask = linkMask;
+    entry->pminMs = pmin;
+    entry->pmaxMs = pmax;
+    entry->lastNotifyMs = getMonotonicMs();
+    entry->suppressedUntilMs = 0;
+    int count = (int)registry->count;
+    pthread_mutex_unlock(&registry->lock);
+
+    OIC_LOG_V(INFO, TAG, "observer %u: pmin %u ms pmax %u ms", (unsigned)id, pmin, pmax);
+    return count;
+}
+
+int removeObserver(ObserverRegistry *registry, OCObservationId id)
+{
+    pthread_mutex_lock(&registry->lock);
+    ObserverEntry *entry = findObserver(registry, id);
+    if (entry)
+    {
+        // Order does not matter: move the last entry into the hole
+        *entry = registry->entries[--registry->count];
+    }
+    int count = (int)registry->count;
+    pthread_mutex_unlock(&registry->lock);
+    return count;
+}
+
+int clearObservers(ObserverRegistry *registry)
+{
+    pthread_mutex_lock(&registry->lock);
+    int count = (int)registry->count;
+    registry->count = 0;
+    pthread_mutex_unlock(&registry->lock);
+    return count;
+}
+
+uint32_t getMinObserverPeriod(ObserverRegistry *registry)
+{
+    uint32_t period = 0;
+    pthread_mutex_lock(&registry->lock);
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        if (period == 0 || registry->entries[i].pminMs < period)
+        {
+            period = registry->entries[i].pminMs;
+        }
+    }
+    pthread_mutex_unlock(&registry->lock);
+    return period;
+}
+
+void setObserverHeartbeat(ObserverRegistry *registry, uint32_t heartbeatMs)
+{
+    pthread_mutex_lock(&registry->lock);
+    registry->heartbeatMs = heartbeatMs;
+    pthread_mutex_unlock(&registry->lock);
+}
+
+static bool growObserverIdList(ObserverIdList *list, size_t capacity)
+{
+    OCObservationId *ids = (OCObservationId *)realloc(list->ids,
+            capacity * sizeof(OCObservationId));
+    if (!ids)
+    {
+        return false;
+    }
+    list->ids = ids;
+    uint64_t *lastSeqs = (uint64_t *)realloc(list->lastSeqs, capacity * sizeof(uint64_t));
+    if (!lastSeqs)
+    {
+        return false;
+    }
+    list->lastSeqs = lastSeqs;
+    uint32_t *linkMasks = (uint32_t *)realloc(list->linkMasks, capacity * sizeof(uint32_t));
+    if (!linkMasks)
+    {
+        return false;
+    }
+    list->linkMasks = linkMasks;
+    list->capacity = capacity;
+    return true;
+}
+
+size_t collectDueObservers(ObserverRegistry *registry, int variant, uint64_t nowMs,
+        uint64_t lastChangeMs, uint32_t slackMs, uint64_t seq, ObserverIdList *list)
+{
+    list->count = 0;
+    pthread_mutex_lock(&registry->lock);
+    if (list->capacity < registry->count && !growObserverIdList(list, registry->count))
+    {
+        pthread_mutex_unlock(&registry->lock);
+        OIC_LOG(ERROR, TAG, "Failed to grow observer id list");
+        return 0;
+    }
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        ObserverEntry *entry = &registry->entries[i];
+        if (entry->variant != variant || nowMs + slackMs < entry->lastNotifyMs + entry->pminMs)
+        {
+            continue;
+        }
+
+        uint32_t maxSilence = entry->pmaxMs ? entry->pmaxMs : registry->heartbeatMs;
+        bool changed = lastChangeMs > entry->lastNotifyMs;
+        bool heartbeat = maxSilence && nowMs + slackMs >= entry->lastNotifyMs + maxSilence;
+        if (!changed && !heartbeat)
+        {
+            // The tick runs at the smallest pmin of all observers: count one
+            // suppressed notification per pmin window of this one
+            if (nowMs + slackMs >= entry->suppressedUntilMs)
+            {
+                registry->suppressed++;
+                entry->suppressedUntilMs = nowMs + entry->pminMs;
+            }
+            continue;
+        }
+        if (!changed)
+        {
+            registry->heartbeats++;
+        }
+        registry->notified++;
+        entry->lastNotifyMs = nowMs;
+        list->ids[list->count] = entry->id;
+        list->linkMasks[list->count] = entry->linkMask;
+        list->lastSeqs[list->count++] = entry->lastSeq;
+        entry->lastSeq = seq;
+    }
+    pthread_mutex_unlock(&registry->lock);
+    return list->count;
+}
+
+uint64_t countSkippedSamples(const ObserverIdList *list, uint64_t seq)
+{
+    uint64_t skipped = 0;
+    for (size_t i = 0; i < list->count; i++)
+    {
+        // The first notification starts from the sample at hand
+        uint64_t lastSeq = list->lastSeqs[i];
+        if (lastSeq && seq > lastSeq + 1)
+        {
+            skipped += seq - lastSeq - 1;
+        }
+    }
+    return skipped;
+}
+
+void getObserverStats(ObserverRegistry *registry, ObserverStats *stats)
+{
+    pthread_mutex_lock(&registry->lock);
+    stats->observers = registry->count;
+    stats->notified = registry->notified;
+    stats->heartbeats = registry->heartbeats;
+    stats->suppressed = registry->suppressed;
+    pthread_mutex_unlock(&registry->lock);
+}
+
+void freeObserverIdList(ObserverIdList *list)
+{
+    free(list->ids);
+    free(list->lastSeqs);
+    free(list->linkMasks);
+    list->ids = NULL;
+    list->lastSeqs = NULL;
+    list->linkMasks = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
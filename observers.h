@@ -0,0 +1,97 @@
+#ifndef OBSERVERS_H
+#define OBSERVERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "ocstack.h"
+#include "query.h"
+
+/* Per-resource registry of observers keyed by OCObservationId. Each observer
+ * carries its own notification periods, given in seconds (fractions allowed)
+ * in the observe query: ?pmin=0.25&pmax=30
+ *   pmin: minimum time between two notifications (default 2 s)
+ *   pmax: maximum silence, 0 for the registry's heartbeat (default)
+ * An observer is due when its pmin has elapsed and the resource changed since
+ * its last notification, or when its pmax (heartbeat) has elapsed. */
+
+#define OBSERVE_DEFAULT_PMIN_MS 2000
+#define OBSERVE_MIN_PMIN_MS     50
+
+typedef struct OBSERVERENTRY {
+    OCObservationId id;
+    int variant;                // resource specific payload variant (interface)
+    uint32_t linkMask;          // links an rt query selected, 0 for no selection
+    uint32_t pminMs;
+    uint32_t pmaxMs;
+    uint64_t lastNotifyMs;      // getMonotonicMs() of the last notification
+    uint64_t lastSeq;           // sample it carried, 0 before the first one
+    uint64_t suppressedUntilMs; // end of the pmin window last counted as suppressed
+} ObserverEntry;
+
+typedef struct OBSERVERREGISTRY {
+    pthread_mutex_t lock;
+    ObserverEntry *entries;
+    size_t count;
+    size_t capacity;
+    uint32_t heartbeatMs;       // max silence for observers without pmax, 0 for none
+    uint64_t notified;          // notifications handed out
+    uint64_t heartbeats;        // ... of which only because of the max silence
+    uint64_t suppressed;        // pmin windows that elapsed with nothing changed
+} ObserverRegistry;
+
+typedef struct OBSERVERSTATS {
+    size_t observers;
+    uint64_t notified;
+    uint64_t heartbeats;
+    uint64_t suppressed;
+} ObserverStats;
+
+/* Caller owned list of observation ids, grown on demand, with the sample
+ * each observer had been sent before and its link mask */
+typedef struct OBSERVERIDLIST {
+    OCObservationId *ids;
+    uint64_t *lastSeqs;
+    uint32_t *linkMasks;
+    size_t count;
+    size_t capacity;
+} ObserverIdList;
+
+void initObserverRegistry(ObserverRegistry *registry);
+void deinitObserverRegistry(ObserverRegistry *registry);
+
+/* Adds (or updates) an observer with the periods of its parsed query. Returns
+ * the number of registered observers, or -1 on allocation failure. */
+int addObserver(ObserverRegistry *registry, OCObservationId id, const ParsedQuery *query,
+        int variant, uint32_t linkMask);
+
+/* Removes an observer; returns the number of observers left. */
+int removeObserver(ObserverRegistry *registry, OCObservationId id);
+
+/* Removes every observer; returns how many there were. */
+int clearObservers(ObserverRegistry *registry);
+
+/* Smallest pmin of all observers, 0 when there are none. */
+uint32_t getMinObserverPeriod(ObserverRegistry *registry);
+
+/* Max silence applied to observers that did not give a pmax */
+void setObserverHeartbeat(ObserverRegistry *registry, uint32_t heartbeatMs);
+
+/* Fills list with the observers of the given variant that are due at nowMs
+ * and marks them notified with sample seq. lastChangeMs is when the resource
+ * last changed (pass nowMs when every sample counts as a change); slackMs
+ * absorbs timer jitter. Returns the number of ids in the list. */
+size_t collectDueObservers(ObserverRegistry *registry, int variant, uint64_t nowMs,
+        uint64_t lastChangeMs, uint32_t slackMs, uint64_t seq, ObserverIdList *list);
+
+/* Samples the observers in list missed between the one they had been sent
+ * and seq: superseded before they were due */
+uint64_t countSkippedSamples(const ObserverIdList *list, uint64_t seq);
+
+void getObserverStats(ObserverRegistry *registry, ObserverStats *stats);
+
+void freeObserverIdList(ObserverIdList *list);
+
+#endif
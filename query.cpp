@@ -0,0 +1,316 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Query Parser
+// Description: Single pass request query tokenizer with perfect hash lookups
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "query.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define QUERY_MAX_PERIOD_S  86400
+
+// The hash table of a name list, filled in at compile time
+#define QUERY_SLOT_TABLE(names) { \
+    findQuerySlot(names, 0), findQuerySlot(names, 1), findQuerySlot(names, 2), \
+    findQuerySlot(names, 3), findQuerySlot(names, 4), findQuerySlot(names, 5), \
+    findQuerySlot(names, 6), findQuerySlot(names, 7), findQuerySlot(names, 8), \
+    findQuerySlot(names, 9), findQuerySlot(names, 10), findQuerySlot(names, 11), \
+    findQuerySlot(names, 12), findQuerySlot(names, 13), findQuerySlot(names, 14), \
+    findQuerySlot(names, 15), findQuerySlot(names, 16), findQuerySlot(names, 17), \
+    findQuerySlot(names, 18), findQuerySlot(names, 19), findQuerySlot(names, 20), \
+    findQuerySlot(names, 21), findQuerySlot(names, 22), findQuerySlot(names, 23), \
+    findQuerySlot(names, 24), findQuerySlot(names, 25), findQuerySlot(names, 26), \
+    findQuerySlot(names, 27), findQuerySlot(names, 28), findQuerySlot(names, 29), \
+    findQuerySlot(names, 30), findQuerySlot(names, 31) }
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+// Names in enum order; NONE has no name, UNKNOWN ends the list
+static constexpr const char *gQueryInterfaceNames[QUERY_IF_UNKNOWN + 1] = {
+    nullptr,
+    "oic.if.baseline",
+    "oic.if.ll",
+    "oic.if.b",
+    "oic.if.s",
+    "oic.if.a",
+    "oic.if.r",
+    "oic.if.rw",
+    "oic.if.create",
+    "oic.if.startup",
+    "oic.if.startup.revert",
+    nullptr
+};
+
+static constexpr const char *gQueryResourceTypeNames[QUERY_RT_UNKNOWN + 1] = {
+    nullptr,
+    "oic.r.bloodpressuremonitor-am",
+    "oic.wk.atomicmeasurement",
+    "oic.r.blood.pressure",
+    "oic.r.pulserate",
+    nullptr
+};
+
+//-----------------------------------------------------------------------------
+// Perfect hash
+//-----------------------------------------------------------------------------
+
+/* Length and last character tell every known name apart; the static_asserts
+ * below fail the build when a new name collides with another one. */
+static constexpr uint32_t hashQueryName(const char *name, size_t length)
+{
+    return ((uint32_t)length ^ ((uint32_t)(unsigned char)name[length - 1] * 7))
+        & (QUERY_HASH_SLOTS - 1);
+}
+
+static constexpr size_t getConstLength(const char *s)
+{
+    return *s ? 1 + getConstLength(s + 1) : 0;
+}
+
+template<size_t N>
+static constexpr uint8_t findQuerySlot(const char *const (&names)[N], uint32_t slot,
+        size_t i = 1)
+{
+    return i >= N ? 0
+        : (names[i] && hashQueryName(names[i], getConstLength(names[i])) == slot) ? (uint8_t)i
+        : findQuerySlot(names, slot, i + 1);
+}
+
+template<size_t N>
+static constexpr size_t countQueryNames(const char *const (&names)[N], size_t i = 0)
+{
+    return i >= N ? 0 : (names[i] ? 1 : 0) + countQueryNames(names, i + 1);
+}
+
+template<size_t N>
+static constexpr size_t countQuerySlots(const char *const (&names)[N], uint32_t slot = 0)
+{
+    return slot >= QUERY_HASH_SLOTS ? 0
+        : (findQuerySlot(names, slot) ? 1 : 0) + countQuerySlots(names, slot + 1);
+}
+
+static_assert(countQuerySlots(gQueryInterfaceNames) == countQueryNames(gQueryInterfaceNames),
+        "interface names collide in hashQueryName()");
+static_assert(countQuerySlots(gQueryResourceTypeNames) == countQueryNames(gQueryResourceTypeNames),
+        "resource type names collide in hashQueryName()");
+
+// Slot -> enum value, 0 for an empty slot
+static constexpr uint8_t gQueryInterfaceSlots[QUERY_HASH_SLOTS] =
+    QUERY_SLOT_TABLE(gQueryInterfaceNames);
+static constexpr uint8_t gQueryResourceTypeSlots[QUERY_HASH_SLOTS] =
+    QUERY_SLOT_TABLE(gQueryResourceTypeNames);
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+/* Enum value of name in a perfect hash table, 0 when it is not in it */
+static uint8_t lookupQueryName(const uint8_t *slots, const char *const *names,
+        const char *name, size_t length)
+{
+    if (length == 0)
+    {
+        return 0;
+    }
+    uint8_t value = slots[hashQueryName(name, length)];
+    if (value && strncmp(names[value], name, length) == 0 && names[value][length] == '\0')
+    {
+        return value;
+    }
+    return 0;
+}
+
+QueryInterface lookupQueryInterface(const char *name, size_t length)
+{
+    uint8_t value = lookupQueryName(gQueryInterfaceSlots, gQueryInterfaceNames, name, length);
+    return value ? (QueryInterface)value : QUERY_IF_UNKNOWN;
+}
+
+QueryResourceType lookupQueryResourceType(const char *name, size_t length)
+{
+    uint8_t value = lookupQueryName(gQueryResourceTypeSlots, gQueryResourceTypeNames, name,
+            length);
+    return value ? (QueryResourceType)value : QUERY_RT_UNKNOWN;
+}
+
+const char *getQueryInterfaceName(QueryInterface iface)
+{
+    return (iface <= QUERY_IF_UNKNOWN) ? gQueryInterfaceNames[iface] : nullptr;
+}
+
+const char *getQueryResourceTypeName(QueryResourceType rt)
+{
+    return (rt <= QUERY_RT_UNKNOWN) ? gQueryResourceTypeNames[rt] : nullptr;
+}
+
+/* Seconds with an optional fraction ("0.25") as ms, rounded; the value ends
+ * at the next separator. Parsed by hand: strtod() costs more than the rest of
+ * the query. */
+static bool parseQueryPeriod(const char *value, const char *end, uint32_t *periodMs)
+{
+    uint64_t seconds = 0;
+    const char *p = value;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        seconds = seconds * 10 + (*p++ - '0');
+        if (seconds > QUERY_MAX_PERIOD_S)
+        {
+            return false;
+        }
+    }
+    bool digits = (p > value);
+
+    uint32_t fractionMs = 0;
+    if (p < end && *p == '.')
+    {
+        p++;
+        uint32_t scale = 100;
+        uint32_t rest = 0;          // fourth fraction digit, for the rounding
+        for (int i = 0; p < end && *p >= '0' && *p <= '9'; i++, p++)
+        {
+            if (i < 3)
+            {
+                fractionMs += (*p - '0') * scale;
+                scale /= 10;
+            }
+            else if (i == 3)
+            {
+                rest = *p - '0';
+            }
+            digits = true;
+        }
+        fractionMs += (rest >= 5) ? 1 : 0;
+    }
+    if (!digits || p != end)
+    {
+        return false;
+    }
+
+    uint64_t ms = seconds * 1000 + fractionMs;
+    if (ms > QUERY_MAX_PERIOD_S * 1000ull)
+    {
+        return false;
+    }
+    *periodMs = (uint32_t)ms;
+    return true;
+}
+
+static bool parseQueryInt(const char *value, const char *end, int64_t *out)
+{
+    const char *p = value;
+    bool negative = (p < end && *p == '-');
+    if (negative)
+    {
+        p++;
+    }
+    if (p == end || end - p > 18)
+    {
+        // Empty, or possibly beyond int64_t
+        return false;
+    }
+
+    int64_t number = 0;
+    for (; p < end; p++)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            return false;
+        }
+        number = number * 10 + (*p - '0');
+    }
+    *out = negative ? -number : number;
+    return true;
+}
+
+bool parseQuery(const char *query, ParsedQuery *parsed)
+{
+    memset(parsed, 0, sizeof(*parsed));
+    bool valid = true;
+
+    const char *p = query;
+    while (p && *p)
+    {
+        // One parameter: key up to '=', value up to the next separator
+        const char *key = p;
+        while (*p && *p != '=' && *p != '&' && *p != ';')
+        {
+            p++;
+        }
+        if (*p != '=')
+        {
+            // A parameter without a value
+            p += (*p != '\0');
+            continue;
+        }
+        const char *equals = p;
+        while (*p && *p != '&' && *p != ';')
+        {
+            p++;
+        }
+        const char *end = p;
+        p += (*p != '\0');
+
+        const char *value = equals + 1;
+        size_t keyLength = equals - key;
+        size_t valueLength = end - value;
+        int64_t number = 0;
+
+        // Keys are told apart by their length and first character
+        switch (keyLength)
+        {
+        case 2:
+            if (key[0] == 'i' && key[1] == 'f')
+            {
+                parsed->iface = lookupQueryInterface(value, valueLength);
+            }
+            else if (key[0] == 'r' && key[1] == 't')
+            {
+                QueryResourceType rt = lookupQueryResourceType(value, valueLength);
+                parsed->rtMask |= QUERY_RT_BIT(rt);
+                if (rt == QUERY_RT_UNKNOWN && parsed->unknownRtCount < QUERY_MAX_UNKNOWN_RT)
+                {
+                    QueryValue *unknown = &parsed->unknownRts[parsed->unknownRtCount++];
+                    unknown->text = value;
+                    unknown->length = valueLength;
+                }
+            }
+            break;
+        case 4:
+            if (strncmp(key, "pmin", 4) == 0)
+            {
+                parsed->hasPmin = parseQueryPeriod(value, end, &parsed->pminMs);
+                valid = valid && parsed->hasPmin;
+            }
+            else if (strncmp(key, "pmax", 4) == 0)
+            {
+                parsed->hasPmax = parseQueryPeriod(value, end, &parsed->pmaxMs);
+                valid = valid && parsed->hasPmax;
+            }
+            break;
+        case 5:
+            if (strncmp(key, "since", 5) == 0)
+            {
+                parsed->hasSince = parseQueryInt(value, end, &parsed->since);
+                valid = valid && parsed->hasSince;
+            }
+            else if (strncmp(key, "limit", 5) == 0)
+            {
+                parsed->hasLimit = parseQueryInt(value, end, &number) && number >= 0
+                    && number <= UINT32_MAX;
+                parsed->limit = parsed->hasLimit ? (uint32_t)number : 0;
+                valid = valid && parsed->hasLimit;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return valid;
+}
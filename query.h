@@ -0,0 +1,78 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Request query parser: one pass over "a=b&c=d" (or ';' separated), no
+ * allocation. Interface and resource type names are mapped to enums through
+ * a perfect hash, so entity handlers dispatch with a switch instead of
+ * comparing the raw query. Parameters it does not know are skipped. */
+
+#define QUERY_HASH_SLOTS    32
+
+typedef enum {
+    QUERY_IF_NONE = 0,          // no if= parameter
+    QUERY_IF_BASELINE,
+    QUERY_IF_LL,
+    QUERY_IF_BATCH,
+    QUERY_IF_SENSOR,
+    QUERY_IF_ACTUATOR,
+    QUERY_IF_READ,
+    QUERY_IF_READWRITE,
+    QUERY_IF_CREATE,
+    QUERY_IF_STARTUP,
+    QUERY_IF_STARTUP_REVERT,
+    QUERY_IF_UNKNOWN            // an if= value that is none of the above
+} QueryInterface;
+
+typedef enum {
+    QUERY_RT_NONE = 0,
+    QUERY_RT_BLOOD_PRESSURE_MONITOR_AM,
+    QUERY_RT_ATOMIC_MEASUREMENT,
+    QUERY_RT_BLOOD_PRESSURE,
+    QUERY_RT_PULSE_RATE,
+    QUERY_RT_UNKNOWN
+} QueryResourceType;
+
+#define QUERY_RT_BIT(rt)    (1u << (rt))
+#define QUERY_MAX_UNKNOWN_RT 8      // rt= values kept by name; further ones are
+                                    // only flagged in rtMask
+
+/* A value of the query, not terminated: it points into the query string and
+ * is only valid as long as that is */
+typedef struct QUERYVALUE {
+    const char *text;
+    size_t length;
+} QueryValue;
+
+typedef struct PARSEDQUERY {
+    QueryInterface iface;       // the last if= wins
+    uint32_t rtMask;            // QUERY_RT_BIT() of every rt= value
+    // rt= values that are QUERY_RT_UNKNOWN, by name: a resource may still
+    // have one of those types
+    size_t unknownRtCount;
+    QueryValue unknownRts[QUERY_MAX_UNKNOWN_RT];
+    bool hasSince;
+    bool hasLimit;
+    bool hasPmin;
+    bool hasPmax;
+    int64_t since;              // ms since the epoch
+    uint32_t limit;
+    uint32_t pminMs;            // pmin/pmax are given in seconds
+    uint32_t pmaxMs;
+} ParsedQuery;
+
+/* Parses query (NULL or empty for none) into *parsed. Returns false when a
+ * known parameter has a malformed value; *parsed still holds the rest. */
+bool parseQuery(const char *query, ParsedQuery *parsed);
+
+/* Enum of the interface or resource type name of the given length */
+QueryInterface lookupQueryInterface(const char *name, size_t length);
+QueryResourceType lookupQueryResourceType(const char *name, size_t length);
+
+/* Name of an enum value, NULL for NONE and UNKNOWN */
+const char *getQueryInterfaceName(QueryInterface iface);
+const char *getQueryResourceTypeName(QueryResourceType rt);
+
+#endif
@@ -0,0 +1,360 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Scheduler
+// Description: Timer wheel thread shared by all periodic server tasks
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "logger.h"
+#include "common.h"
+#include "scheduler.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-SCHEDULER"
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+struct SCHEDULERTASK {
+    SchedulerTaskCb cb;
+    void *ctx;
+    uint32_t periodTicks;
+    uint64_t dueTick;           // absolute tick of the next run
+    SchedulerTask *prev;        // wheel slot list, NULL when not queued
+    SchedulerTask *next;
+    bool queued;
+    bool cancelled;
+};
+
+typedef struct SCHEDULER {
+    pthread_t thread;
+    pthread_cond_t cond;        // wakes the thread when the wheel changes
+    pthread_cond_t idle;        // signaled when a callback returns
+    SchedulerTask *slots[SCHEDULER_WHEEL_SLOTS];
+    SchedulerTask *runningTask; // task whose callback is executing
+    uint64_t currentTick;       // every tick before this one has been processed
+    uint64_t startMs;
+    unsigned int taskCount;
+    bool started;
+    bool quit;
+} Scheduler;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static Scheduler gScheduler;
+static pthread_mutex_t gSchedulerLock = PTHREAD_MUTEX_INITIALIZER;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static uint64_t schedulerNowTick()
+{
+    return (getMonotonicMs() - gScheduler.startMs) / SCHEDULER_TICK_MS;
+}
+
+/* Rounds up in 64 bits: a period near UINT32_MAX ms, such as a clamped trace
+ * gap, must not wrap to a one tick period */
+static uint32_t msToTicks(uint32_t ms)
+{
+    uint64_t ticks = ((uint64_t)ms + SCHEDULER_TICK_MS - 1) / SCHEDULER_TICK_MS;
+    if (ticks > UINT32_MAX)
+    {
+        ticks = UINT32_MAX;
+    }
+    return ticks ? (uint32_t)ticks : 1;
+}
+
+static void wheelInsert(SchedulerTask *task)
+{
+    SchedulerTask **slot = &gScheduler.slots[task->dueTick % SCHEDULER_WHEEL_SLOTS];
+    task->prev = NULL;
+    task->next = *slot;
+    if (*slot)
+    {
+        (*slot)->prev = task;
+    }
+    *slot = task;
+    task->queued = true;
+}
+
+static void wheelRemove(SchedulerTask *task)
+{
+    if (!task->queued)
+    {
+        return;
+    }
+    if (task->prev)
+    {
+        task->prev->next = task->next;
+    }
+    else
+    {
+        gScheduler.slots[task->dueTick % SCHEDULER_WHEEL_SLOTS] = task->next;
+    }
+    if (task->next)
+    {
+        task->next->prev = task->prev;
+    }
+    task->prev = task->next = NULL;
+    task->queued = false;
+}
+
+/* Ticks to wait from currentTick until the next occupied slot. Long periods
+ * share slots with later revolutions, so this is a lower bound at worst. */
+static uint64_t ticksUntilNextTask()
+{
+    for (uint64_t i = 0; i < SCHEDULER_WHEEL_SLOTS; i++)
+    {
+        if (gScheduler.slots[(gScheduler.currentTick + i) % SCHEDULER_WHEEL_SLOTS])
+        {
+            return i;
+        }
+    }
+    return SCHEDULER_WHEEL_SLOTS;
+}
+
+static void waitUntilTick(uint64_t tick)
+{
+    uint64_t dueMs = gScheduler.startMs + tick * SCHEDULER_TICK_MS;
+    struct timespec deadline;
+    getMonotonicDeadline(dueMs, &deadline);
+    pthread_cond_timedwait(&gScheduler.cond, &gSchedulerLock, &deadline);
+}
+
+static void runTask(SchedulerTask *task)
+{
+    gScheduler.runningTask = task;
+    pthread_mutex_unlock(&gSchedulerLock);
+
+    task->cb(task->ctx);
+
+    pthread_mutex_lock(&gSchedulerLock);
+    gScheduler.runningTask = NULL;
+    if (task->cancelled)
+    {
+        free(task);
+    }
+    else if (!task->queued)
+    {
+        task->dueTick = gScheduler.currentTick + task->periodTicks;
+        wheelInsert(task);
+    }
+    pthread_cond_broadcast(&gScheduler.idle);
+}
+
+void *schedulerThread(void *data)
+{
+    pthread_mutex_lock(&gSchedulerLock);
+    while (!gScheduler.quit)
+    {
+        uint64_t now = schedulerNowTick();
+        if (gScheduler.currentTick > now)
+        {
+            if (gScheduler.taskCount == 0)
+            {
+                pthread_cond_wait(&gScheduler.cond, &gSchedulerLock);
+            }
+            else
+            {
+                waitUntilTick(gScheduler.currentTick + ticksUntilNextTask());
+            }
+            continue;
+        }
+
+        // Process the current slot: due tasks run, later revolutions stay
+        SchedulerTask **slot = &gScheduler.slots[gScheduler.currentTick % SCHEDULER_WHEEL_SLOTS];
+        SchedulerTask *task = *slot;
+        while (task && !gScheduler.quit)
+        {
+            SchedulerTask *next = task->next;
+            if (task->dueTick <= gScheduler.currentTick)
+            {
+                wheelRemove(task);
+                runTask(task);
+                // The slot may have changed while unlocked: rescan it
+                next = *slot;
+            }
+            task = next;
+        }
+        gScheduler.currentTick++;
+    }
+    pthread_mutex_unlock(&gSchedulerLock);
+    return NULL;
+}
+
+int startScheduler(void)
+{
+    if (gScheduler.started)
+    {
+        return 0;
+    }
+
+    memset(gScheduler.slots, 0, sizeof(gScheduler.slots));
+    gScheduler.runningTask = NULL;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gScheduler.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&gScheduler.idle, NULL);
+    gScheduler.startMs = getMonotonicMs();
+    gScheduler.currentTick = 0;
+    gScheduler.taskCount = 0;
+    gScheduler.quit = false;
+    gScheduler.started = true;
+
+    if (pthread_create(&gScheduler.thread, NULL, schedulerThread, NULL) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create scheduler thread");
+        gScheduler.started = false;
+        return -1;
+    }
+    OIC_LOG(INFO, TAG, "Scheduler started");
+    return 0;
+}
+
+void stopScheduler(void)
+{
+    if (!gScheduler.started)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gSchedulerLock);
+    gScheduler.quit = true;
+    pthread_cond_signal(&gScheduler.cond);
+    pthread_mutex_unlock(&gSchedulerLock);
+    pthread_join(gScheduler.thread, NULL);
+
+    pthread_mutex_lock(&gSchedulerLock);
+    for (int i = 0; i < SCHEDULER_WHEEL_SLOTS; i++)
+    {
+        while (gScheduler.slots[i])
+        {
+            SchedulerTask *task = gScheduler.slots[i];
+            gScheduler.slots[i] = task->next;
+            free(task);
+        }
+    }
+    gScheduler.taskCount = 0;
+    gScheduler.started = false;
+    pthread_mutex_unlock(&gSchedulerLock);
+    OIC_LOG(INFO, TAG, "Scheduler stopped");
+}
+
+SchedulerTask *scheduleTask(SchedulerTaskCb cb, void *ctx, uint32_t periodMs)
+{
+    SchedulerTask *task = (SchedulerTask *)calloc(1, sizeof(SchedulerTask));
+    if (!task)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate scheduler task");
+        return NULL;
+    }
+    task->cb = cb;
+    task->ctx = ctx;
+    task->periodTicks = msToTicks(periodMs);
+
+    pthread_mutex_lock(&gSchedulerLock);
+    if (!gScheduler.started)
+    {
+        pthread_mutex_unlock(&gSchedulerLock);
+        free(task);
+        OIC_LOG(ERROR, TAG, "Scheduler is not running");
+        return NULL;
+    }
+    // currentTick may lag behind while the thread sleeps: anchor on real time
+    uint64_t now = schedulerNowTick();
+    task->dueTick = ((now > gScheduler.currentTick) ? now : gScheduler.currentTick) + task->periodTicks;
+    wheelInsert(task);
+    gScheduler.taskCount++;
+    pthread_cond_signal(&gScheduler.cond);
+    pthread_mutex_unlock(&gSchedulerLock);
+
+    return task;
+}
+
+void setTaskPeriod(SchedulerTask *task, uint32_t periodMs)
+{
+    if (!task)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gSchedulerLock);
+    uint32_t ticks = msToTicks(periodMs);
+    if (ticks != task->periodTicks)
+    {
+        uint64_t lastRun = task->dueTick - task->periodTicks;
+        task->periodTicks = ticks;
+        if (task->queued)
+        {
+            wheelRemove(task);
+            task->dueTick = lastRun + ticks;
+            if (task->dueTick < gScheduler.currentTick)
+            {
+                task->dueTick = gScheduler.currentTick;
+            }
+            wheelInsert(task);
+            pthread_cond_signal(&gScheduler.cond);
+        }
+    }
+    pthread_mutex_unlock(&gSchedulerLock);
+}
+
+static void removeTask(SchedulerTask *task, bool wait)
+{
+    if (!task)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gSchedulerLock);
+    if (!gScheduler.started)
+    {
+        // stopScheduler() already released every task
+        pthread_mutex_unlock(&gSchedulerLock);
+        return;
+    }
+    wheelRemove(task);
+    gScheduler.taskCount--;
+    if (gScheduler.runningTask == task)
+    {
+        // Freed by the scheduler thread once the callback returns
+        task->cancelled = true;
+        if (wait && !pthread_equal(pthread_self(), gScheduler.thread))
+        {
+            while (gScheduler.runningTask == task)
+            {
+                pthread_cond_wait(&gScheduler.idle, &gSchedulerLock);
+            }
+        }
+    }
+    else
+    {
+        free(task);
+    }
+    pthread_mutex_unlock(&gSchedulerLock);
+}
+
+void cancelTask(SchedulerTask *task)
+{
+    removeTask(task, true);
+}
+
+void releaseTask(SchedulerTask *task)
+{
+    removeTask(task, false);
+}
@@ -0,0 +1,38 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/* Single scheduler thread driving every periodic job of the server (sampling,
+ * notifications). Tasks live on a hashed timer wheel; the thread sleeps until
+ * the next occupied slot instead of ticking when nothing is due. */
+
+#define SCHEDULER_TICK_MS       10
+#define SCHEDULER_WHEEL_SLOTS   256
+
+typedef void (*SchedulerTaskCb)(void *ctx);
+
+typedef struct SCHEDULERTASK SchedulerTask;
+
+/* Starts/stops the scheduler thread. stopScheduler() joins it and frees all
+ * remaining tasks; it must be called before OCStop(). */
+int startScheduler(void);
+void stopScheduler(void);
+
+/* Runs cb(ctx) every periodMs on the scheduler thread, first after periodMs.
+ * Returns NULL when the task cannot be allocated. */
+SchedulerTask *scheduleTask(SchedulerTaskCb cb, void *ctx, uint32_t periodMs);
+
+/* Changes the period; the next run is periodMs after the last one. */
+void setTaskPeriod(SchedulerTask *task, uint32_t periodMs);
+
+/* Removes and frees the task. Once it returns the callback is not running and
+ * will not run again. May be called from the task's own callback. */
+void cancelTask(SchedulerTask *task);
+
+/* Same, but does not wait for a running callback: it finishes on its own and
+ * the task is freed after it. For callers holding a lock the callback may
+ * take, such as the stack lock (see lockStack()). */
+void releaseTask(SchedulerTask *task);
+
+#endif
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -14,18 +15,28 @@
 #include <windows.h>
 #endif
 #include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #ifdef HAVE_PTHREAD_H
 #include <pthread.h>
 #endif
 #include "ocstack.h"
 #include "logger.h"
 #include "server.h"
+#include "scheduler.h"
+#include "measurementlog.h"
+#include "workers.h"
+#include "hotlog.h"
+#include "metrics.h"
+#include "arena.h"
+#include "svrstore.h"
+#include "introspection.h"
 
 #define TAG "SERVER"
 
 int gQuitFlag = 0;
 static char CRED_FILE[] = "server.dat";
-static char INTROSPECTION_FILE[] = "server.idd.dat";
 
 /* SIGINT handler: set gQuitFlag to 1 for graceful termination */
 void handleSigInt(int signum)
@@ -40,11 +51,18 @@ FILE* server_fopen(const char *path, const char *mode)
 {
     if (0 == strcmp(path, OC_SECURITY_DB_DAT_FILE_NAME))
     {
-        return fopen(CRED_FILE, mode);
+        // Served from memory and written back by the store, see svrstore.h
+        return isSvrStoreOpen() ? openSvrStoreFile(mode) : fopen(CRED_FILE, mode);
     }
     else if (0 == strcmp(path, OC_INTROSPECTION_FILE_NAME))
-    { 
-        return fopen(INTROSPECTION_FILE, mode);
+    {
+        // Built in from the descriptors, see introspection.h; read only
+        if (mode[0] != 'r' || strchr(mode, '+'))
+        {
+            errno = EROFS;
+            return NULL;
+        }
+        return fmemopen((void *)gIntrospectionData, gIntrospectionSize, mode);
     }
     else
     {
@@ -52,31 +70,135 @@ FILE* server_fopen(const char *path, const char *mode)
     }
 }
 
+int server_unlink(const char *path)
+{
+    if (0 == strcmp(path, OC_SECURITY_DB_DAT_FILE_NAME) && isSvrStoreOpen())
+    {
+        return unlinkSvrStoreFile();
+    }
+    return unlink(path);
+}
+
+/* Main loop modes: POLL runs OCProcess() every 100 ms, EVENT sleeps until
+ * the stack or another thread signals that there is work to do. */
+typedef enum {
+    LOOP_MODE_POLL = 0,
+    LOOP_MODE_EVENT
+} MainLoopMode;
+
+#ifdef WITH_PROCESS_EVENT
+static MainLoopMode gLoopMode = LOOP_MODE_EVENT;
+#else
+static MainLoopMode gLoopMode = LOOP_MODE_POLL;
+#endif
+
+// Upper bound on a single wait so that gQuitFlag is still noticed
+#define MAX_LOOP_WAIT_MS 1000
+
+// Metrics source timing each OCProcess() call, see metrics.h
+static int gLoopMetrics = -1;
+
+/* Counts one stack processing call and its duration */
+static void recordLoopMetrics(uint64_t startNs)
+{
+    countMetric(gLoopMetrics, METRIC_REQUESTS, 1);
+    recordLatency(gLoopMetrics, METRIC_REQUEST_LATENCY, getMetricsNs() - startNs);
+}
+
+static void logLoopUsage(unsigned long iterations, const struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+               + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    OIC_LOG_V(INFO, TAG, "Main loop (%s): %lu iterations in %.1f s, %.2f wakeups/s, cpu %.3f s (%.3f%%)",
+            (gLoopMode == LOOP_MODE_EVENT) ? "event" : "poll", iterations, elapsed,
+            (elapsed > 0) ? iterations / elapsed : 0.0, cpu,
+            (elapsed > 0) ? 100.0 * cpu / elapsed : 0.0);
+}
+
 void *iotivityThread(void *data) {
     struct timespec timeout;
 
     timeout.tv_sec  = 0;
     timeout.tv_nsec = 100000000L;
 
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned long iterations = 0;
+
     // Break from loop with Ctrl-C
-    OIC_LOG(INFO, TAG, "Entering ocserver main loop...");
+    OIC_LOG_V(INFO, TAG, "Entering ocserver main loop (%s mode)...",
+            (gLoopMode == LOOP_MODE_EVENT) ? "event" : "poll");
     signal(SIGINT, handleSigInt);
     while (!gQuitFlag)
     {
-        if (OCProcess() != OC_STACK_OK)
+        iterations++;
+#ifdef WITH_PROCESS_EVENT
+        if (gLoopMode == LOOP_MODE_EVENT)
+        {
+            uint32_t nextEventTime = MAX_LOOP_WAIT_MS;
+            uint64_t startNs = getMetricsNs();
+            lockStack();
+            OCStackResult result = OCProcessEvent(&nextEventTime);
+            unlockStack();
+            if (result != OC_STACK_OK)
+            {
+                OIC_LOG(ERROR, TAG, "OCStack process error");
+                return 0;
+            }
+            recordLoopMetrics(startNs);
+            if (nextEventTime > MAX_LOOP_WAIT_MS)
+            {
+                nextEventTime = MAX_LOOP_WAIT_MS;
+            }
+            waitMainLoop(nextEventTime);
+            continue;
+        }
+#endif
+        uint64_t startNs = getMetricsNs();
+        // Workers and the notifier call into the stack too; the wait below
+        // is the time they get it
+        lockStack();
+        OCStackResult result = OCProcess();
+        unlockStack();
+        if (result != OC_STACK_OK)
         {
             OIC_LOG(ERROR, TAG, "OCStack process error");
             return 0;
         }
+        recordLoopMetrics(startNs);
         nanosleep(&timeout, NULL);
     }
 
     OIC_LOG(INFO, TAG, "Exiting ocserver main loop...");
+    logLoopUsage(iterations, &start);
+
+    // Deferred responses and notifications must stop before the stack goes away
+    stopWorkerPool();
+    // Writes the last snapshot, with every request counted
+    stopMetricsSnapshot();
+    stopScheduler();
+    stopSampler();
+    // Flush whatever the sampler queued before the last task ran
+    closeMeasurementLog();
 
     if (OCStop() != OC_STACK_OK)
     {
         OIC_LOG(ERROR, TAG, "OCStack process error");
     }
+    // After the stack: it may still update the SVR database while stopping
+    closeSvrStore();
+    deinitMainLoopEvent();
+    // Last: every other thread has stopped logging
+    stopHotLog();
+
+    return NULL;
 }
 
 // Platform Info
@@ -266,8 +388,348 @@ exit:
     return OC_STACK_ERROR;
 }
 
-int main()
+// Default msync interval of the measurement log
+#define DEFAULT_LOG_SYNC_MS 1000
+
+/* Soak report: one line per interval (virtual time) with the sample and
+ * notification counts so far and the resident set size */
+typedef struct SOAKREPORT {
+    uint64_t startMs;
+    uint64_t startSamples;
+    uint64_t lastMs;
+    uint64_t lastNotified;
+} SoakReport;
+
+static SoakReport gSoakReport;
+
+/* Samples published and notification counters, summed over all instances */
+static uint64_t sumMonitorStats(ObserverStats *total)
+{
+    uint64_t samples = 0;
+    memset(total, 0, sizeof(*total));
+    for (size_t i = 0; i < gMonitors.count; i++)
+    {
+        BPMonitor *monitor = getMonitor(i);
+        BPMeasurement sample;
+        readMeasurement(&monitor->snapshot, &sample);
+        samples += sample.seq;
+
+        ObserverStats stats;
+        getBP0ObserveStats(monitor, &stats);
+        total->observers += stats.observers;
+        total->notified += stats.notified;
+        total->heartbeats += stats.heartbeats;
+        total->suppressed += stats.suppressed;
+    }
+    return samples;
+}
+
+/* Samples coalesced and merged away, summed over the monitor's sources */
+static void sumSampleCounters(uint64_t *coalesced, uint64_t *merged)
+{
+    MetricsSummary summary;
+    readMetrics(gMonitors.amMetrics, &summary);
+    *coalesced = summary.counters[METRIC_SAMPLES_COALESCED];
+    *merged = summary.counters[METRIC_SAMPLES_MERGED];
+    for (size_t link = 0; link < BPM_LINK_COUNT; link++)
+    {
+        readMetrics(gMonitors.linkMetrics[link], &summary);
+        *coalesced += summary.counters[METRIC_SAMPLES_COALESCED];
+        *merged += summary.counters[METRIC_SAMPLES_MERGED];
+    }
+}
+
+static void reportSoak(void *ctx)
+{
+    uint64_t now = getMonotonicMs();
+    ObserverStats stats;
+    uint64_t samples = sumMonitorStats(&stats);
+
+    ArenaStats arenaStats;
+    getArenaStats(&arenaStats);
+    uint64_t coalesced, merged;
+    sumSampleCounters(&coalesced, &merged);
+
+    double interval = (now - gSoakReport.lastMs) / 1000.0;
+    printf("soak t=%.0fs samples=%llu observers=%zu notified=%llu rate=%.1f/s suppressed=%llu"
+            " coalesced=%llu merged=%llu rss=%ldkB arena=%zuB overflows=%llu\n",
+            (now - gSoakReport.startMs) / 1000.0,
+            (unsigned long long)(samples - gSoakReport.startSamples), stats.observers,
+            (unsigned long long)stats.notified,
+            (interval > 0) ? (stats.notified - gSoakReport.lastNotified) / interval : 0.0,
+            (unsigned long long)stats.suppressed, (unsigned long long)coalesced,
+            (unsigned long long)merged, getResidentKb(), arenaStats.highWater,
+            (unsigned long long)arenaStats.overflows);
+    fflush(stdout);
+
+    gSoakReport.lastMs = now;
+    gSoakReport.lastNotified = stats.notified;
+}
+
+/* One deadband per measured value, in the order of MEASUREMENT_VALUES */
+static bool parseDeadbands(const char *arg, int *deadbands)
 {
+    char *end = (char *)arg;
+    for (size_t v = 0; v < MEASUREMENT_VALUE_COUNT; v++)
+    {
+        const char *start = end + (v > 0);
+        deadbands[v] = (int)strtol(start, &end, 10);
+        if (end == start || *end != ((v + 1 < MEASUREMENT_VALUE_COUNT) ? ',' : '\0'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printUsage(const char *name)
+{
+    printf("Usage: %s [-m poll|event] [-n periodic|change] [-d sys,dia,pulse] [-b seconds]\n"
+           "       [-C ms] [-H samples] [-L dir] [-S none|always|ms] [-s source[:arg]] [-p ms]\n"
+           "       [-x scale] [-R seconds] [-N instances] [-w threads[,queue]] [-l file]\n"
+           "       [-M file[,seconds]] [-A kB] [-P ms|file]\n", name);
+    printf("  -m  main loop mode: poll runs OCProcess() every 100 ms,\n");
+    printf("      event waits for stack or notifier activity (default: %s)\n",
+            (gLoopMode == LOOP_MODE_EVENT) ? "event" : "poll");
+    printf("  -n  notification mode: periodic sends every sample (default),\n");
+    printf("      change only sends values that moved past their deadband\n");
+    printf("  -d  deadbands for systolic, diastolic and pulse rate, one per measured\n"
+           "      value (default 0 each)\n");
+    printf("  -b  heartbeat: max silence for observers without pmax (default none)\n");
+    printf("  -C  coalescing window: notification rounds at least that many ms apart,\n"
+           "      whatever the observers' pmin; an observer gets the newest sample,\n"
+           "      or every one since its last notification when it observes a\n"
+           "      ?since= or ?limit= query (default 0, pmin alone)\n");
+    printf("  -H  samples kept per instance for ?since=<ms>&limit=N queries\n"
+           "      (default %d, cut down so that all instances share %llu MiB;\n"
+           "      0 disables, over %llu MiB in all is refused)\n",
+            HISTORY_DEFAULT_CAPACITY, (unsigned long long)(HISTORY_DEFAULT_BUDGET >> 20),
+            (unsigned long long)(HISTORY_MAX_BYTES >> 20));
+    printf("  -L  directory of the persistent measurement log (default: no log)\n");
+    printf("  -S  log msync policy: none, always (every batch) or an interval\n");
+    printf("      in ms (default %d)\n", DEFAULT_LOG_SYNC_MS);
+    printf("  -s  measurement source: sim[:seed], trace:<file> or hw[:device]\n");
+    printf("      (default %s, hw device %s)\n", getDefaultMeasurementSource()->name,
+            HW_DEFAULT_DEVICE);
+    printf("  -p  sampling period in ms (default %d)\n", SAMPLER_DEFAULT_PERIOD_MS);
+    printf("  -x  run the clock scale times faster than real time (default 1)\n");
+    printf("  -R  print a soak report every that many (virtual) seconds\n");
+    printf("  -N  number of monitor instances, 1..%d (default 1); instance i > 0\n"
+           "      is served under /bpm<i>/\n", MONITOR_MAX_INSTANCES);
+    printf("  -w  worker threads answering GET requests off the main loop and\n"
+           "      the requests they queue at most (default %d,%d; 0 answers inline)\n",
+            WORKER_DEFAULT_THREADS, WORKER_DEFAULT_QUEUE);
+    printf("  -l  file the hot path log is drained to (default stdout); events\n"
+           "      below the HOTLOG level of the build are compiled out\n");
+    printf("  -M  file rewritten with the metrics in the Prometheus text format\n"
+           "      every that many (virtual) seconds (default %d, no file)\n",
+            METRICS_DEFAULT_SNAPSHOT_MS / 1000);
+    printf("  -A  per thread arena the bodies built per request are laid out in\n"
+           "      (default %d kB, 0 builds them on the heap)\n", ARENA_DEFAULT_SIZE / 1024);
+    printf("  -P  SVR database kept in memory and written back (temporary file,\n"
+           "      fsync, rename) at most that many ms after an update (default %d,\n"
+           "      0 on every update); file rewrites %s in place instead\n",
+            SVRSTORE_DEFAULT_FLUSH_MS, CRED_FILE);
+}
+
+int main(int argc, char* argv[])
+{
+    BP0NotifyConfig notifyConfig = { false, { 0 }, 0, 0 };
+    const char *logDir = NULL;
+    MeasurementLogSync logSync = MLOG_SYNC_INTERVAL;
+    uint32_t logSyncMs = DEFAULT_LOG_SYNC_MS;
+    double clockScale = 1.0;
+    uint32_t reportMs = 0;
+    SamplerConfig samplerConfig = { getDefaultMeasurementSource(), NULL,
+            SAMPLER_DEFAULT_PERIOD_MS };
+    long historyCapacity = -1;     // -1: getDefaultHistoryCapacity()
+    size_t instances = 1;
+    unsigned int workerThreads = WORKER_DEFAULT_THREADS;
+    size_t workerQueue = WORKER_DEFAULT_QUEUE;
+    const char *hotLogFile = NULL;
+    char *metricsFile = NULL;
+    uint32_t metricsMs = METRICS_DEFAULT_SNAPSHOT_MS;
+    long svrFlushMs = SVRSTORE_DEFAULT_FLUSH_MS;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:d:b:C:H:L:S:s:p:x:R:N:w:l:M:A:P:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (0 == strcmp(optarg, "poll"))
+                {
+                    gLoopMode = LOOP_MODE_POLL;
+                }
+                else if (0 == strcmp(optarg, "event"))
+                {
+#ifdef WITH_PROCESS_EVENT
+                    gLoopMode = LOOP_MODE_EVENT;
+#else
+                    printf("event mode needs an IoTivity build with WITH_PROCESS_EVENT\n");
+                    return EXIT_FAILURE;
+#endif
+                }
+                else
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n':
+                if (0 == strcmp(optarg, "periodic") || 0 == strcmp(optarg, "change"))
+                {
+                    notifyConfig.onChange = (0 == strcmp(optarg, "change"));
+                }
+                else
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'd':
+                if (!parseDeadbands(optarg, notifyConfig.deadbands))
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                notifyConfig.heartbeatMs = (uint32_t)(atof(optarg) * 1000);
+                break;
+            case 'C':
+                notifyConfig.coalesceMs = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'H':
+                historyCapacity = (long)strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+            {
+                // "name" or "name:arg"
+                char *arg = strchr(optarg, ':');
+                if (arg)
+                {
+                    *arg++ = '\0';
+                }
+                samplerConfig.source = findMeasurementSource(optarg);
+                samplerConfig.sourceArg = arg;
+                if (!samplerConfig.source)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'p':
+                samplerConfig.periodMs = (uint32_t)atoi(optarg);
+                if (samplerConfig.periodMs == 0)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'L':
+                logDir = optarg;
+                break;
+            case 'S':
+                if (0 == strcmp(optarg, "none"))
+                {
+                    logSync = MLOG_SYNC_NONE;
+                }
+                else if (0 == strcmp(optarg, "always"))
+                {
+                    logSync = MLOG_SYNC_ALWAYS;
+                }
+                else if (atoi(optarg) > 0)
+                {
+                    logSync = MLOG_SYNC_INTERVAL;
+                    logSyncMs = (uint32_t)atoi(optarg);
+                }
+                else
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'x':
+                clockScale = atof(optarg);
+                if (clockScale <= 0)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'R':
+                reportMs = (uint32_t)(atof(optarg) * 1000);
+                break;
+            case 'N':
+                instances = strtoul(optarg, NULL, 10);
+                if (instances == 0 || instances > MONITOR_MAX_INSTANCES)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w':
+            {
+                // "threads" or "threads,queue"
+                char *queue = strchr(optarg, ',');
+                workerThreads = (unsigned int)strtoul(optarg, NULL, 10);
+                if (queue)
+                {
+                    workerQueue = strtoul(queue + 1, NULL, 10);
+                }
+                if (workerThreads > WORKER_MAX_THREADS || workerQueue == 0)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'l':
+                hotLogFile = optarg;
+                break;
+            case 'M':
+            {
+                // "file" or "file,seconds"
+                char *seconds = strrchr(optarg, ',');
+                if (seconds)
+                {
+                    *seconds++ = '\0';
+                    metricsMs = (uint32_t)(atof(seconds) * 1000);
+                }
+                metricsFile = optarg;
+                if (metricsMs == 0)
+                {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'A':
+                setResponseArenaSize(strtoul(optarg, NULL, 10) * 1024);
+                break;
+            case 'P':
+                // "file" keeps the plain file, rewritten by every update
+                svrFlushMs = (0 == strcmp(optarg, "file")) ? -1 : atol(optarg);
+                break;
+            default:
+                printUsage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    FILE *hotLogOut = stdout;
+    if (hotLogFile && !(hotLogOut = fopen(hotLogFile, "a")))
+    {
+        perror(hotLogFile);
+        return EXIT_FAILURE;
+    }
+    if (startHotLog(hotLogOut) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
     OIC_LOG(DEBUG, TAG, "OCServer is starting...");
 
     char command = 'P';
@@ -275,7 +737,12 @@ int main()
     
 #if IS_SECURE_MODE
     // Initialize Persistent Storage for SVR database
-    OCPersistentStorage ps = { server_fopen, fread, fwrite, fclose, unlink };
+    if (svrFlushMs >= 0 && openSvrStore(CRED_FILE, (uint32_t)svrFlushMs) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "SVR store open failed!");
+        exit (EXIT_FAILURE);
+    }
+    OCPersistentStorage ps = { server_fopen, fread, fwrite, fclose, server_unlink };
     OCRegisterPersistentStorageHandler(&ps);
 #endif
 
@@ -285,6 +752,11 @@ int main()
         return 0;
     }
 
+    if (gLoopMode == LOOP_MODE_EVENT)
+    {
+        initMainLoopEvent();
+    }
+
     OCStackResult registrationResult =
     SetPlatformInfo(gPlatformID, gManufacturerName, gManufacturerLink, gModelNumber,
                     gDateOfManufacture, gPlatformVersion, gOperatingSystemVersion,
@@ -311,10 +783,74 @@ int main()
         exit (EXIT_FAILURE);
     }
 
-    //Declare and create the example resource: BP
-    createBP0Resource();
-    createBP1Resource();
-    createBP2Resource();
+    // The monitor table registers one source per resource type after it
+    gLoopMetrics = registerMetricsSource("OCProcess");
+    if (historyCapacity < 0)
+    {
+        historyCapacity = (long)getDefaultHistoryCapacity(instances);
+    }
+    if (initMonitorTable(instances, (size_t)historyCapacity) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Monitor table allocation failed!");
+        exit (EXIT_FAILURE);
+    }
+
+    if (logDir)
+    {
+        if (openMeasurementLog(logDir, logSync, logSyncMs) != 0)
+        {
+            OIC_LOG(ERROR, TAG, "Measurement log open failed!");
+            exit (EXIT_FAILURE);
+        }
+        // Keep every instance's sequence numbers increasing across restarts
+        for (size_t i = 0; i < gMonitors.count; i++)
+        {
+            getMonitor(i)->snapshot.seq.store(getMeasurementLogSampleSeq((uint32_t)i));
+        }
+    }
+
+    // Everything timed below runs on the virtual clock
+    setClockScale(clockScale);
+
+    if (startScheduler() != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Scheduler start failed!");
+        exit (EXIT_FAILURE);
+    }
+
+    if (metricsFile && startMetricsSnapshot(metricsFile, metricsMs) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Metrics snapshot start failed!");
+        exit (EXIT_FAILURE);
+    }
+
+    if (startSampler(&samplerConfig) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Sampler start failed!");
+        exit (EXIT_FAILURE);
+    }
+
+    if (workerThreads > 0 && startWorkerPool(workerThreads, workerQueue) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Worker pool start failed!");
+        exit (EXIT_FAILURE);
+    }
+
+    if (reportMs > 0)
+    {
+        gSoakReport.startMs = gSoakReport.lastMs = getMonotonicMs();
+        ObserverStats stats;
+        gSoakReport.startSamples = sumMonitorStats(&stats);
+        scheduleTask(reportSoak, NULL, reportMs);
+    }
+
+    //Declare and create the example resources: BP, one set per instance
+    setBP0NotifyConfig(&notifyConfig);
+    if (createMonitorResources() != 0 || createMetricsResource() != 0)
+    {
+        exit (EXIT_FAILURE);
+    }
+    logMonitorFootprint();
 
     int status;
     pthread_t p_thread[3];
@@ -3,9 +3,12 @@
 
 #include "common.h"
 
+#include "./device/history.h"
+#include "./device/sampler.h"
+#include "./device/monitor.h"
 #include "./device/bloodpressure0.h"
-#include "./device/bloodpressure1.h"
-#include "./device/bloodpressure2.h"
+#include "./device/linkedresources.h"
+#include "./device/metricsresource.h"
 
 
 #endif
\ No newline at end of file
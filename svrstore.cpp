@@ -0,0 +1,583 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] SVR Store
+// Description: In-memory SVR database with write-behind, atomic persistence
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "logger.h"
+#include "svrstore.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-SVRSTORE"
+
+#define SVRSTORE_MIN_CAPACITY 4096
+#define SVRSTORE_RETRY_MS     1000      // after a failed flush when flushMs is 0
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+/* One stream of the stack: a private copy of the image, published on close
+ * when it was written */
+typedef struct SVRSTREAM {
+    char *data;
+    size_t size;
+    size_t capacity;
+    size_t pos;
+    bool append;
+    bool writable;
+    bool written;
+} SvrStream;
+
+typedef struct SVRSTORE {
+    char path[SVRSTORE_PATH_LENGTH];
+    uint32_t flushMs;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *image;
+    size_t size;
+    bool exists;                // false after an unlink, until the next write
+    bool dirty;                 // the image is not on disk yet
+    struct timespec dirtySince; // first write since the last flush, CLOCK_MONOTONIC
+    bool quit;
+    bool open;
+    pthread_t thread;
+    pthread_mutex_t flushLock;  // one flush at a time, in image order
+
+    uint64_t opens;
+    uint64_t writes;
+    uint64_t coalesced;
+    uint64_t flushes;
+    uint64_t fsyncs;
+    uint64_t failures;
+} SvrStore;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static SvrStore gStore = { "", 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+static void getDeadline(struct timespec *deadline, const struct timespec *from, uint32_t ms)
+{
+    *deadline = *from;
+    deadline->tv_sec += ms / 1000;
+    deadline->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool loadImage(const char *path)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in)
+    {
+        gStore.exists = false;
+        return errno == ENOENT;
+    }
+    gStore.exists = true;
+
+    size_t capacity = SVRSTORE_MIN_CAPACITY;
+    char *data = (char *)malloc(capacity);
+    size_t size = 0;
+    size_t count;
+    while (data && (count = fread(data + size, 1, capacity - size, in)) > 0)
+    {
+        size += count;
+        if (size == capacity)
+        {
+            char *grown = (char *)realloc(data, capacity * 2);
+            if (!grown)
+            {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    bool ok = data && !ferror(in);
+    fclose(in);
+    if (!ok)
+    {
+        free(data);
+        return false;
+    }
+    gStore.image = data;
+    gStore.size = size;
+    return true;
+}
+
+/* fsync() of the directory holding path, so the rename is durable too */
+static int syncDirectory(const char *path)
+{
+    char copy[SVRSTORE_PATH_LENGTH];
+    snprintf(copy, sizeof(copy), "%s", path);
+    int fd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+/* Writes data through path.tmp, fsync()ed and renamed over path; counts the
+ * fsyncs it made. NULL data removes the file instead. */
+static int writeImage(const char *path, const char *data, size_t size, uint64_t *fsyncs)
+{
+    if (!data)
+    {
+        if (unlink(path) != 0 && errno != ENOENT)
+        {
+            OIC_LOG_V(ERROR, TAG, "Failed to remove %s: %s", path, strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
+    char temporary[SVRSTORE_PATH_LENGTH + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to open %s: %s", temporary, strerror(errno));
+        return -1;
+    }
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t count = write(fd, data + done, size - done);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        done += (size_t)count;
+    }
+    bool ok = (done == size);
+    if (ok)
+    {
+        ok = (fsync(fd) == 0);
+        (*fsyncs)++;
+    }
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(temporary, path) != 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Failed to write %s: %s", path, strerror(errno));
+        unlink(temporary);
+        return -1;
+    }
+    if (syncDirectory(path) == 0)
+    {
+        (*fsyncs)++;
+    }
+    return 0;
+}
+
+/* Takes the pending image and writes it; called with flushLock held, so
+ * images reach the disk in the order they were published */
+static int flushPending()
+{
+    pthread_mutex_lock(&gStore.lock);
+    if (!gStore.dirty)
+    {
+        pthread_mutex_unlock(&gStore.lock);
+        return 0;
+    }
+    char *copy = NULL;
+    size_t size = gStore.size;
+    if (gStore.exists)
+    {
+        copy = (char *)malloc(size ? size : 1);
+        if (!copy)
+        {
+            pthread_mutex_unlock(&gStore.lock);
+            return -1;
+        }
+        memcpy(copy, gStore.image, size);
+    }
+    bool exists = gStore.exists;
+    gStore.dirty = false;
+    pthread_mutex_unlock(&gStore.lock);
+
+    uint64_t fsyncs = 0;
+    int result = (exists && !copy) ? -1 : writeImage(gStore.path, copy, size, &fsyncs);
+    free(copy);
+
+    pthread_mutex_lock(&gStore.lock);
+    gStore.fsyncs += fsyncs;
+    if (result == 0)
+    {
+        gStore.flushes++;
+    }
+    else
+    {
+        // Keep it pending, unless a newer image already is: the next attempt
+        // is a period later
+        gStore.failures++;
+        if (!gStore.dirty)
+        {
+            gStore.dirty = true;
+            clock_gettime(CLOCK_MONOTONIC, &gStore.dirtySince);
+        }
+    }
+    pthread_mutex_unlock(&gStore.lock);
+    return result;
+}
+
+int flushSvrStore(void)
+{
+    pthread_mutex_lock(&gStore.flushLock);
+    int result = flushPending();
+    pthread_mutex_unlock(&gStore.flushLock);
+    return result;
+}
+
+void *svrStoreThread(void *data)
+{
+    pthread_mutex_lock(&gStore.lock);
+    while (!gStore.quit)
+    {
+        if (!gStore.dirty)
+        {
+            pthread_cond_wait(&gStore.cond, &gStore.lock);
+            continue;
+        }
+        // The first write of a burst starts the clock; later ones ride along
+        struct timespec deadline;
+        getDeadline(&deadline, &gStore.dirtySince,
+                gStore.flushMs ? gStore.flushMs : SVRSTORE_RETRY_MS);
+        if (pthread_cond_timedwait(&gStore.cond, &gStore.lock, &deadline) != ETIMEDOUT)
+        {
+            continue;
+        }
+        pthread_mutex_unlock(&gStore.lock);
+        flushSvrStore();
+        pthread_mutex_lock(&gStore.lock);
+    }
+    pthread_mutex_unlock(&gStore.lock);
+    return NULL;
+}
+
+/* Replaces the image with a written stream's buffer, which it takes over */
+static void publishStream(SvrStream *stream)
+{
+    pthread_mutex_lock(&gStore.lock);
+    free(gStore.image);
+    gStore.image = stream->data;
+    gStore.size = stream->size;
+    gStore.exists = true;
+    stream->data = NULL;
+    gStore.writes++;
+    if (gStore.dirty)
+    {
+        gStore.coalesced++;
+    }
+    else
+    {
+        gStore.dirty = true;
+        clock_gettime(CLOCK_MONOTONIC, &gStore.dirtySince);
+        pthread_cond_signal(&gStore.cond);
+    }
+    pthread_mutex_unlock(&gStore.lock);
+
+    if (gStore.flushMs == 0)
+    {
+        flushSvrStore();
+    }
+}
+
+static ssize_t readStream(void *cookie, char *buf, size_t size)
+{
+    SvrStream *stream = (SvrStream *)cookie;
+    size_t count = (stream->pos < stream->size) ? stream->size - stream->pos : 0;
+    if (count > size)
+    {
+        count = size;
+    }
+    memcpy(buf, stream->data + stream->pos, count);
+    stream->pos += count;
+    return (ssize_t)count;
+}
+
+static ssize_t writeStream(void *cookie, const char *buf, size_t size)
+{
+    SvrStream *stream = (SvrStream *)cookie;
+    if (!stream->writable)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (stream->append)
+    {
+        stream->pos = stream->size;
+    }
+    size_t end = stream->pos + size;
+    if (end > stream->capacity)
+    {
+        size_t capacity = stream->capacity ? stream->capacity : SVRSTORE_MIN_CAPACITY;
+        while (capacity < end)
+        {
+            capacity *= 2;
+        }
+        char *grown = (char *)realloc(stream->data, capacity);
+        if (!grown)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        stream->data = grown;
+        stream->capacity = capacity;
+    }
+    if (stream->pos > stream->size)
+    {
+        // A seek past the end leaves a zeroed gap, as with a file
+        memset(stream->data + stream->size, 0, stream->pos - stream->size);
+    }
+    memcpy(stream->data + stream->pos, buf, size);
+    stream->pos = end;
+    if (end > stream->size)
+    {
+        stream->size = end;
+    }
+    stream->written = true;
+    return (ssize_t)size;
+}
+
+static int seekStream(void *cookie, off64_t *offset, int whence)
+{
+    SvrStream *stream = (SvrStream *)cookie;
+    off64_t base = (whence == SEEK_SET) ? 0 :
+                   (whence == SEEK_CUR) ? (off64_t)stream->pos : (off64_t)stream->size;
+    if (base + *offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    stream->pos = (size_t)(base + *offset);
+    *offset = (off64_t)stream->pos;
+    return 0;
+}
+
+static int closeStream(void *cookie)
+{
+    SvrStream *stream = (SvrStream *)cookie;
+    if (stream->written)
+    {
+        publishStream(stream);
+    }
+    free(stream->data);
+    free(stream);
+    return 0;
+}
+
+FILE *openSvrStoreFile(const char *mode)
+{
+    bool truncate = (mode[0] == 'w');
+    bool append = (mode[0] == 'a');
+    bool writable = truncate || append || strchr(mode, '+');
+
+    SvrStream *stream = (SvrStream *)calloc(1, sizeof(SvrStream));
+    if (!stream)
+    {
+        return NULL;
+    }
+    stream->append = append;
+    stream->writable = writable;
+
+    pthread_mutex_lock(&gStore.lock);
+    if (!gStore.open || (mode[0] == 'r' && !gStore.exists))
+    {
+        // As fopen(): reading a database that is not there fails
+        pthread_mutex_unlock(&gStore.lock);
+        free(stream);
+        errno = gStore.open ? ENOENT : EBADF;
+        return NULL;
+    }
+    gStore.opens++;
+    bool copy = !truncate && gStore.size > 0;
+    if (copy)
+    {
+        stream->data = (char *)malloc(gStore.size);
+        if (stream->data)
+        {
+            memcpy(stream->data, gStore.image, gStore.size);
+            stream->size = stream->capacity = gStore.size;
+        }
+    }
+    pthread_mutex_unlock(&gStore.lock);
+    if (copy && !stream->data)
+    {
+        free(stream);
+        return NULL;
+    }
+    // "w" creates the database even when nothing is written
+    stream->written = truncate;
+
+    cookie_io_functions_t functions = { readStream, writeStream, seekStream, closeStream };
+    FILE *fp = fopencookie(stream, mode, functions);
+    if (!fp)
+    {
+        free(stream->data);
+        free(stream);
+    }
+    return fp;
+}
+
+int unlinkSvrStoreFile(void)
+{
+    pthread_mutex_lock(&gStore.lock);
+    if (!gStore.exists)
+    {
+        pthread_mutex_unlock(&gStore.lock);
+        errno = ENOENT;
+        return -1;
+    }
+    free(gStore.image);
+    gStore.image = NULL;
+    gStore.size = 0;
+    gStore.exists = false;
+    gStore.writes++;
+    if (gStore.dirty)
+    {
+        gStore.coalesced++;
+    }
+    else
+    {
+        gStore.dirty = true;
+        clock_gettime(CLOCK_MONOTONIC, &gStore.dirtySince);
+        pthread_cond_signal(&gStore.cond);
+    }
+    pthread_mutex_unlock(&gStore.lock);
+
+    if (gStore.flushMs == 0)
+    {
+        flushSvrStore();
+    }
+    return 0;
+}
+
+int openSvrStore(const char *path, uint32_t flushMs)
+{
+    if (gStore.open)
+    {
+        return 0;
+    }
+    snprintf(gStore.path, sizeof(gStore.path), "%s", path);
+    gStore.flushMs = flushMs;
+    gStore.image = NULL;
+    gStore.size = 0;
+    gStore.dirty = false;
+    gStore.quit = false;
+    gStore.opens = gStore.writes = gStore.coalesced = 0;
+    gStore.flushes = gStore.fsyncs = gStore.failures = 0;
+    pthread_mutex_init(&gStore.flushLock, NULL);
+
+    // Waits follow CLOCK_MONOTONIC, as dirtySince does: a wall clock step
+    // neither holds back nor hurries a flush. No thread waits on it yet.
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_destroy(&gStore.cond);
+    pthread_cond_init(&gStore.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (!loadImage(path))
+    {
+        OIC_LOG_V(ERROR, TAG, "Cannot load %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (pthread_create(&gStore.thread, NULL, svrStoreThread, NULL) != 0)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to create SVR store flusher thread");
+        free(gStore.image);
+        gStore.image = NULL;
+        return -1;
+    }
+    gStore.open = true;
+    OIC_LOG_V(INFO, TAG, "SVR database %s: %zu bytes in memory, written back within %u ms",
+            path, gStore.size, flushMs);
+    return 0;
+}
+
+void closeSvrStore(void)
+{
+    pthread_mutex_lock(&gStore.lock);
+    if (!gStore.open)
+    {
+        pthread_mutex_unlock(&gStore.lock);
+        return;
+    }
+    gStore.open = false;
+    gStore.quit = true;
+    pthread_cond_signal(&gStore.cond);
+    pthread_mutex_unlock(&gStore.lock);
+    pthread_join(gStore.thread, NULL);
+
+    // Whatever the stack wrote last is on disk before the process goes
+    if (flushSvrStore() != 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Last SVR database update not written to %s", gStore.path);
+    }
+    pthread_mutex_destroy(&gStore.flushLock);
+    free(gStore.image);
+    gStore.image = NULL;
+
+    OIC_LOG_V(INFO, TAG, "SVR store closed: %llu writes, %llu coalesced, %llu flushes, "
+            "%llu fsyncs", (unsigned long long)gStore.writes,
+            (unsigned long long)gStore.coalesced, (unsigned long long)gStore.flushes,
+            (unsigned long long)gStore.fsyncs);
+}
+
+bool isSvrStoreOpen(void)
+{
+    pthread_mutex_lock(&gStore.lock);
+    bool open = gStore.open;
+    pthread_mutex_unlock(&gStore.lock);
+    return open;
+}
+
+void getSvrStoreStats(SvrStoreStats *stats)
+{
+    pthread_mutex_lock(&gStore.lock);
+    stats->size = gStore.size;
+    stats->opens = gStore.opens;
+    stats->writes = gStore.writes;
+    stats->coalesced = gStore.coalesced;
+    stats->flushes = gStore.flushes;
+    stats->fsyncs = gStore.fsyncs;
+    stats->failures = gStore.failures;
+    pthread_mutex_unlock(&gStore.lock);
+}
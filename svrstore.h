@@ -0,0 +1,53 @@
+#ifndef SVRSTORE_H
+#define SVRSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* In-memory store of the SVR database behind OCPersistentStorage. The file
+ * is loaded once; every open the stack makes returns a memory stream over a
+ * copy of it, and closing a stream that was written replaces the image. A
+ * flusher thread writes the image back through a temporary file, fsync()ed
+ * and renamed over the database, so the file on disk is always one complete
+ * image. Writes in a burst (the doxm, pstat, acl and cred updates of an
+ * onboarding) are coalesced: the file is written at most flushMs after the
+ * first one, however many follow, and never more often than that. */
+
+#define SVRSTORE_DEFAULT_FLUSH_MS   1000
+#define SVRSTORE_PATH_LENGTH        512
+
+typedef struct SVRSTORESTATS {
+    size_t size;                // bytes of the image
+    uint64_t opens;             // streams opened by the stack
+    uint64_t writes;            // streams closed after writing, each a new image
+    uint64_t coalesced;         // ... replacing an image that was not on disk yet
+    uint64_t flushes;           // images written to disk
+    uint64_t fsyncs;            // of the file and of its directory
+    uint64_t failures;          // flushes that failed, to be retried
+} SvrStoreStats;
+
+/* Loads path (a missing file is an empty database) and starts the flusher.
+ * flushMs bounds how stale the file may get; 0 writes every image through
+ * before the stream's fclose() returns. */
+int openSvrStore(const char *path, uint32_t flushMs);
+
+/* Writes a pending image and stops the flusher; opens go to the file again */
+void closeSvrStore(void);
+
+bool isSvrStoreOpen(void);
+
+/* A stream over the image, for OCPersistentStorage.open; the mode is the
+ * fopen() one. NULL when the store is closed or out of memory. */
+FILE *openSvrStoreFile(const char *mode);
+
+/* OCPersistentStorage.unlink of the database: empties the image, and the
+ * flusher removes the file */
+int unlinkSvrStoreFile(void);
+
+/* Writes a pending image now, on the calling thread */
+int flushSvrStore(void);
+
+void getSvrStoreStats(SvrStoreStats *stats);
+
+#endif
@@ -0,0 +1,199 @@
+//-----------------------------------------------------------------------------
+// Title: [IoTivity][Blood Pressure Monitor] Worker Pool
+// Description: Bounded job ring served by a fixed set of worker threads
+//-----------------------------------------------------------------------------
+
+#include "iotivity_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "logger.h"
+#include "workers.h"
+
+//-----------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------
+
+#define TAG "SERVER-WORKERS"
+
+//-----------------------------------------------------------------------------
+// Typedefs
+//-----------------------------------------------------------------------------
+
+typedef struct WORKERJOB {
+    WorkerJobCb cb;
+    void *ctx;
+} WorkerJob;
+
+typedef struct WORKERPOOL {
+    pthread_t threads[WORKER_MAX_THREADS];
+    unsigned int threadCount;
+    pthread_cond_t cond;        // wakes a worker when a job is queued
+    WorkerJob *jobs;            // ring of capacity jobs
+    size_t capacity;
+    size_t head;                // next job to run
+    size_t count;
+    WorkerStats stats;
+    bool started;
+    bool quit;
+} WorkerPool;
+
+//-----------------------------------------------------------------------------
+// Variables
+//-----------------------------------------------------------------------------
+
+static WorkerPool gWorkerPool;
+static pthread_mutex_t gWorkerLock = PTHREAD_MUTEX_INITIALIZER;
+
+//-----------------------------------------------------------------------------
+// Function Implementations
+//-----------------------------------------------------------------------------
+
+void *workerThread(void *data)
+{
+    pthread_mutex_lock(&gWorkerLock);
+    for (;;)
+    {
+        if (gWorkerPool.count == 0)
+        {
+            // The queue is drained before the workers leave
+            if (gWorkerPool.quit)
+            {
+                break;
+            }
+            pthread_cond_wait(&gWorkerPool.cond, &gWorkerLock);
+            continue;
+        }
+
+        WorkerJob job = gWorkerPool.jobs[gWorkerPool.head];
+        gWorkerPool.head = (gWorkerPool.head + 1) % gWorkerPool.capacity;
+        gWorkerPool.count--;
+        pthread_mutex_unlock(&gWorkerLock);
+
+        job.cb(job.ctx);
+
+        pthread_mutex_lock(&gWorkerLock);
+        gWorkerPool.stats.completed++;
+    }
+    pthread_mutex_unlock(&gWorkerLock);
+    return NULL;
+}
+
+int startWorkerPool(unsigned int threads, size_t queueDepth)
+{
+    if (gWorkerPool.started)
+    {
+        return 0;
+    }
+    if (threads == 0 || threads > WORKER_MAX_THREADS || queueDepth == 0)
+    {
+        OIC_LOG_V(ERROR, TAG, "Worker pool needs 1..%d threads and a queue", WORKER_MAX_THREADS);
+        return -1;
+    }
+
+    gWorkerPool.jobs = (WorkerJob *)calloc(queueDepth, sizeof(WorkerJob));
+    if (!gWorkerPool.jobs)
+    {
+        OIC_LOG(ERROR, TAG, "Failed to allocate the worker queue");
+        return -1;
+    }
+    gWorkerPool.capacity = queueDepth;
+    gWorkerPool.head = 0;
+    gWorkerPool.count = 0;
+    memset(&gWorkerPool.stats, 0, sizeof(gWorkerPool.stats));
+    pthread_cond_init(&gWorkerPool.cond, NULL);
+    gWorkerPool.quit = false;
+    gWorkerPool.threadCount = 0;
+
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        if (pthread_create(&gWorkerPool.threads[i], NULL, workerThread, NULL) != 0)
+        {
+            OIC_LOG(ERROR, TAG, "Failed to create worker thread");
+            break;
+        }
+        gWorkerPool.threadCount++;
+    }
+    if (gWorkerPool.threadCount == 0)
+    {
+        free(gWorkerPool.jobs);
+        gWorkerPool.jobs = NULL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&gWorkerLock);
+    gWorkerPool.started = true;
+    pthread_mutex_unlock(&gWorkerLock);
+    OIC_LOG_V(INFO, TAG, "Worker pool started: %u thread(s), %zu queued jobs at most",
+            gWorkerPool.threadCount, queueDepth);
+    return 0;
+}
+
+void stopWorkerPool(void)
+{
+    pthread_mutex_lock(&gWorkerLock);
+    if (!gWorkerPool.started)
+    {
+        pthread_mutex_unlock(&gWorkerLock);
+        return;
+    }
+    // No new jobs from here on; the workers finish the queued ones
+    gWorkerPool.started = false;
+    gWorkerPool.quit = true;
+    pthread_cond_broadcast(&gWorkerPool.cond);
+    pthread_mutex_unlock(&gWorkerLock);
+
+    for (unsigned int i = 0; i < gWorkerPool.threadCount; i++)
+    {
+        pthread_join(gWorkerPool.threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&gWorkerPool.cond);
+    free(gWorkerPool.jobs);
+    gWorkerPool.jobs = NULL;
+    OIC_LOG_V(INFO, TAG, "Worker pool stopped: %llu jobs, %llu rejected, %zu queued at most",
+            (unsigned long long)gWorkerPool.stats.completed,
+            (unsigned long long)gWorkerPool.stats.rejected, gWorkerPool.stats.maxQueued);
+}
+
+bool isWorkerPoolRunning(void)
+{
+    pthread_mutex_lock(&gWorkerLock);
+    bool running = gWorkerPool.started;
+    pthread_mutex_unlock(&gWorkerLock);
+    return running;
+}
+
+bool submitWork(WorkerJobCb cb, void *ctx)
+{
+    pthread_mutex_lock(&gWorkerLock);
+    if (!gWorkerPool.started || gWorkerPool.count == gWorkerPool.capacity)
+    {
+        gWorkerPool.stats.rejected++;
+        pthread_mutex_unlock(&gWorkerLock);
+        return false;
+    }
+
+    WorkerJob *job = &gWorkerPool.jobs[(gWorkerPool.head + gWorkerPool.count) % gWorkerPool.capacity];
+    job->cb = cb;
+    job->ctx = ctx;
+    gWorkerPool.count++;
+    gWorkerPool.stats.submitted++;
+    if (gWorkerPool.count > gWorkerPool.stats.maxQueued)
+    {
+        gWorkerPool.stats.maxQueued = gWorkerPool.count;
+    }
+    pthread_cond_signal(&gWorkerPool.cond);
+    pthread_mutex_unlock(&gWorkerLock);
+    return true;
+}
+
+void getWorkerStats(WorkerStats *stats)
+{
+    pthread_mutex_lock(&gWorkerLock);
+    *stats = gWorkerPool.stats;
+    pthread_mutex_unlock(&gWorkerLock);
+}
@@ -0,0 +1,38 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Bounded pool of worker threads for request work that must not hold up the
+ * OCProcess() thread. Jobs wait in a fixed size ring; when the ring is full
+ * submitWork() fails instead of blocking, and the caller does the work
+ * itself. */
+
+#define WORKER_DEFAULT_THREADS  2
+#define WORKER_MAX_THREADS      64
+#define WORKER_DEFAULT_QUEUE    64
+
+typedef void (*WorkerJobCb)(void *ctx);
+
+typedef struct WORKERSTATS {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;          // ring full or pool stopped
+    size_t maxQueued;           // deepest the ring has been
+} WorkerStats;
+
+/* Starts threads workers sharing a ring of queueDepth jobs. stopWorkerPool()
+ * stops taking jobs, runs the ones already queued and joins the threads; it
+ * must be called before OCStop() since jobs answer requests. */
+int startWorkerPool(unsigned int threads, size_t queueDepth);
+void stopWorkerPool(void);
+bool isWorkerPoolRunning(void);
+
+/* Queues cb(ctx) for a worker. Returns false when the pool is not running or
+ * its ring is full; the job is then not run and ctx stays the caller's. */
+bool submitWork(WorkerJobCb cb, void *ctx);
+
+void getWorkerStats(WorkerStats *stats);
+
+#endif